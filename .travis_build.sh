@@ -5,10 +5,30 @@ echo "Compiling unit tests..."
 clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/main.o tests/main.cpp
 clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/node_test.o tests/node_test.cpp
 clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/ksom_test.o tests/ksom_test.cpp
-clang++ -std=c++1y -g -Wall -Wextra -o tests/gtest tests/main.o tests/node_test.o tests/ksom_test.o -pthread -Ltests/ -lgtest
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/sparse_node_test.o tests/sparse_node_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/metric_test.o tests/metric_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/topology_test.o tests/topology_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/multi_resolution_ksom_test.o tests/multi_resolution_ksom_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/pyramid_test.o tests/pyramid_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/published_map_test.o tests/published_map_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/profile_test.o tests/profile_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/ksom_ensemble_test.o tests/ksom_ensemble_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/numa_test.o tests/numa_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/dataset_test.o tests/dataset_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/deduplicate_test.o tests/deduplicate_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/pca_test.o tests/pca_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/projection_test.o tests/projection_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/batch_ksom_test.o tests/batch_ksom_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/transport_test.o tests/transport_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/sampler_test.o tests/sampler_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/autotune_test.o tests/autotune_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/random_test.o tests/random_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/neuron_index_test.o tests/neuron_index_test.cpp
+clang++ -std=c++1y -pthread -g -Wall -Wextra -isystem tests/googletest/googletest/include -c -o tests/incremental_ksom_test.o tests/incremental_ksom_test.cpp
+clang++ -std=c++1y -g -Wall -Wextra -o tests/gtest tests/main.o tests/node_test.o tests/ksom_test.o tests/sparse_node_test.o tests/metric_test.o tests/topology_test.o tests/multi_resolution_ksom_test.o tests/pyramid_test.o tests/published_map_test.o tests/profile_test.o tests/ksom_ensemble_test.o tests/numa_test.o tests/dataset_test.o tests/deduplicate_test.o tests/pca_test.o tests/projection_test.o tests/batch_ksom_test.o tests/transport_test.o tests/sampler_test.o tests/autotune_test.o tests/random_test.o tests/neuron_index_test.o tests/incremental_ksom_test.o -pthread -Ltests/ -lgtest
 echo "Running unit tests..."
 tests/gtest -v
 result=$?
-rm -r tests/gtest tests/main.o tests/node_test.o tests/ksom_test.o tests/gtest-all.o tests/libgtest.a
+rm -r tests/gtest tests/main.o tests/node_test.o tests/ksom_test.o tests/sparse_node_test.o tests/metric_test.o tests/topology_test.o tests/multi_resolution_ksom_test.o tests/pyramid_test.o tests/published_map_test.o tests/profile_test.o tests/ksom_ensemble_test.o tests/numa_test.o tests/dataset_test.o tests/deduplicate_test.o tests/pca_test.o tests/projection_test.o tests/batch_ksom_test.o tests/transport_test.o tests/sampler_test.o tests/autotune_test.o tests/random_test.o tests/neuron_index_test.o tests/incremental_ksom_test.o tests/gtest-all.o tests/libgtest.a
 echo "Unit tests completed : $result"
 exit $result
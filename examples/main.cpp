@@ -7,6 +7,8 @@
 #include <random>
 #include "../sources/ksom.hpp"
 #include "../sources/node.hpp"
+#include "../sources/deduplicate.hpp"
+#include "../sources/pca.hpp"
 using namespace std;
 
 
@@ -32,28 +34,24 @@ int main()
         }
     }
 
-    // create matrix of model vector
+    // create matrix of model vector spread over the plane of the two
+    // principal components of the input
     constexpr auto rows = 40, cols = 40;
-    vector<vector<kg::Node<int>>> map(rows, vector<kg::Node<int>>(cols));
-
-    uniform_int_distribution<> randIdx(0, length - 1);
-    for ( auto& row : map ) {
-        for ( auto& node : row ) {
-            // set input vector at random
-            int idx = randIdx(mt);
-            node = src[idx];
-         }
-    }
+    const auto map = kg::linearMap(src, rows, cols);
 
 
     // create instance of KSOM and compute
     constexpr auto maxIterate = 100;
     constexpr auto alpha0 = 0.1;
-    constexpr auto sigma0 = 20.0;
-    auto colorSOM = make_unique<kg::KSOM<int>>(src, map, maxIterate, alpha0, sigma0);
-    while ( colorSOM->computeOnes() ) {
-        cout << colorSOM->time() << endl;
-    }
+    constexpr auto sigma0 = 5.0;
+    // train on distinct colors, weighted by how often they appear
+    const auto unique = kg::deduplicate(src);
+    auto colorSOM = make_unique<kg::KSOM<int>>(unique.nodes, map, maxIterate, alpha0, sigma0);
+    colorSOM->setWeights(unique.weights());
+    auto training = colorSOM->computeAsync([](const kg::Progress& progress) {
+        cout << progress.time << endl;
+    }, 1);
+    training.get();
 
 
     return 0;
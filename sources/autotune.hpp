@@ -0,0 +1,201 @@
+#ifndef KG_AUTOTUNE_H
+#define KG_AUTOTUNE_H
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "checkpoint.hpp"
+
+
+namespace kg {
+
+
+namespace {
+    constexpr auto TUNING_REPEATS = 3;
+    constexpr auto TUNING_FIELDS = 4;
+};
+
+
+enum class SearchEngine {
+    Exhaustive,
+    Hierarchical,
+    Projected,
+};
+
+
+// Configuration picked by KSOM::autotune(). engineSize is the block size of
+// the hierarchical search or the reduced dimension of the projected search,
+// and 0 for the exhaustive search; threads of 0 is the OpenMP default.
+struct TuningChoice {
+    SearchEngine engine;
+    int engineSize;
+    int threads;
+    bool pipelined;
+};
+
+
+// Tuning choices cached by key, one line per key in a text file: the tab
+// separated fields of the key followed by those of the choice.
+class TuningProfile {
+private:
+    std::map<std::string, TuningChoice> entries_;
+
+public:
+    auto load(const std::string& path) -> bool;
+    auto save(const std::string& path) const throw (std::string) -> void;
+    auto find(const std::string& key, TuningChoice& choice) const -> bool;
+    auto store(const std::string& key, const TuningChoice& choice) -> void;
+    auto size() const -> int;
+};
+
+
+// model name of the first processor in /proc/cpuinfo, or "unknown"
+inline auto cpuModel() -> std::string
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while ( std::getline(cpuinfo, line) ) {
+        const auto colon = line.find(':');
+        if ( colon == std::string::npos ) {
+            continue;
+        }
+        const auto name = line.substr(0, line.find_last_not_of(" \t", colon - 1) + 1);
+        if ( name == "model name" || name == "Hardware" || name == "cpu model" ) {
+            const auto begin = line.find_first_not_of(" \t", colon + 1);
+            if ( begin != std::string::npos ) {
+                return line.substr(begin);
+            }
+        }
+    }
+
+    return "unknown";
+}
+
+
+// threads of an OpenMP parallel region without num_threads
+inline auto maxThreads() -> int
+{
+    #ifdef _OPENMP
+    return omp_get_max_threads();
+    #else
+    return 1;
+    #endif
+}
+
+
+// 1, 2, 4, ... up to and including maxThreads()
+inline auto threadCandidates() -> std::vector<int>
+{
+    std::vector<int> threads;
+    for ( auto t = 1; t < maxThreads(); t *= 2 ) {
+        threads.push_back(t);
+    }
+    threads.push_back(maxThreads());
+
+    return threads;
+}
+
+
+inline auto TuningProfile::load(const std::string& path) -> bool
+{
+    // lines that cannot be parsed are skipped
+    std::ifstream file(path);
+    if ( !file ) {
+        return false;
+    }
+
+    std::string line;
+    while ( std::getline(file, line) ) {
+        std::vector<std::string> fields;
+        std::istringstream stream(line);
+        std::string field;
+        while ( std::getline(stream, field, '\t') ) {
+            fields.push_back(field);
+        }
+        if ( static_cast<int>(fields.size()) <= TUNING_FIELDS ) {
+            continue;
+        }
+
+        const auto choiceAt = fields.size() - TUNING_FIELDS;
+        auto engine = 0, engineSize = 0, threads = 0, pipelined = 0;
+        std::istringstream numbers(fields[choiceAt] + ' ' + fields[choiceAt + 1] + ' '
+                                    + fields[choiceAt + 2] + ' ' + fields[choiceAt + 3]);
+        if ( !(numbers >> engine >> engineSize >> threads >> pipelined)
+                || engine < static_cast<int>(SearchEngine::Exhaustive)
+                || engine > static_cast<int>(SearchEngine::Projected) ) {
+            continue;
+        }
+
+        auto key = fields[0];
+        for ( auto k = 1U; k < choiceAt; k++ ) {
+            key += '\t' + fields[k];
+        }
+        entries_[key] = {static_cast<SearchEngine>(engine), engineSize, threads, pipelined != 0};
+    }
+
+    return true;
+}
+
+
+inline auto TuningProfile::save(const std::string& path) const throw (std::string) -> void
+{
+    // write next to the target under a unique name and rename, so readers never
+    // see a torn file and concurrent writers never share the temporary file
+    std::ostringstream text;
+    for ( const auto& entry : entries_ ) {
+        const auto& choice = entry.second;
+        text << entry.first << '\t' << static_cast<int>(choice.engine) << '\t' << choice.engineSize
+                << '\t' << choice.threads << '\t' << (choice.pipelined ? 1 : 0) << '\n';
+    }
+    const auto bytes = text.str();
+
+    std::string tmpPath;
+    auto file = openTempFile(path, tmpPath);
+    if ( file == nullptr ) {
+        throw std::string("cannot write tuning profile.");
+    }
+    auto ok = bytes.empty() || std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    ok = std::fclose(file) == 0 && ok;
+    ok = ok && std::rename(tmpPath.c_str(), path.c_str()) == 0;
+    if ( !ok ) {
+        std::remove(tmpPath.c_str());
+        throw std::string("cannot write tuning profile.");
+    }
+}
+
+
+inline auto TuningProfile::find(const std::string& key, TuningChoice& choice) const -> bool
+{
+    const auto entry = entries_.find(key);
+    if ( entry == entries_.end() ) {
+        return false;
+    }
+
+    choice = entry->second;
+    return true;
+}
+
+
+inline auto TuningProfile::store(const std::string& key, const TuningChoice& choice) -> void
+{
+    entries_[key] = choice;
+}
+
+
+inline auto TuningProfile::size() const -> int
+{
+    return entries_.size();
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef KG_BATCH_KSOM_H
+#define KG_BATCH_KSOM_H
+
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <cmath>
+#include <numeric>
+#include "node.hpp"
+#include "ksom.hpp"
+#include "transport.hpp"
+#include "batch_update.hpp"
+
+
+namespace kg {
+
+
+// Data-parallel batch SOM. Every worker (usually a process) owns a shard of
+// the input and the same initial map. In an epoch each worker finds the BMUs
+// of its shard and sums the samples and weights per BMU; the sums are
+// allreduced over the transport, and every worker forms the next map as the
+// neighborhood-weighted mean of all samples, so the maps stay identical.
+// The schedule of sigma and the stopping criteria are those of KSOM, with
+// one epoch per step; alpha is not used. LocalTransport trains on a single
+// worker.
+template <typename T, typename Transport=SocketTransport,
+            typename Metric=EuclideanMetric, typename Topology=RectangularTopology>
+class BatchKSOM {
+private:
+    using Model = KSOM<T, Metric, Topology>;
+    using Map   = std::vector<std::vector<Node<T>>>;
+
+    Model model_;
+    Transport& transport_;
+
+    // raw weights of the shard, which must not be normalized per worker
+    std::vector<double> weights_;
+
+private:
+    inline static auto checkShard(const std::vector<Node<T>>& shard) throw (std::string) -> const std::vector<Node<T>>&;
+
+public:
+    BatchKSOM(const std::vector<Node<T>>& shard, const Map& map, int maxEpoch, double sigma0,
+                Transport& transport, const Metric& metric=Metric(),
+                const Topology& topology=Topology()) throw (std::string);
+    ~BatchKSOM();
+
+    auto computeOnes() -> bool;
+    auto compute() -> void;
+    auto time() const -> int;
+    auto setWeights(const std::vector<double>& weights) throw (std::string) -> void;
+    auto model() -> Model&;
+    auto model() const -> const Model&;
+};
+
+
+template <typename T, typename Transport, typename Metric, typename Topology>
+BatchKSOM<T, Transport, Metric, Topology>::BatchKSOM(const std::vector<Node<T>>& shard, const Map& map,
+                                                        int maxEpoch, double sigma0, Transport& transport,
+                                                        const Metric& metric, const Topology& topology) throw (std::string)
+    :model_(checkShard(shard), map, maxEpoch, 1.0, sigma0, false, metric, topology)
+    ,transport_(transport)
+{
+}
+
+
+template <typename T, typename Transport, typename Metric, typename Topology>
+BatchKSOM<T, Transport, Metric, Topology>::~BatchKSOM()
+{
+}
+
+
+template <typename T, typename Transport, typename Metric, typename Topology>
+auto BatchKSOM<T, Transport, Metric, Topology>::checkShard(const std::vector<Node<T>>& shard) throw (std::string) -> const std::vector<Node<T>>&
+{
+    if ( shard.empty() ) {
+        throw std::string("shard is empty.");
+    }
+
+    return shard;
+}
+
+
+template <typename T, typename Transport, typename Metric, typename Topology>
+auto BatchKSOM<T, Transport, Metric, Topology>::computeOnes() -> bool
+{
+    // one epoch; every worker must call it the same number of times
+    auto& m = model_;
+    if ( !m.canCompute() ) {
+        return false;
+    }
+
+    const auto length       = m.length_;
+    const auto dimension    = m.dimension_;
+    const auto rows         = m.rows_, cols = m.cols_;
+    const auto neurons      = rows*cols;
+    const auto& src         = *m.src_;
+
+    std::vector<int> bmus(length);
+    #ifdef _OPENMP
+    #pragma omp parallel for num_threads(m.threadCount()) schedule(dynamic, 64)
+    #endif
+    for ( auto idx = 0; idx < length; idx++ ) {
+        const auto nearestPoint = m.findNearestNode(idx);
+        bmus[idx] = std::get<0>(nearestPoint)*cols + std::get<1>(nearestPoint);
+    }
+
+    // samples grouped by BMU, so that the sums of one neuron are one thread's work
+    std::vector<int> offsets(neurons + 1, 0), order(length);
+    for ( const auto b : bmus ) {
+        ++offsets[b + 1];
+    }
+    for ( auto n = 0; n < neurons; n++ ) {
+        offsets[n + 1] += offsets[n];
+    }
+    auto cursor = offsets;
+    for ( auto idx = 0; idx < length; idx++ ) {
+        order[cursor[bmus[idx]]++] = idx;
+    }
+
+    // per-BMU sums of samples, then of weights, then the error and weight totals;
+    // every total is summed in a fixed order, so that it does not depend on the threads
+    std::vector<double> sums(static_cast<size_t>(neurons)*dimension + neurons + 2, 0.0);
+    const auto counts = &sums[static_cast<size_t>(neurons)*dimension];
+    std::vector<double> errors(neurons, 0.0);
+    #ifdef _OPENMP
+    #pragma omp parallel for num_threads(m.threadCount()) schedule(dynamic, 16)
+    #endif
+    for ( auto b = 0; b < neurons; b++ ) {
+        const auto sum = &sums[static_cast<size_t>(b)*dimension];
+        for ( auto k = offsets[b]; k < offsets[b + 1]; k++ ) {
+            const auto idx      = order[k];
+            const auto weight   = weights_.empty() ? 1.0 : weights_[idx];
+            const auto x        = src[idx].data();
+            for ( auto i = 0; i < dimension; i++ ) {
+                sum[i] += weight*x[i];
+            }
+            counts[b]   += weight;
+            errors[b]   += weight*m.calcDistance(src[idx], m.map_[b/cols][b%cols]);
+        }
+    }
+    for ( auto b = 0; b < neurons; b++ ) {
+        sums[sums.size() - 2]   += errors[b];
+        sums.back()             += counts[b];
+    }
+
+    transport_.allreduce(sums.data(), sums.size());
+
+    std::vector<int> hits;
+    for ( auto b = 0; b < neurons; b++ ) {
+        if ( counts[b] > 0.0 ) {
+            hits.push_back(b);
+        }
+    }
+    const auto sigma = m.calcSigma(m.time_);
+    std::vector<int> columns(cols);
+    std::iota(columns.begin(), columns.end(), 0);
+    std::vector<double> rowDisplacements(rows, 0.0);
+    #ifdef _OPENMP
+    #pragma omp parallel for num_threads(m.threadCount()) schedule(static)
+    #endif
+    for ( auto r = 0; r < rows; r++ ) {
+        rowDisplacements[r] = batchUpdateRow(m.map_[r], r, columns, sigma, hits, sums.data(), counts,
+                                                m.topology_, m.metric_);
+    }
+
+    if ( m.hierarchical_ ) {
+        m.pyramid_.build(m.map_, m.threadCount());
+    }
+    if ( m.projected_ ) {
+        m.projection_.build(m.map_, m.threadCount());
+    }
+    const auto displacement = std::accumulate(rowDisplacements.begin(), rowDisplacements.end(), 0.0);
+    m.finishStep(sums[sums.size() - 2]/sums.back(), displacement/neurons);
+
+    return true;
+}
+
+
+template <typename T, typename Transport, typename Metric, typename Topology>
+auto BatchKSOM<T, Transport, Metric, Topology>::compute() -> void
+{
+    while ( computeOnes() ) {
+        ;
+    }
+}
+
+
+template <typename T, typename Transport, typename Metric, typename Topology>
+auto BatchKSOM<T, Transport, Metric, Topology>::time() const -> int
+{
+    return model_.time();
+}
+
+
+template <typename T, typename Transport, typename Metric, typename Topology>
+auto BatchKSOM<T, Transport, Metric, Topology>::setWeights(const std::vector<double>& weights) throw (std::string) -> void
+{
+    // validated, and normalized for evaluate(), by the model
+    model_.setWeights(weights);
+    weights_ = weights;
+}
+
+
+template <typename T, typename Transport, typename Metric, typename Topology>
+auto BatchKSOM<T, Transport, Metric, Topology>::model() -> Model&
+{
+    return model_;
+}
+
+
+template <typename T, typename Transport, typename Metric, typename Topology>
+auto BatchKSOM<T, Transport, Metric, Topology>::model() const -> const Model&
+{
+    return model_;
+}
+
+
+}
+
+
+#endif
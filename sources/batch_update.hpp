@@ -0,0 +1,86 @@
+#ifndef KG_BATCH_UPDATE_H
+#define KG_BATCH_UPDATE_H
+
+
+#include <vector>
+#include <cmath>
+#include "node.hpp"
+
+
+namespace kg {
+
+
+namespace {
+    constexpr auto BATCH_NEIGHBORHOOD_CUTOFF = 1.0e-6;
+};
+
+
+// The batch SOM forms every model vector as the neighborhood-weighted mean of
+// the samples, from the sums of the samples and of their weights per BMU.
+// Neurons whose neighborhood coefficient is below BATCH_NEIGHBORHOOD_CUTOFF
+// are left out of each other's means.
+
+
+// squared lattice distance beyond which the neighborhood is cut off
+inline auto batchReach(double sigma) -> double
+{
+    return -2.0*sigma*sigma*log(BATCH_NEIGHBORHOOD_CUTOFF);
+}
+
+
+// Forms the model vectors of the given columns of row r of the map from the
+// sums of the neurons in hits; sums has one vector of the dimension of the
+// map per neuron and counts one total weight. A column without samples in
+// its neighborhood keeps its model vector. Returns the summed displacement.
+template <typename T, typename Metric, typename Topology>
+auto batchUpdateRow(std::vector<Node<T>>& row, int r, const std::vector<int>& columns, double sigma,
+                    const std::vector<int>& hits, const double* sums, const double* counts,
+                    const Topology& topology, Metric& metric) -> double
+{
+    const auto cols         = static_cast<int>(row.size());
+    const auto dimension    = row[0].size();
+    const auto reach        = batchReach(sigma);
+    std::vector<double> numerators(columns.size()*dimension, 0.0), denominators(columns.size(), 0.0);
+    for ( const auto b : hits ) {
+        const auto sqDistances  = topology.row(b/cols, b%cols, r);
+        const auto sum          = &sums[static_cast<size_t>(b)*dimension];
+        for ( auto k = 0U; k < columns.size(); k++ ) {
+            const auto sqDistance = sqDistances[columns[k]];
+            if ( sqDistance > reach ) {
+                continue;
+            }
+            const auto h            = exp(-sqDistance/(2.0*sigma*sigma));
+            const auto numerator    = &numerators[k*dimension];
+            for ( auto i = 0; i < dimension; i++ ) {
+                numerator[i] += h*sum[i];
+            }
+            denominators[k] += h*counts[b];
+        }
+    }
+
+    auto displacement = 0.0;
+    for ( auto k = 0U; k < columns.size(); k++ ) {
+        if ( denominators[k] <= 0.0 ) {
+            continue;
+        }
+        const auto c            = columns[k];
+        const auto w            = row[c].data();
+        const auto numerator    = &numerators[k*dimension];
+        auto moved = 0.0;
+        for ( auto i = 0; i < dimension; i++ ) {
+            const auto next = static_cast<T>(numerator[i]/denominators[k]);
+            moved += (static_cast<double>(next) - w[i])*(static_cast<double>(next) - w[i]);
+            w[i] = next;
+        }
+        metric.update(w, dimension, r*cols + c);
+        displacement += sqrt(moved);
+    }
+
+    return displacement;
+}
+
+
+}
+
+
+#endif
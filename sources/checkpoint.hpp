@@ -0,0 +1,327 @@
+#ifndef KG_CHECKPOINT_H
+#define KG_CHECKPOINT_H
+
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace kg {
+
+
+// Binary checkpoint of a KSOM in host byte order:
+//   CheckpointHeader
+//   model vectors, rows*cols*dimension elements at mapOffset
+//   sparse scales, rows*cols doubles at scalesOffset (sparse maps only)
+//   textual state of the sampler at rngOffset
+// Every array starts on a CHECKPOINT_ALIGNMENT boundary, so a restored file
+// can be used straight from a read-only memory mapping.
+
+
+namespace {
+    constexpr char CHECKPOINT_MAGIC[8] = {'K', 'S', 'O', 'M', 'C', 'K', 'P', 'T'};
+    constexpr uint32_t CHECKPOINT_VERSION = 3;
+    constexpr uint64_t CHECKPOINT_ALIGNMENT = 64;
+};
+
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t elementSize;
+    int32_t rows;
+    int32_t cols;
+    int32_t dimension;
+    int32_t sparse;
+    int32_t time;
+    int32_t maxIterate;
+    double alpha0;
+    double sigma0;
+    double timeConstant;
+    double quantizationError;
+    double displacement;
+    double checkedError;
+    int32_t stagnantChecks;
+    int32_t stopReason;
+    uint64_t mapOffset;
+    uint64_t scalesOffset;
+    uint64_t rngOffset;
+    uint64_t rngSize;
+};
+
+
+// state copied out of a KSOM, so that it can be written without the KSOM
+template <typename T>
+struct CheckpointData {
+    CheckpointHeader header;
+    std::vector<T> map;
+    std::vector<double> scales;
+    std::string rng;
+};
+
+
+// one array of a checkpoint file
+struct CheckpointSection {
+    const void* data;
+    uint64_t size;
+};
+
+
+// read-only memory mapping of a checkpoint file; every array is checked
+// against the size of the file before it is handed out
+class CheckpointFile {
+private:
+    void* addr_;
+    size_t size_;
+
+public:
+    CheckpointFile(const std::string& path, size_t headerSize) throw (std::string);
+    CheckpointFile(const CheckpointFile&) = delete;
+    auto operator=(const CheckpointFile&) -> CheckpointFile& = delete;
+    ~CheckpointFile();
+
+    auto bytes(uint64_t offset, uint64_t count, uint64_t elementSize) const throw (std::string) -> const char*;
+    template <typename U>
+    auto section(uint64_t offset, uint64_t count) const throw (std::string) -> const U*;
+};
+
+
+// a checkpoint of a KSOM, validated when it is opened
+class MappedCheckpoint {
+private:
+    const CheckpointFile file_;
+    const CheckpointHeader* header_;
+    const char* map_;
+    const double* scales_;
+    const char* rng_;
+
+public:
+    MappedCheckpoint(const std::string& path) throw (std::string);
+
+    auto header() const -> const CheckpointHeader&;
+    template <typename T>
+    auto map() const -> const T*;
+    auto scales() const -> const double*;
+    auto rng() const -> std::string;
+};
+
+
+inline auto alignCheckpointOffset(uint64_t offset) -> uint64_t
+{
+    return (offset + CHECKPOINT_ALIGNMENT - 1)/CHECKPOINT_ALIGNMENT*CHECKPOINT_ALIGNMENT;
+}
+
+
+// whether count elements of the given size at offset lie within a file of size bytes
+inline auto fitsCheckpoint(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size) -> bool
+{
+    return offset <= size && (elementSize == 0 || count <= (size - offset)/elementSize);
+}
+
+
+// offsets of the sections laid out one after the other behind a header
+inline auto layoutCheckpoint(uint64_t headerSize, const std::vector<CheckpointSection>& sections) -> std::vector<uint64_t>
+{
+    std::vector<uint64_t> offsets;
+    auto end = headerSize;
+    for ( const auto& section : sections ) {
+        offsets.push_back(alignCheckpointOffset(end));
+        end = offsets.back() + section.size;
+    }
+
+    return offsets;
+}
+
+
+// creates a temporary file of a unique name next to path, so that concurrent
+// writers to the same path never share it; nullptr when it cannot
+inline auto openTempFile(const std::string& path, std::string& tmpPath) -> std::FILE*
+{
+    std::vector<char> name(path.begin(), path.end());
+    const std::string suffix(".tmp.XXXXXX");
+    name.insert(name.end(), suffix.begin(), suffix.end());
+    name.push_back('\0');
+    const auto fd = mkstemp(name.data());
+    if ( fd < 0 ) {
+        return nullptr;
+    }
+
+    auto file = fdopen(fd, "wb");
+    if ( file == nullptr ) {
+        close(fd);
+        std::remove(name.data());
+        return nullptr;
+    }
+    tmpPath = name.data();
+
+    return file;
+}
+
+
+inline auto openCheckpointTemp(const std::string& path, std::string& tmpPath) throw (std::string) -> std::FILE*
+{
+    auto file = openTempFile(path, tmpPath);
+    if ( file == nullptr ) {
+        throw std::string("cannot open checkpoint file.");
+    }
+
+    return file;
+}
+
+
+// writes the header and the sections at their offsets, padded with zeros
+inline auto writeCheckpointFile(const std::string& path, const void* header, size_t headerSize,
+                                const std::vector<CheckpointSection>& sections,
+                                const std::vector<uint64_t>& offsets) throw (std::string) -> void
+{
+    // write next to the target and rename, so a crash never leaves a torn file
+    std::string tmpPath;
+    auto file = openCheckpointTemp(path, tmpPath);
+
+    const char padding[CHECKPOINT_ALIGNMENT] = {};
+    auto offset = static_cast<uint64_t>(0);
+    auto ok = true;
+    const auto put = [&](uint64_t at, const void* ptr, size_t size) {
+        ok = ok && std::fwrite(padding, 1, at - offset, file) == at - offset;
+        ok = ok && (size == 0 || std::fwrite(ptr, 1, size, file) == size);
+        offset = at + size;
+    };
+    put(0, header, headerSize);
+    for ( auto k = 0U; k < sections.size(); k++ ) {
+        put(offsets[k], sections[k].data, sections[k].size);
+    }
+    ok = std::fclose(file) == 0 && ok;
+
+    if ( !ok || std::rename(tmpPath.c_str(), path.c_str()) != 0 ) {
+        std::remove(tmpPath.c_str());
+        throw std::string("cannot write checkpoint file.");
+    }
+}
+
+
+template <typename T>
+auto writeCheckpoint(const std::string& path, CheckpointData<T>& data) throw (std::string) -> void
+{
+    const std::vector<CheckpointSection> sections = {
+        {data.map.data(), data.map.size()*sizeof(T)},
+        {data.scales.data(), data.scales.size()*sizeof(double)},
+        {data.rng.data(), data.rng.size()},
+    };
+    const auto offsets = layoutCheckpoint(sizeof(CheckpointHeader), sections);
+
+    auto& header = data.header;
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version      = CHECKPOINT_VERSION;
+    header.elementSize  = sizeof(T);
+    header.mapOffset    = offsets[0];
+    header.scalesOffset = offsets[1];
+    header.rngOffset    = offsets[2];
+    header.rngSize      = data.rng.size();
+    writeCheckpointFile(path, &header, sizeof(CheckpointHeader), sections, offsets);
+}
+
+
+inline CheckpointFile::CheckpointFile(const std::string& path, size_t headerSize) throw (std::string)
+    :addr_(MAP_FAILED)
+    ,size_(0)
+{
+    const auto fd = open(path.c_str(), O_RDONLY);
+    if ( fd < 0 ) {
+        throw std::string("cannot open checkpoint file.");
+    }
+
+    struct stat st;
+    if ( fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= headerSize ) {
+        size_ = st.st_size;
+        addr_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if ( addr_ == MAP_FAILED ) {
+        throw std::string("cannot map checkpoint file.");
+    }
+}
+
+
+inline CheckpointFile::~CheckpointFile()
+{
+    munmap(addr_, size_);
+}
+
+
+inline auto CheckpointFile::bytes(uint64_t offset, uint64_t count,
+                                    uint64_t elementSize) const throw (std::string) -> const char*
+{
+    if ( offset%CHECKPOINT_ALIGNMENT != 0 || !fitsCheckpoint(offset, count, elementSize, size_) ) {
+        throw std::string("invalid checkpoint file.");
+    }
+
+    return static_cast<const char*>(addr_) + offset;
+}
+
+
+template <typename U>
+auto CheckpointFile::section(uint64_t offset, uint64_t count) const throw (std::string) -> const U*
+{
+    return reinterpret_cast<const U*>(bytes(offset, count, sizeof(U)));
+}
+
+
+inline MappedCheckpoint::MappedCheckpoint(const std::string& path) throw (std::string)
+    :file_(path, sizeof(CheckpointHeader))
+    ,header_(file_.section<CheckpointHeader>(0, 1))
+    ,map_(nullptr)
+    ,scales_(nullptr)
+    ,rng_(nullptr)
+{
+    // every array that restoring reads must lie within the file
+    const auto& h = *header_;
+    if ( std::memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0 || h.version != CHECKPOINT_VERSION
+            || h.rows <= 0 || h.cols <= 0 || h.dimension <= 0 || h.elementSize == 0 ) {
+        throw std::string("invalid checkpoint file.");
+    }
+    const auto neurons = static_cast<uint64_t>(h.rows)*static_cast<uint64_t>(h.cols);
+    map_ = file_.bytes(h.mapOffset, neurons*h.dimension, h.elementSize);
+    if ( h.sparse != 0 ) {
+        scales_ = file_.section<double>(h.scalesOffset, neurons);
+    }
+    rng_ = file_.section<char>(h.rngOffset, h.rngSize);
+}
+
+
+inline auto MappedCheckpoint::header() const -> const CheckpointHeader&
+{
+    return *header_;
+}
+
+
+template <typename T>
+auto MappedCheckpoint::map() const -> const T*
+{
+    return reinterpret_cast<const T*>(map_);
+}
+
+
+inline auto MappedCheckpoint::scales() const -> const double*
+{
+    return scales_;
+}
+
+
+inline auto MappedCheckpoint::rng() const -> std::string
+{
+    return std::string(rng_, header_->rngSize);
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,624 @@
+#ifndef KG_DATASET_H
+#define KG_DATASET_H
+
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "node.hpp"
+
+
+namespace kg {
+
+
+namespace {
+    constexpr size_t DATASET_ALIGNMENT = 64;
+    constexpr auto DATASET_CHUNKS_PER_THREAD = 4;
+};
+
+
+// per-dimension minimum, maximum and mean of a dataset
+struct DatasetStatistics {
+    std::vector<double> min;
+    std::vector<double> max;
+    std::vector<double> mean;
+};
+
+
+// delimiter 0 detects tab, comma or space from the first line
+struct LoadOptions {
+    char delimiter;
+    bool header;
+    bool statistics;
+};
+
+
+// Input vectors in one contiguous buffer. The buffer starts on a cache line
+// and every row is padded to a whole number of cache lines, so rows never
+// share a line and are aligned for vector loads.
+template <typename T>
+class Dataset {
+private:
+    struct Free {
+        auto operator()(T* ptr) const -> void { std::free(ptr); }
+    };
+
+    int rows_;
+    int dimension_;
+    int stride_;
+    std::unique_ptr<T, Free> elems_;
+    DatasetStatistics statistics_;
+
+public:
+    Dataset(int rows=0, int dimension=0) throw (std::string);
+    Dataset(Dataset&&) = default;
+    auto operator=(Dataset&&) -> Dataset& = default;
+
+    auto rows() const -> int;
+    auto dimension() const -> int;
+    auto stride() const -> int;
+    auto row(int k) const -> T*;
+    auto hasStatistics() const -> bool;
+    auto statistics() const -> const DatasetStatistics&;
+    auto computeStatistics() -> void;
+    auto setStatistics(const DatasetStatistics& statistics) -> void;
+    auto toNodes() const -> std::vector<Node<T>>;
+};
+
+
+// a dataset together with nodes that refer to its rows
+template <typename T>
+struct SharedDataset {
+    Dataset<T> dataset;
+    std::vector<Node<T>> nodes;
+};
+
+
+// read-only memory mapping of a whole file
+class MappedFile {
+private:
+    void* addr_;
+    size_t size_;
+
+public:
+    MappedFile(const std::string& path) throw (std::string);
+    MappedFile(const MappedFile&) = delete;
+    auto operator=(const MappedFile&) -> MappedFile& = delete;
+    ~MappedFile();
+
+    auto data() const -> const char*;
+    auto size() const -> size_t;
+};
+
+
+// running minimum, maximum and sum of the rows seen by one chunk
+class StatisticsAccumulator {
+private:
+    std::vector<double> min_;
+    std::vector<double> max_;
+    std::vector<double> sum_;
+
+public:
+    StatisticsAccumulator(int dimension=0);
+
+    template <typename T>
+    auto add(const T* row) -> void;
+    auto merge(const StatisticsAccumulator& rhs) -> void;
+    auto result(int rows) const -> DatasetStatistics;
+};
+
+
+inline auto datasetThreads() -> int
+{
+    #ifdef _OPENMP
+    return omp_get_max_threads();
+    #else
+    return 1;
+    #endif
+}
+
+
+template <typename T>
+Dataset<T>::Dataset(int rows, int dimension) throw (std::string)
+    :rows_(rows)
+    ,dimension_(dimension)
+    ,stride_(0)
+{
+    if ( rows_ < 0 || dimension_ < 0 ) {
+        throw std::string("size of dataset must not be negative.");
+    }
+
+    const auto rowBytes = (sizeof(T)*dimension_ + DATASET_ALIGNMENT - 1)/DATASET_ALIGNMENT*DATASET_ALIGNMENT;
+    stride_ = rowBytes/sizeof(T);
+
+    const auto bytes = std::max(rowBytes*rows_, DATASET_ALIGNMENT);
+    void* ptr = nullptr;
+    if ( posix_memalign(&ptr, DATASET_ALIGNMENT, bytes) != 0 ) {
+        throw std::string("cannot allocate dataset.");
+    }
+    elems_.reset(static_cast<T*>(ptr));
+}
+
+
+template <typename T>
+auto Dataset<T>::rows() const -> int
+{
+    return rows_;
+}
+
+
+template <typename T>
+auto Dataset<T>::dimension() const -> int
+{
+    return dimension_;
+}
+
+
+template <typename T>
+auto Dataset<T>::stride() const -> int
+{
+    return stride_;
+}
+
+
+template <typename T>
+auto Dataset<T>::row(int k) const -> T*
+{
+    return elems_.get() + static_cast<size_t>(k)*stride_;
+}
+
+
+template <typename T>
+auto Dataset<T>::hasStatistics() const -> bool
+{
+    return !statistics_.mean.empty();
+}
+
+
+template <typename T>
+auto Dataset<T>::statistics() const -> const DatasetStatistics&
+{
+    return statistics_;
+}
+
+
+template <typename T>
+auto Dataset<T>::computeStatistics() -> void
+{
+    const auto chunks = std::max(1, std::min(rows_, datasetThreads()*DATASET_CHUNKS_PER_THREAD));
+    std::vector<StatisticsAccumulator> partial(chunks, StatisticsAccumulator(dimension_));
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for ( auto k = 0; k < chunks; k++ ) {
+        const auto end = static_cast<long long>(rows_)*(k + 1)/chunks;
+        for ( auto r = static_cast<long long>(rows_)*k/chunks; r < end; r++ ) {
+            partial[k].add(row(r));
+        }
+    }
+
+    for ( auto k = 1; k < chunks; k++ ) {
+        partial[0].merge(partial[k]);
+    }
+    statistics_ = partial[0].result(rows_);
+}
+
+
+template <typename T>
+auto Dataset<T>::setStatistics(const DatasetStatistics& statistics) -> void
+{
+    statistics_ = statistics;
+}
+
+
+template <typename T>
+auto Dataset<T>::toNodes() const -> std::vector<Node<T>>
+{
+    std::vector<Node<T>> nodes(rows_, Node<T>(dimension_));
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for ( auto r = 0; r < rows_; r++ ) {
+        std::memcpy(nodes[r].data(), row(r), sizeof(T)*dimension_);
+    }
+
+    return nodes;
+}
+
+
+// The rows of dataset as input of KSOM without copying them. The nodes refer
+// to the rows in the buffer of the dataset, which the returned pointer owns.
+template <typename T>
+auto shareDataset(Dataset<T>&& dataset) -> std::shared_ptr<const std::vector<Node<T>>>
+{
+    const auto shared = std::make_shared<SharedDataset<T>>();
+    shared->dataset = std::move(dataset);
+    shared->nodes.reserve(shared->dataset.rows());
+    for ( auto r = 0; r < shared->dataset.rows(); r++ ) {
+        shared->nodes.emplace_back(shared->dataset.row(r), shared->dataset.dimension());
+    }
+
+    return std::shared_ptr<const std::vector<Node<T>>>(shared, &shared->nodes);
+}
+
+
+inline MappedFile::MappedFile(const std::string& path) throw (std::string)
+    :addr_(nullptr)
+    ,size_(0)
+{
+    const auto fd = open(path.c_str(), O_RDONLY);
+    if ( fd < 0 ) {
+        throw std::string("cannot open dataset file.");
+    }
+
+    struct stat st;
+    auto ok = fstat(fd, &st) == 0;
+    if ( ok && st.st_size > 0 ) {
+        size_ = st.st_size;
+        addr_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = addr_ != MAP_FAILED;
+        if ( ok ) {
+            madvise(addr_, size_, MADV_SEQUENTIAL);
+        } else {
+            addr_ = nullptr;
+        }
+    }
+    close(fd);
+    if ( !ok ) {
+        throw std::string("cannot map dataset file.");
+    }
+}
+
+
+inline MappedFile::~MappedFile()
+{
+    if ( addr_ != nullptr ) {
+        munmap(addr_, size_);
+    }
+}
+
+
+inline auto MappedFile::data() const -> const char*
+{
+    return static_cast<const char*>(addr_);
+}
+
+
+inline auto MappedFile::size() const -> size_t
+{
+    return size_;
+}
+
+
+inline StatisticsAccumulator::StatisticsAccumulator(int dimension)
+    :min_(dimension, std::numeric_limits<double>::infinity())
+    ,max_(dimension, -std::numeric_limits<double>::infinity())
+    ,sum_(dimension, 0.0)
+{
+}
+
+
+template <typename T>
+auto StatisticsAccumulator::add(const T* row) -> void
+{
+    for ( auto i = 0U; i < sum_.size(); i++ ) {
+        const auto value = static_cast<double>(row[i]);
+        min_[i] = std::min(min_[i], value);
+        max_[i] = std::max(max_[i], value);
+        sum_[i] += value;
+    }
+}
+
+
+inline auto StatisticsAccumulator::merge(const StatisticsAccumulator& rhs) -> void
+{
+    for ( auto i = 0U; i < sum_.size(); i++ ) {
+        min_[i] = std::min(min_[i], rhs.min_[i]);
+        max_[i] = std::max(max_[i], rhs.max_[i]);
+        sum_[i] += rhs.sum_[i];
+    }
+}
+
+
+inline auto StatisticsAccumulator::result(int rows) const -> DatasetStatistics
+{
+    DatasetStatistics statistics = {min_, max_, sum_};
+    for ( auto& mean : statistics.mean ) {
+        mean = rows > 0 ? mean/rows : 0.0;
+    }
+
+    return statistics;
+}
+
+
+// Parses a decimal number such as -12, 3.25 or 1.5e-3 and advances p.
+// Up to 19 significant digits are kept; values with at most 15 digits and
+// an exponent within +-22 are exact, others within a few ulps.
+inline auto parseNumber(const char*& p, const char* end, double& value) -> bool
+{
+    static const double POWERS[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    auto negative = false;
+    if ( p < end && (*p == '-' || *p == '+') ) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    auto digits = 0, significant = 0, exponent = 0;
+    for ( ; p < end && *p >= '0' && *p <= '9'; p++, digits++ ) {
+        if ( significant < 19 ) {
+            mantissa = mantissa*10 + (*p - '0');
+            significant += mantissa > 0 ? 1 : 0;
+        } else {
+            ++exponent;
+        }
+    }
+    if ( p < end && *p == '.' ) {
+        for ( ++p; p < end && *p >= '0' && *p <= '9'; p++, digits++ ) {
+            if ( significant < 19 ) {
+                mantissa = mantissa*10 + (*p - '0');
+                significant += mantissa > 0 ? 1 : 0;
+                --exponent;
+            }
+        }
+    }
+    if ( digits == 0 ) {
+        return false;
+    }
+
+    if ( p < end && (*p == 'e' || *p == 'E') ) {
+        const auto q = p;
+        ++p;
+        auto negativeExponent = false;
+        if ( p < end && (*p == '-' || *p == '+') ) {
+            negativeExponent = *p == '-';
+            ++p;
+        }
+        if ( p == end || *p < '0' || *p > '9' ) {
+            p = q;
+        } else {
+            auto e = 0;
+            for ( ; p < end && *p >= '0' && *p <= '9'; p++ ) {
+                e = std::min(e*10 + (*p - '0'), 100000);
+            }
+            exponent += negativeExponent ? -e : e;
+        }
+    }
+
+    value = static_cast<double>(mantissa);
+    if ( exponent < 0 && exponent >= -22 ) {
+        value /= POWERS[-exponent];
+    } else if ( exponent > 0 && exponent <= 22 ) {
+        value *= POWERS[exponent];
+    } else if ( exponent != 0 && mantissa != 0 ) {
+        value *= std::pow(10.0, exponent);
+    }
+    value = negative ? -value : value;
+
+    return true;
+}
+
+
+// Parses the fields of one line into row and moves p past the line.
+// Returns the number of fields, or -1 on a malformed field.
+template <typename T>
+auto parseLine(const char*& p, const char* end, char delimiter, int dimension, T* row) -> int
+{
+    auto fields = 0;
+    while ( true ) {
+        while ( p < end && (*p == ' ' || (*p == '\t' && delimiter != '\t')) ) {
+            ++p;
+        }
+        if ( p == end || *p == '\n' || *p == '\r' ) {
+            break;
+        }
+
+        double value;
+        if ( !parseNumber(p, end, value) ) {
+            fields = -1;
+            break;
+        }
+        if ( fields < dimension ) {
+            row[fields] = static_cast<T>(value);
+        }
+        ++fields;
+
+        while ( p < end && (*p == ' ' || (*p == '\t' && delimiter != '\t')) ) {
+            ++p;
+        }
+        if ( p < end && *p == delimiter && delimiter != ' ' ) {
+            ++p;
+        }
+    }
+
+    while ( p < end && *p != '\n' ) {
+        ++p;
+    }
+    if ( p < end ) {
+        ++p;
+    }
+
+    return fields;
+}
+
+
+inline auto isBlankLine(const char* p, const char* end) -> bool
+{
+    for ( ; p < end && *p != '\n'; p++ ) {
+        if ( *p != ' ' && *p != '\t' && *p != '\r' ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+inline auto nextLine(const char* p, const char* end) -> const char*
+{
+    const auto newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return newline == nullptr ? end : newline + 1;
+}
+
+
+// Loads a CSV/TSV file of numbers, one input vector per line, in parallel:
+// the file is mapped, cut into chunks at line breaks, the lines of every
+// chunk are counted, and then every chunk is parsed straight into its rows.
+template <typename T>
+auto loadCSV(const std::string& path, const LoadOptions& options={0, false, false}) throw (std::string) -> Dataset<T>
+{
+    const MappedFile file(path);
+    auto begin = file.data();
+    const auto end = file.data() + file.size();
+    if ( options.header && begin != end ) {
+        begin = nextLine(begin, end);
+    }
+    while ( begin != end && isBlankLine(begin, end) ) {
+        begin = nextLine(begin, end);
+    }
+    if ( begin == end ) {
+        throw std::string("dataset file is empty.");
+    }
+
+    // the first line decides the delimiter and the dimension
+    const auto firstEnd = nextLine(begin, end);
+    auto delimiter = options.delimiter;
+    if ( delimiter == 0 ) {
+        delimiter = std::find(begin, firstEnd, '\t') != firstEnd ? '\t'
+                    : std::find(begin, firstEnd, ',') != firstEnd ? ',' : ' ';
+    }
+    std::vector<double> first(firstEnd - begin);
+    auto p = begin;
+    const auto dimension = parseLine(p, end, delimiter, first.size(), first.data());
+    if ( dimension <= 0 ) {
+        throw std::string("invalid line in dataset file.");
+    }
+
+    const auto size     = static_cast<size_t>(end - begin);
+    const auto chunks   = static_cast<int>(std::max<size_t>(1, std::min<size_t>(size/4096 + 1,
+                                                datasetThreads()*DATASET_CHUNKS_PER_THREAD)));
+    std::vector<const char*> bounds(chunks + 1, end);
+    bounds[0] = begin;
+    for ( auto k = 1; k < chunks; k++ ) {
+        bounds[k] = std::max(bounds[k - 1], nextLine(begin + size*k/chunks - 1, end));
+    }
+
+    std::vector<long long> offsets(chunks + 1, 0);
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for ( auto k = 0; k < chunks; k++ ) {
+        auto lines = 0LL;
+        for ( auto line = bounds[k]; line < bounds[k + 1]; line = nextLine(line, bounds[k + 1]) ) {
+            lines += isBlankLine(line, bounds[k + 1]) ? 0 : 1;
+        }
+        offsets[k + 1] = lines;
+    }
+    for ( auto k = 0; k < chunks; k++ ) {
+        offsets[k + 1] += offsets[k];
+    }
+    if ( offsets[chunks] > std::numeric_limits<int>::max() ) {
+        throw std::string("dataset file has too many lines.");
+    }
+
+    Dataset<T> dataset(offsets[chunks], dimension);
+    std::vector<StatisticsAccumulator> partial(options.statistics ? chunks : 0, StatisticsAccumulator(dimension));
+    auto malformed = false;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(||:malformed)
+    #endif
+    for ( auto k = 0; k < chunks; k++ ) {
+        auto r = offsets[k];
+        for ( auto line = bounds[k]; line < bounds[k + 1] && !malformed; ) {
+            if ( isBlankLine(line, bounds[k + 1]) ) {
+                line = nextLine(line, bounds[k + 1]);
+                continue;
+            }
+            const auto row = dataset.row(r++);
+            malformed = parseLine(line, bounds[k + 1], delimiter, dimension, row) != dimension;
+            if ( options.statistics ) {
+                partial[k].add(row);
+            }
+        }
+    }
+    if ( malformed ) {
+        throw std::string("invalid line in dataset file.");
+    }
+
+    if ( options.statistics ) {
+        for ( auto k = 1; k < chunks; k++ ) {
+            partial[0].merge(partial[k]);
+        }
+        dataset.setStatistics(partial[0].result(dataset.rows()));
+    }
+
+    return dataset;
+}
+
+
+// Loads a raw file of dimension-sized rows of T in host byte order.
+template <typename T>
+auto loadBinary(const std::string& path, int dimension, bool statistics=false) throw (std::string) -> Dataset<T>
+{
+    if ( dimension <= 0 ) {
+        throw std::string("dimension must be positive.");
+    }
+
+    const MappedFile file(path);
+    const auto rowBytes = sizeof(T)*dimension;
+    if ( file.size() == 0 || file.size()%rowBytes != 0 ) {
+        throw std::string("size of dataset file does not match dimension.");
+    }
+    if ( file.size()/rowBytes > static_cast<size_t>(std::numeric_limits<int>::max()) ) {
+        throw std::string("dataset file has too many rows.");
+    }
+
+    Dataset<T> dataset(file.size()/rowBytes, dimension);
+    const auto rows     = dataset.rows();
+    const auto chunks   = std::max(1, std::min(rows, datasetThreads()*DATASET_CHUNKS_PER_THREAD));
+    std::vector<StatisticsAccumulator> partial(statistics ? chunks : 0, StatisticsAccumulator(dimension));
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for ( auto k = 0; k < chunks; k++ ) {
+        const auto end = static_cast<long long>(rows)*(k + 1)/chunks;
+        for ( auto r = static_cast<long long>(rows)*k/chunks; r < end; r++ ) {
+            std::memcpy(dataset.row(r), file.data() + r*rowBytes, rowBytes);
+            if ( statistics ) {
+                partial[k].add(dataset.row(r));
+            }
+        }
+    }
+
+    if ( statistics ) {
+        for ( auto k = 1; k < chunks; k++ ) {
+            partial[0].merge(partial[k]);
+        }
+        dataset.setStatistics(partial[0].result(rows));
+    }
+
+    return dataset;
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef KG_DEDUPLICATE_H
+#define KG_DEDUPLICATE_H
+
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include "node.hpp"
+
+
+namespace kg {
+
+
+// distinct input vectors in order of first appearance, with how often each appeared
+template <typename T>
+struct Deduplicated {
+    std::vector<Node<T>> nodes;
+    std::vector<int> counts;
+
+    auto weights() const -> std::vector<double>;
+};
+
+
+template <typename T>
+auto Deduplicated<T>::weights() const -> std::vector<double>
+{
+    return std::vector<double>(counts.begin(), counts.end());
+}
+
+
+template <typename T>
+auto hashNode(const Node<T>& node) -> uint64_t
+{
+    // FNV-1a over the bytes of the elements
+    const auto bytes = reinterpret_cast<const unsigned char*>(node.data());
+    auto hash = static_cast<uint64_t>(14695981039346656037ULL);
+    for ( auto i = 0U; i < sizeof(T)*node.size(); i++ ) {
+        hash = (hash^bytes[i])*1099511628211ULL;
+    }
+
+    return hash;
+}
+
+
+// Merges bitwise identical input vectors. Hashes are computed in parallel;
+// vectors with equal hashes are compared in full before being merged.
+template <typename T>
+auto deduplicate(const std::vector<Node<T>>& src) throw (std::string) -> Deduplicated<T>
+{
+    const auto length = static_cast<int>(src.size());
+    for ( const auto& node : src ) {
+        if ( node.size() != src[0].size() ) {
+            throw std::string("dimension of source node is different.");
+        }
+    }
+
+    std::vector<uint64_t> hashes(length);
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for ( auto k = 0; k < length; k++ ) {
+        hashes[k] = hashNode(src[k]);
+    }
+
+    // heads maps a hash to its first unique vector; next chains the others
+    Deduplicated<T> result;
+    std::unordered_map<uint64_t, int> heads(length);
+    std::vector<int> sources, next;
+    for ( auto k = 0; k < length; k++ ) {
+        const auto bytes = sizeof(T)*src[k].size();
+        const auto head  = heads.find(hashes[k]);
+        auto u = head == heads.end() ? -1 : head->second;
+        while ( u >= 0 && std::memcmp(src[sources[u]].data(), src[k].data(), bytes) != 0 ) {
+            u = next[u];
+        }
+
+        if ( u >= 0 ) {
+            ++result.counts[u];
+            continue;
+        }
+        next.push_back(head == heads.end() ? -1 : head->second);
+        heads[hashes[k]] = sources.size();
+        sources.push_back(k);
+        result.counts.push_back(1);
+    }
+
+    for ( const auto k : sources ) {
+        result.nodes.push_back(src[k]);
+    }
+
+    return result;
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,698 @@
+#ifndef KG_INCREMENTAL_KSOM_H
+#define KG_INCREMENTAL_KSOM_H
+
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "node.hpp"
+#include "metric.hpp"
+#include "topology.hpp"
+#include "checkpoint.hpp"
+#include "batch_update.hpp"
+
+
+namespace kg {
+
+
+namespace {
+    constexpr char INCREMENTAL_MAGIC[8] = {'K', 'S', 'O', 'M', 'I', 'N', 'C', 'R'};
+    constexpr uint32_t INCREMENTAL_VERSION = 2;
+    constexpr auto INCREMENTAL_MAX_EPOCHS = 100;
+};
+
+
+// Binary state of an IncrementalKSOM in host byte order: the header, then
+// every array on a CHECKPOINT_ALIGNMENT boundary at its offset. The samples
+// themselves are not part of it.
+struct IncrementalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t elementSize;
+    int32_t rows;
+    int32_t cols;
+    int32_t dimension;
+    int32_t reserved;
+    int64_t length;
+    double sigma;
+    double errorSum;
+    double weightSum;
+    uint64_t mapOffset;
+    uint64_t anchorsOffset;
+    uint64_t weightsOffset;
+    uint64_t bmusOffset;
+    uint64_t distancesOffset;
+    uint64_t sumsOffset;
+    uint64_t countsOffset;
+    uint64_t radiiOffset;
+    uint64_t touchedOffset;
+};
+
+
+// Batch SOM with a fixed sigma over input that grows by appending. Every
+// sample keeps its BMU and the distance to it, and every neuron the samples
+// it won with their weighted sum and total weight, which is all the batch
+// update needs. refresh() searches the BMUs of new samples, of the samples
+// of neurons that moved by more than the threshold since their samples were
+// last checked, and of the samples such a neuron may have taken from an
+// unmoved one; it then recomputes only the model vectors near neurons whose
+// sums changed. The cost follows the change, not the number of samples.
+// Samples of unmoved neurons are skipped by the triangle inequality, so with
+// a threshold of 0 the result is that of a full batch SOM for any Metric
+// whose distance() is a true metric (not CosineMetric). Appended input is
+// shared with the caller, as the input of KSOM, rather than copied.
+template <typename T, typename Metric=EuclideanMetric, typename Topology=RectangularTopology>
+class IncrementalKSOM {
+public:
+    using Position = std::tuple<int, int>;
+
+    struct RefreshStats {
+        int epochs;
+        long long searches;
+        long long distances;
+        long long movedNeurons;
+        long long updatedNeurons;
+    };
+
+private:
+    using Map = std::vector<std::vector<Node<T>>>;
+
+    Map map_;
+    const int rows_;
+    const int cols_;
+    const int dimension_;
+    double sigma_;
+    const double threshold_;
+
+    Metric metric_;
+    Topology topology_;
+
+    // every appended input, and the row of every sample in them
+    std::vector<std::shared_ptr<const std::vector<Node<T>>>> inputs_;
+    std::vector<const T*> samples_;
+    std::vector<double> weights_;
+
+    // BMU of every sample and the distance to it when it was found; samples
+    // from searched_ on have been appended but not searched yet
+    std::vector<int> bmus_;
+    std::vector<double> distances_;
+    int searched_;
+
+    // members_[n] are the samples of neuron n in no particular order, and
+    // slots_[idx] is the position of sample idx in the list of its BMU
+    std::vector<std::vector<int>> members_;
+    std::vector<int> slots_;
+
+    // weighted sums of the samples of every neuron, their total weight, and
+    // an upper bound of the distance from the neuron to its samples
+    std::vector<double> sums_;
+    std::vector<double> counts_;
+    std::vector<double> radii_;
+    double errorSum_;
+    double weightSum_;
+
+    // model vectors as of the last check of their samples
+    std::vector<T> anchors_;
+
+    // neurons whose sums changed since the model vectors were last formed
+    std::vector<char> touched_;
+    std::vector<int> touchedNeurons_;
+
+private:
+    inline static auto checkMap(const Map& map) throw (std::string) -> const Map&;
+    inline auto calcDistance(const T* x, int n) const -> double;
+    inline auto touch(int n) -> void;
+    inline auto assign(int idx, int bmu, double distance) -> void;
+    inline auto searchPending(RefreshStats& stats) -> void;
+    inline auto updateModels(RefreshStats& stats) -> std::vector<int>;
+    inline auto reassign(const std::vector<int>& moved, RefreshStats& stats) -> void;
+
+public:
+    IncrementalKSOM(const Map& map, double sigma, double threshold=0.0,
+                    const Metric& metric=Metric(), const Topology& topology=Topology()) throw (std::string);
+    ~IncrementalKSOM();
+
+    auto append(const std::vector<Node<T>>& samples,
+                const std::vector<double>& weights=std::vector<double>()) throw (std::string) -> void;
+    auto append(const std::shared_ptr<const std::vector<Node<T>>>& samples,
+                const std::vector<double>& weights=std::vector<double>()) throw (std::string) -> void;
+    auto refresh(int maxEpochs=INCREMENTAL_MAX_EPOCHS) -> RefreshStats;
+    auto length() const -> int;
+    auto map() const -> Map;
+    auto bmu(int idx) const throw (std::string) -> Position;
+    auto quantizationError() const -> double;
+    auto checkpoint(const std::string& path) const throw (std::string) -> void;
+    auto restore(const std::string& path) throw (std::string) -> void;
+};
+
+
+template <typename T, typename Metric, typename Topology>
+IncrementalKSOM<T, Metric, Topology>::IncrementalKSOM(const Map& map, double sigma, double threshold,
+                                                        const Metric& metric, const Topology& topology) throw (std::string)
+    :map_(checkMap(map))
+    ,rows_(map_.size())
+    ,cols_(map_[0].size())
+    ,dimension_(map_[0][0].size())
+    ,sigma_(sigma)
+    ,threshold_(threshold)
+    ,metric_(metric)
+    ,topology_(topology)
+    ,searched_(0)
+    ,members_(rows_*cols_)
+    ,sums_(static_cast<size_t>(rows_)*cols_*dimension_, 0.0)
+    ,counts_(rows_*cols_, 0.0)
+    ,radii_(rows_*cols_, 0.0)
+    ,errorSum_(0.0)
+    ,weightSum_(0.0)
+    ,touched_(rows_*cols_, 0)
+{
+    if ( !(sigma > 0.0) ) {
+        throw std::string("sigma must be positive.");
+    }
+    if ( !(threshold >= 0.0) ) {
+        throw std::string("threshold must not be negative.");
+    }
+    for ( const auto& row : map_ ) {
+        if ( static_cast<int>(row.size()) != cols_ ) {
+            throw std::string("number of columns in map is different.");
+        }
+        for ( const auto& node : row ) {
+            if ( node.size() != dimension_ ) {
+                throw std::string("dimension of map node is different.");
+            }
+            anchors_.insert(anchors_.end(), node.data(), node.data() + dimension_);
+        }
+    }
+    metric_.prepare(map_, dimension_);
+    topology_.prepare(rows_, cols_);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+IncrementalKSOM<T, Metric, Topology>::~IncrementalKSOM()
+{
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::checkMap(const Map& map) throw (std::string) -> const Map&
+{
+    if ( map.empty() || map[0].empty() ) {
+        throw std::string("map is empty.");
+    }
+
+    return map;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::calcDistance(const T* x, int n) const -> double
+{
+    return metric_.distance(x, map_[n/cols_][n%cols_].data(), dimension_);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::touch(int n) -> void
+{
+    if ( !touched_[n] ) {
+        touched_[n] = 1;
+        touchedNeurons_.push_back(n);
+    }
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::assign(int idx, int bmu, double distance) -> void
+{
+    // moves sample idx to bmu, keeping the sums and the error in step
+    const auto weight   = weights_[idx];
+    const auto old      = bmus_[idx];
+    if ( old < 0 ) {
+        weightSum_ += weight;
+        errorSum_ += weight*distance;
+    } else {
+        errorSum_ += weight*(distance - distances_[idx]);
+    }
+    distances_[idx] = distance;
+    radii_[bmu]     = std::max(radii_[bmu], distance);
+    if ( old == bmu ) {
+        return;
+    }
+
+    const auto x = samples_[idx];
+    if ( old >= 0 ) {
+        auto& members = members_[old];
+        members[slots_[idx]]            = members.back();
+        slots_[members.back()]          = slots_[idx];
+        members.pop_back();
+        const auto sum = &sums_[static_cast<size_t>(old)*dimension_];
+        if ( members.empty() ) {
+            // exactly zero, rather than what is left after the subtractions
+            std::fill(sum, sum + dimension_, 0.0);
+            counts_[old] = 0.0;
+            radii_[old] = 0.0;
+        } else {
+            for ( auto i = 0; i < dimension_; i++ ) {
+                sum[i] -= weight*x[i];
+            }
+            counts_[old] -= weight;
+        }
+        touch(old);
+    }
+
+    slots_[idx] = members_[bmu].size();
+    members_[bmu].push_back(idx);
+    const auto sum = &sums_[static_cast<size_t>(bmu)*dimension_];
+    for ( auto i = 0; i < dimension_; i++ ) {
+        sum[i] += weight*x[i];
+    }
+    counts_[bmu] += weight;
+    bmus_[idx] = bmu;
+    touch(bmu);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::searchPending(RefreshStats& stats) -> void
+{
+    // exhaustive search of the samples appended since the last refresh
+    const auto first    = searched_;
+    const auto length   = static_cast<int>(samples_.size());
+    const auto neurons  = rows_*cols_;
+    std::vector<int> found(length - first);
+    std::vector<double> distances(length - first);
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 64)
+    #endif
+    for ( auto idx = first; idx < length; idx++ ) {
+        const auto x = samples_[idx];
+        auto minDis = std::numeric_limits<double>::max();
+        auto minIdx = 0;
+        for ( auto n = 0; n < neurons; n++ ) {
+            const auto dis = calcDistance(x, n);
+            if ( dis < minDis ) {
+                minDis = dis;
+                minIdx = n;
+            }
+        }
+        found[idx - first]      = minIdx;
+        distances[idx - first]  = minDis;
+    }
+
+    for ( auto idx = first; idx < length; idx++ ) {
+        assign(idx, found[idx - first], distances[idx - first]);
+    }
+    searched_ = length;
+    stats.searches  += length - first;
+    stats.distances += static_cast<long long>(length - first)*neurons;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::updateModels(RefreshStats& stats) -> std::vector<int>
+{
+    // every model vector within the neighborhood of a touched neuron is
+    // formed again from the sums of the neurons with samples
+    const auto neurons  = rows_*cols_;
+    const auto reach    = batchReach(sigma_);
+    std::vector<char> dirty(neurons, 0);
+    for ( const auto b : touchedNeurons_ ) {
+        touched_[b] = 0;
+        for ( auto r = 0; r < rows_; r++ ) {
+            const auto sqDistances = topology_.row(b/cols_, b%cols_, r);
+            for ( auto c = 0; c < cols_; c++ ) {
+                if ( sqDistances[c] <= reach ) {
+                    dirty[r*cols_ + c] = 1;
+                }
+            }
+        }
+    }
+    touchedNeurons_.clear();
+
+    std::vector<int> updated, hits;
+    std::vector<std::vector<int>> columns(rows_);
+    for ( auto n = 0; n < neurons; n++ ) {
+        if ( dirty[n] ) {
+            updated.push_back(n);
+            columns[n/cols_].push_back(n%cols_);
+        }
+        if ( counts_[n] > 0.0 ) {
+            hits.push_back(n);
+        }
+    }
+
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 1)
+    #endif
+    for ( auto r = 0; r < rows_; r++ ) {
+        if ( !columns[r].empty() ) {
+            batchUpdateRow(map_[r], r, columns[r], sigma_, hits, sums_.data(), counts_.data(), topology_, metric_);
+        }
+    }
+    stats.updatedNeurons += updated.size();
+
+    return updated;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::reassign(const std::vector<int>& moved, RefreshStats& stats) -> void
+{
+    // The samples of a moved neuron are searched against the whole map. A
+    // sample x of an unmoved neuron b can only go to a moved neuron m, and
+    // only if d(x, b) > d(b, m)/2, as d(x, m) >= d(b, m) - d(x, b).
+    const auto neurons = rows_*cols_;
+    std::vector<char> isMoved(neurons, 0);
+    for ( const auto m : moved ) {
+        isMoved[m] = 1;
+    }
+
+    std::vector<double> halves(neurons, std::numeric_limits<double>::max());
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 16)
+    #endif
+    for ( auto b = 0; b < neurons; b++ ) {
+        if ( isMoved[b] || members_[b].empty() ) {
+            continue;
+        }
+        const auto w = map_[b/cols_][b%cols_].data();
+        for ( const auto m : moved ) {
+            halves[b] = std::min(halves[b], calcDistance(w, m)/2.0);
+        }
+    }
+
+    std::vector<int> queue;
+    auto partial = 0LL;
+    for ( auto n = 0; n < neurons; n++ ) {
+        if ( isMoved[n] ) {
+            queue.insert(queue.end(), members_[n].begin(), members_[n].end());
+            stats.distances += static_cast<long long>(neurons)*members_[n].size();
+        } else if ( !members_[n].empty() ) {
+            stats.distances += moved.size();
+            if ( radii_[n] > halves[n] ) {
+                for ( const auto idx : members_[n] ) {
+                    if ( distances_[idx] > halves[n] ) {
+                        queue.push_back(idx);
+                        ++partial;
+                    }
+                }
+            }
+        }
+    }
+    stats.distances += partial*(moved.size() + 1);
+    // the order of the queue only depends on the lists, so the sums do not depend on the threads
+    std::vector<int> found(queue.size());
+    std::vector<double> distances(queue.size());
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 64)
+    #endif
+    for ( auto k = 0; k < static_cast<int>(queue.size()); k++ ) {
+        const auto idx  = queue[k];
+        const auto x    = samples_[idx];
+        const auto b    = bmus_[idx];
+        auto minDis = std::numeric_limits<double>::max();
+        auto minIdx = 0;
+        if ( isMoved[b] ) {
+            for ( auto n = 0; n < neurons; n++ ) {
+                const auto dis = calcDistance(x, n);
+                if ( dis < minDis ) {
+                    minDis = dis;
+                    minIdx = n;
+                }
+            }
+        } else {
+            // the smallest index wins ties, as in the exhaustive search
+            minDis = calcDistance(x, b);
+            minIdx = b;
+            for ( const auto m : moved ) {
+                const auto dis = calcDistance(x, m);
+                if ( dis < minDis || (dis == minDis && m < minIdx) ) {
+                    minDis = dis;
+                    minIdx = m;
+                }
+            }
+        }
+        found[k]        = minIdx;
+        distances[k]    = minDis;
+    }
+
+    for ( const auto m : moved ) {
+        radii_[m] = 0.0;
+    }
+    for ( auto k = 0; k < static_cast<int>(queue.size()); k++ ) {
+        assign(queue[k], found[k], distances[k]);
+    }
+    stats.searches += queue.size();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::append(const std::vector<Node<T>>& samples,
+                                                    const std::vector<double>& weights) throw (std::string) -> void
+{
+    append(std::make_shared<const std::vector<Node<T>>>(samples), weights);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::append(const std::shared_ptr<const std::vector<Node<T>>>& input,
+                                                    const std::vector<double>& weights) throw (std::string) -> void
+{
+    // the samples are only searched by the next refresh(); input must not change afterwards
+    const auto& samples = *input;
+    if ( !weights.empty() && weights.size() != samples.size() ) {
+        throw std::string("number of weights is different from number of samples.");
+    }
+    for ( const auto& node : samples ) {
+        if ( node.size() != dimension_ ) {
+            throw std::string("dimension of node is different.");
+        }
+    }
+    for ( const auto weight : weights ) {
+        if ( !(weight >= 0.0) ) {
+            throw std::string("weights must not be negative.");
+        }
+    }
+
+    inputs_.push_back(input);
+    for ( const auto& node : samples ) {
+        samples_.push_back(node.data());
+    }
+    if ( weights.empty() ) {
+        weights_.resize(samples_.size(), 1.0);
+    } else {
+        weights_.insert(weights_.end(), weights.begin(), weights.end());
+    }
+    bmus_.resize(samples_.size(), -1);
+    distances_.resize(samples_.size(), 0.0);
+    slots_.resize(samples_.size(), -1);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::refresh(int maxEpochs) -> RefreshStats
+{
+    // epochs until no BMU changes, or maxEpochs
+    RefreshStats stats = {0, 0, 0, 0, 0};
+    searchPending(stats);
+
+    while ( stats.epochs < maxEpochs ) {
+        const auto updated = updateModels(stats);
+        if ( updated.empty() ) {
+            break;
+        }
+        ++stats.epochs;
+
+        std::vector<int> moved;
+        for ( const auto n : updated ) {
+            const auto anchor = &anchors_[static_cast<size_t>(n)*dimension_];
+            stats.distances += 1;
+            if ( calcDistance(anchor, n) > threshold_ ) {
+                const auto w = map_[n/cols_][n%cols_].data();
+                std::copy(w, w + dimension_, anchor);
+                moved.push_back(n);
+            }
+        }
+        stats.movedNeurons += moved.size();
+        if ( moved.empty() ) {
+            break;
+        }
+        reassign(moved, stats);
+    }
+
+    return stats;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::length() const -> int
+{
+    return samples_.size();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::map() const -> Map
+{
+    return map_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::bmu(int idx) const throw (std::string) -> Position
+{
+    if ( idx < 0 || idx >= searched_ ) {
+        throw std::string("sample has not been searched.");
+    }
+
+    return std::make_tuple(bmus_[idx]/cols_, bmus_[idx]%cols_);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::quantizationError() const -> double
+{
+    // weighted mean distance of the searched samples to their BMUs when they were found
+    return weightSum_ > 0.0 ? errorSum_/weightSum_ : 0.0;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::checkpoint(const std::string& path) const throw (std::string) -> void
+{
+    const auto neurons  = static_cast<size_t>(rows_)*cols_;
+    const auto length   = samples_.size();
+    std::vector<T> map;
+    map.reserve(neurons*dimension_);
+    for ( const auto& row : map_ ) {
+        for ( const auto& node : row ) {
+            map.insert(map.end(), node.data(), node.data() + dimension_);
+        }
+    }
+
+    const std::vector<int32_t> bmus(bmus_.begin(), bmus_.end());
+    const std::vector<CheckpointSection> sections = {
+        {map.data(), map.size()*sizeof(T)},
+        {anchors_.data(), anchors_.size()*sizeof(T)},
+        {weights_.data(), length*sizeof(double)},
+        {bmus.data(), length*sizeof(int32_t)},
+        {distances_.data(), length*sizeof(double)},
+        {sums_.data(), sums_.size()*sizeof(double)},
+        {counts_.data(), neurons*sizeof(double)},
+        {radii_.data(), neurons*sizeof(double)},
+        {touched_.data(), neurons},
+    };
+    const auto offsets = layoutCheckpoint(sizeof(IncrementalHeader), sections);
+
+    IncrementalHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, INCREMENTAL_MAGIC, sizeof(header.magic));
+    header.version          = INCREMENTAL_VERSION;
+    header.elementSize      = sizeof(T);
+    header.rows             = rows_;
+    header.cols             = cols_;
+    header.dimension        = dimension_;
+    header.length           = length;
+    header.sigma            = sigma_;
+    header.errorSum         = errorSum_;
+    header.weightSum        = weightSum_;
+    header.mapOffset        = offsets[0];
+    header.anchorsOffset    = offsets[1];
+    header.weightsOffset    = offsets[2];
+    header.bmusOffset       = offsets[3];
+    header.distancesOffset  = offsets[4];
+    header.sumsOffset       = offsets[5];
+    header.countsOffset     = offsets[6];
+    header.radiiOffset      = offsets[7];
+    header.touchedOffset    = offsets[8];
+    writeCheckpointFile(path, &header, sizeof(IncrementalHeader), sections, offsets);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto IncrementalKSOM<T, Metric, Topology>::restore(const std::string& path) throw (std::string) -> void
+{
+    // everything but the threshold and the samples comes from the file, which must be of a map of
+    // the same shape; the same samples must have been appended again
+    const CheckpointFile file(path, sizeof(IncrementalHeader));
+    const auto& header = *file.section<IncrementalHeader>(0, 1);
+    if ( std::memcmp(header.magic, INCREMENTAL_MAGIC, sizeof(header.magic)) != 0
+            || header.version != INCREMENTAL_VERSION || header.elementSize != sizeof(T)
+            || header.length < 0 || header.length > std::numeric_limits<int>::max() || !(header.sigma > 0.0) ) {
+        throw std::string("invalid checkpoint file.");
+    }
+    if ( header.rows != rows_ || header.cols != cols_ || header.dimension != dimension_ ) {
+        throw std::string("shape of checkpoint is different.");
+    }
+    if ( header.length != static_cast<int64_t>(samples_.size()) ) {
+        throw std::string("number of samples of checkpoint is different.");
+    }
+
+    const auto neurons  = static_cast<size_t>(rows_)*cols_;
+    const auto length   = static_cast<size_t>(header.length);
+    const auto map       = file.section<T>(header.mapOffset, neurons*dimension_);
+    const auto anchors   = file.section<T>(header.anchorsOffset, neurons*dimension_);
+    const auto weights   = file.section<double>(header.weightsOffset, length);
+    const auto bmus      = file.section<int32_t>(header.bmusOffset, length);
+    const auto distances = file.section<double>(header.distancesOffset, length);
+    const auto sums      = file.section<double>(header.sumsOffset, neurons*dimension_);
+    const auto counts    = file.section<double>(header.countsOffset, neurons);
+    const auto radii     = file.section<double>(header.radiiOffset, neurons);
+    const auto touched   = file.section<char>(header.touchedOffset, neurons);
+
+    // searched samples come first, and every BMU must be on the map
+    auto ok = true;
+    auto searched = 0;
+    while ( ok && searched < static_cast<int>(length) && bmus[searched] >= 0 ) {
+        ok = bmus[searched] < static_cast<int>(neurons);
+        ++searched;
+    }
+    for ( auto idx = searched; ok && idx < static_cast<int>(length); idx++ ) {
+        ok = bmus[idx] < 0;
+    }
+    if ( !ok ) {
+        throw std::string("invalid checkpoint file.");
+    }
+
+    for ( auto n = 0U; n < neurons; n++ ) {
+        std::copy(&map[n*dimension_], &map[n*dimension_] + dimension_, map_[n/cols_][n%cols_].data());
+    }
+    members_.assign(neurons, std::vector<int>());
+    slots_.assign(length, -1);
+    for ( auto idx = 0; idx < searched; idx++ ) {
+        slots_[idx] = members_[bmus[idx]].size();
+        members_[bmus[idx]].push_back(idx);
+    }
+    sigma_      = header.sigma;
+    errorSum_   = header.errorSum;
+    weightSum_  = header.weightSum;
+    searched_   = searched;
+    weights_.assign(weights, weights + length);
+    bmus_.assign(bmus, bmus + length);
+    distances_.assign(distances, distances + length);
+    sums_.assign(sums, sums + neurons*dimension_);
+    counts_.assign(counts, counts + neurons);
+    radii_.assign(radii, radii + neurons);
+    anchors_.assign(anchors, anchors + neurons*dimension_);
+    touched_.assign(touched, touched + neurons);
+    touchedNeurons_.clear();
+    for ( auto n = 0; n < static_cast<int>(neurons); n++ ) {
+        if ( touched_[n] ) {
+            touchedNeurons_.push_back(n);
+        }
+    }
+    metric_.prepare(map_, dimension_);
+}
+
+
+}
+
+
+#endif
@@ -9,7 +9,35 @@
 #include <tuple>
 #include <limits>
 #include <cmath>
+#include <type_traits>
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <memory>
+#include <future>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <typeinfo>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "node.hpp"
+#include "sparse_node.hpp"
+#include "metric.hpp"
+#include "topology.hpp"
+#include "pyramid.hpp"
+#include "checkpoint.hpp"
+#include "published_map.hpp"
+#include "profile.hpp"
+#include "numa.hpp"
+#include "pca.hpp"
+#include "projection.hpp"
+#include "sampler.hpp"
+#include "autotune.hpp"
+#include "neuron_index.hpp"
 
 
 namespace kg {
@@ -17,15 +45,141 @@ namespace kg {
 
 namespace {
     constexpr auto MAX_DISTANCE = std::numeric_limits<double>::max();
+    constexpr auto MIN_SPARSE_SCALE = 1.0e-6;
+    constexpr auto EVALUATION_BLOCK = 16;
 };
 
 
-template <typename T>
-class KSOM {
+// Cancelled is only reported by TrainingHandle::get(); a cancelled KSOM
+// keeps StopReason::None and resumes where it stopped
+enum class StopReason {
+    None,
+    MaxIterate,
+    QuantizationError,
+    Displacement,
+    Cancelled,
+};
+
+
+// Quantization error and displacement are exponential moving averages (with
+// the given smoothing) of the BMU distance and of the mean distance a model
+// vector moved in one step. Every checkInterval steps after minIterate,
+// compute() stops when the displacement is below displacementTolerance, or
+// when the relative improvement of the quantization error since the previous
+// check stayed below errorTolerance for patience checks in a row.
+// A tolerance of 0 disables that criterion. Both averages are negative
+// until the first step.
+struct StoppingCriteria {
+    double smoothing;
+    double errorTolerance;
+    double displacementTolerance;
+    int checkInterval;
+    int patience;
+    int minIterate;
+};
+
+
+// quantizationError is the mean distance between a sample and its BMU, and
+// topographicError the ratio of samples whose first and second BMUs are not
+// neighbors on the map
+struct Quality {
+    double quantizationError;
+    double topographicError;
+};
+
+
+// state of training reported to the progress callback of computeAsync()
+struct Progress {
+    int time;
+    int maxIterate;
+    double alpha;
+    double sigma;
+    double quantizationError;
+    double displacement;
+};
+
+
+// Handle of training started by KSOM::computeAsync(). cancel() asks the
+// training thread to stop before its next step, and get() waits for it and
+// rethrows an exception thrown by the progress callback.
+// The KSOM must not be used or destroyed until the training has finished.
+class TrainingHandle {
 private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+    std::shared_future<StopReason> result_;
+
+public:
+    TrainingHandle(const std::shared_ptr<std::atomic<bool>>& cancelled,
+                    const std::shared_future<StopReason>& result);
+
+    auto cancel() -> void;
+    auto wait() const -> void;
+    auto waitFor(std::chrono::milliseconds timeout) const -> bool;
+    auto get() const -> StopReason;
+};
+
+
+// gives the benchmark suite access to the private hot paths
+class KSOMBenchmark;
+template <typename T, typename Metric, typename Topology>
+class KSOMEnsemble;
+template <typename T, typename Transport, typename Metric, typename Topology>
+class BatchKSOM;
+
+
+inline TrainingHandle::TrainingHandle(const std::shared_ptr<std::atomic<bool>>& cancelled,
+                                        const std::shared_future<StopReason>& result)
+    :cancelled_(cancelled)
+    ,result_(result)
+{
+}
+
+
+inline auto TrainingHandle::cancel() -> void
+{
+    cancelled_->store(true);
+}
+
+
+inline auto TrainingHandle::wait() const -> void
+{
+    result_.wait();
+}
+
+
+inline auto TrainingHandle::waitFor(std::chrono::milliseconds timeout) const -> bool
+{
+    return result_.wait_for(timeout) == std::future_status::ready;
+}
+
+
+inline auto TrainingHandle::get() const -> StopReason
+{
+    return result_.get();
+}
+
+
+template <typename T, typename Metric=EuclideanMetric, typename Topology=RectangularTopology>
+class KSOM {
+    friend class KSOMBenchmark;
+    friend class KSOMEnsemble<T, Metric, Topology>;
+    template <typename U, typename Transport, typename M, typename Tp>
+    friend class BatchKSOM;
+
+public:
     using Position = std::tuple<int, int>;
 
-    const std::vector<Node<T>> src_;
+    struct SearchStats {
+        long long searches;
+        long long checks;
+        long long mismatches;
+    };
+
+private:
+    // shared, so that copies and other models over the same input do not copy it
+    const std::shared_ptr<const std::vector<Node<T>>> src_;
+    const std::vector<SparseNode<T>> sparseSrc_;
+    const bool sparse_;
     const int length_;
     const int dimension_;
 
@@ -36,44 +190,262 @@ private:
     const double alpha0_;
     const double sigma0_;
     const int maxIterate_;
+    double timeConstant_;
     int time_;
 
     const bool randomIndex_;
-    std::mt19937 mt_;
-    std::uniform_int_distribution<> randIdx_;
+    EpochSampler sampler_;
+
+    Metric metric_;
+    Topology topology_;
+
+    // sparse mode keeps each model vector as scales_[n]*map_[r][c] together
+    // with its squared norm, so one step only touches the non-zero inputs
+    std::vector<double> norms_;
+    std::vector<double> scales_;
+    std::vector<double> dots_;
+
+    // optional coarse-to-fine BMU search over pooled model vectors
+    bool hierarchical_;
+    MapPyramid<T> pyramid_;
+    double pyramidTolerance_;
+
+    // optional two-stage BMU search over a low-dimensional projection;
+    // exclusive with the hierarchical search
+    bool projected_;
+    ProjectedCodebook<T> projection_;
+
+    // shared by both approximate searches
+    int checkInterval_;
+    SearchStats searchStats_;
+
+    // with pipelining, learnNode() also finds the BMU of the next sample
+    // while it sweeps the map; pendingIdx_ is -1 when there is none
+    bool pipelined_;
+    int pendingIdx_;
+    Position pendingBmu_;
+    double pendingRank_;
+
+    // threads of the exhaustive search and of the update; 0 is the OpenMP default
+    int threads_;
+
+    // samples grouped by BMU as of step indexTime_, or -1 before indexSamples()
+    NeuronIndex index_;
+    int indexTime_;
+
+    StoppingCriteria criteria_;
+    StopReason stopReason_;
+    double quantizationError_;
+    double displacement_;
+    double checkedError_;
+    int stagnantChecks_;
+
+    PublishedMap<T, Metric>* published_;
+    int publishInterval_;
+
+    // relative weight of every input vector, normalized to a mean of 1;
+    // empty when all inputs weigh the same
+    std::vector<double> weights_;
+
+    // first row of every NUMA partition; empty unless partitioning is enabled
+    std::vector<int> partitionRows_;
+    // thread of the team that placed every row
+    std::vector<int> partitionThreads_;
+
+    // nothing is timed or counted unless profiling_ is set
+    bool profiling_;
+    Profile profile_;
+    std::shared_ptr<HardwareCounters> counters_;
 
 private:
+    inline auto validateMap() const throw (std::string) -> void;
     inline auto calcAlpha(int time) const -> double;
     inline auto calcSigma(int time) const -> double;
-    inline auto calcH(double distance, int time) const -> double;
-    inline auto calcDistance(const Position& pt1, const Position& pt2) const -> double;
+    inline auto calcH(double sqDistance, double sigma) const -> double;
+    inline auto calcRate(double rate, double weight) const -> double;
+    inline auto sampleWeight(int idx) const -> double;
     inline auto calcDistance(const Node<T>& node1,
                                 const Node<T>& node2) const -> double;
     inline auto nextIndex() -> unsigned int;
-    inline auto findNearestNode(int idx) const -> Position;
-    inline auto learnNode(int idx, const Position& nearestPoint) -> void;
+    inline auto findNearestNode(int idx, Profile* profile=nullptr, double* minRank=nullptr) const -> Position;
+    inline auto findNearestNode(const Node<T>& refNode, Profile* profile=nullptr, double* minRank=nullptr) const -> Position;
+    inline auto findNearestNodeExhaustively(const Node<T>& refNode, Profile* profile=nullptr,
+                                            double* minRank=nullptr) const -> Position;
+    inline auto refreshPyramid(const Position& nearestPoint) -> void;
+    inline auto learnNode(int idx, const Position& nearestPoint, int upcoming, Profile* profile=nullptr) -> double;
+    inline auto threadRows() const -> std::pair<int, int>;
+    inline auto placePartitions() -> void;
+    inline auto canCompute() -> bool;
+    inline auto searchStep(int idx, Profile* profile, double& minRank) -> Position;
+    inline auto learnStep(int idx, const Position& nearestPoint, double minRank, int upcoming,
+                            Profile* profile, PhaseTimer& timer) -> void;
+    inline auto finishStep(double error, double displacement) -> void;
+    inline auto calcSparseDot(const SparseNode<T>& node, int r, int c) const -> double;
+    inline auto findNearestSparseNode(const SparseNode<T>& refNode, double* dots,
+                                        Profile* profile=nullptr) const -> Position;
+    inline auto learnSparseNode(int idx, const Position& nearestPoint, Profile* profile=nullptr) -> double;
+    inline auto updateConvergence(double error, double displacement) -> void;
+    inline auto isNeighbor(int n1, int n2) const -> bool;
+    inline auto calcModelDistance(int n1, int n2) const -> double;
+    inline auto evaluateNodes(const std::vector<Node<T>>& samples, const double* weights=nullptr) const -> Quality;
+    inline auto evaluateSparseNodes(const std::vector<SparseNode<T>>& samples,
+                                    const double* weights=nullptr) const -> Quality;
+    inline auto checkpointData() const -> CheckpointData<T>;
+    inline auto threadCount() const -> int;
+    inline auto tuningKey(bool approximate) const -> std::string;
+    inline auto currentTuning() const -> TuningChoice;
+    inline auto applyTuning(const TuningChoice& choice) -> void;
+    inline auto measureTuning(const TuningChoice& choice, int trials) const -> double;
 
 public:
     KSOM(const std::vector<Node<T>>& src, const std::vector<std::vector<Node<T>>>& map,
             int maxIterate, double alpha0, double sigma0,
-            bool randomly=true) throw (std::string);
+            bool randomly=true, const Metric& metric=Metric(),
+            const Topology& topology=Topology()) throw (std::string);
+    KSOM(const std::shared_ptr<const std::vector<Node<T>>>& src, const std::vector<std::vector<Node<T>>>& map,
+            int maxIterate, double alpha0, double sigma0,
+            bool randomly=true, const Metric& metric=Metric(),
+            const Topology& topology=Topology()) throw (std::string);
+    KSOM(const std::vector<SparseNode<T>>& src, const std::vector<std::vector<Node<T>>>& map,
+            int maxIterate, double alpha0, double sigma0,
+            bool randomly=true, const Metric& metric=Metric(),
+            const Topology& topology=Topology()) throw (std::string);
     ~KSOM();
 
     auto computeOnes() -> bool;
     auto compute() -> void;
+    auto computeAsync(const std::function<void(const Progress&)>& callback=nullptr,
+                        int interval=1000) throw (std::string) -> TrainingHandle;
+    auto progress() const -> Progress;
     auto time() const -> int;
     auto map() const -> std::vector<std::vector<Node<T>>>;
+    auto bmu(const Node<T>& node) const throw (std::string) -> Position;
+    auto bmu(const SparseNode<T>& node) const throw (std::string) -> Position;
+    auto initializeLinearly() throw (std::string) -> void;
+    auto enableHierarchicalSearch(int blockSize=4, int candidates=4, double tolerance=1.0e-4,
+                                    int checkInterval=0) throw (std::string) -> void;
+    auto disableHierarchicalSearch() -> void;
+    auto enableProjectedSearch(int dimension=32, int candidates=16,
+                                ProjectionMethod method=ProjectionMethod::Random,
+                                int checkInterval=0) throw (std::string) -> void;
+    auto disableProjectedSearch() -> void;
+    auto enableBlockShuffle(int blockSize=0) -> void;
+    auto enablePipelining() throw (std::string) -> void;
+    auto disablePipelining() -> void;
+    auto disableBlockShuffle() -> void;
+    auto setThreads(int threads) throw (std::string) -> void;
+    auto setTimeConstant(double timeConstant) throw (std::string) -> void;
+    auto threads() const -> int;
+    auto setSeed(uint64_t seed) -> void;
+    auto seed() const -> uint64_t;
+    auto indexSamples() -> const NeuronIndex&;
+    auto nearestSamples(const Node<T>& node, int k) const throw (std::string) -> std::vector<int>;
+    auto autotune(const std::string& profilePath="", bool approximate=false,
+                    int trials=32) throw (std::string) -> TuningChoice;
+    auto searchStats() const -> SearchStats;
+    auto setStoppingCriteria(const StoppingCriteria& criteria) throw (std::string) -> void;
+    auto quantizationError() const -> double;
+    auto displacement() const -> double;
+    auto stopReason() const -> StopReason;
+    auto evaluate() const -> Quality;
+    auto evaluate(const std::vector<Node<T>>& samples) const throw (std::string) -> Quality;
+    auto evaluate(const std::vector<SparseNode<T>>& samples) const throw (std::string) -> Quality;
+    auto uMatrix() const -> std::vector<std::vector<double>>;
+    auto checkpoint(const std::string& path) const throw (std::string) -> void;
+    auto snapshotAsync(const std::string& path) const -> std::future<void>;
+    auto restore(const std::string& path) throw (std::string) -> void;
+    auto publish(PublishedMap<T, Metric>& published) const throw (std::string) -> void;
+    auto setPublishedMap(PublishedMap<T, Metric>* published, int interval) throw (std::string) -> void;
+    auto setWeights(const std::vector<double>& weights) throw (std::string) -> void;
+    auto enableNumaPartitioning(int nodes=0) throw (std::string) -> void;
+    auto disableNumaPartitioning() -> void;
+    auto numaPartitions() const -> int;
+    auto numaRowThreads() const -> std::vector<int>;
+    auto enableProfiling(bool hardwareCounters=false) -> void;
+    auto disableProfiling() -> void;
+    auto profile() const -> Profile;
 };
 
 
-template <typename T>
-KSOM<T>::KSOM(const std::vector<Node<T>>& src,
+template <typename T, typename Metric, typename Topology>
+KSOM<T, Metric, Topology>::KSOM(const std::vector<Node<T>>& src,
+                const std::vector<std::vector<Node<T>>>& map,
+                int maxIterate, double alpha0,
+                double sigma0, bool randomly,
+                const Metric& metric, const Topology& topology) throw (std::string)
+    :KSOM(std::make_shared<const std::vector<Node<T>>>(src), map, maxIterate,
+            alpha0, sigma0, randomly, metric, topology)
+{
+}
+
+
+template <typename T, typename Metric, typename Topology>
+KSOM<T, Metric, Topology>::KSOM(const std::shared_ptr<const std::vector<Node<T>>>& src,
                 const std::vector<std::vector<Node<T>>>& map,
                 int maxIterate, double alpha0,
-                double sigma0, bool randomly) throw (std::string)
+                double sigma0, bool randomly,
+                const Metric& metric, const Topology& topology) throw (std::string)
     :randomIndex_(randomly)
     ,src_(src)
-    ,length_(src_.size())
+    ,sparse_(false)
+    ,length_(src_->size())
+    ,dimension_((*src_)[0].size())
+    ,map_(map)
+    ,rows_(map_.size())
+    ,cols_(map_[0].size())
+    ,alpha0_(alpha0)
+    ,sigma0_(sigma0)
+    ,maxIterate_(maxIterate)
+    ,timeConstant_(maxIterate)
+    ,time_(0)
+    ,metric_(metric)
+    ,topology_(topology)
+    ,hierarchical_(false)
+    ,pyramidTolerance_(0.0)
+    ,projected_(false)
+    ,checkInterval_(0)
+    ,searchStats_({0, 0, 0})
+    ,pipelined_(false)
+    ,pendingIdx_(-1)
+    ,pendingBmu_(0, 0)
+    ,pendingRank_(0.0)
+    ,threads_(0)
+    ,index_(rows_, cols_)
+    ,indexTime_(-1)
+    ,criteria_({0.01, 0.0, 0.0, 0, 1, 0})
+    ,stopReason_(StopReason::None)
+    ,quantizationError_(-1.0)
+    ,displacement_(-1.0)
+    ,checkedError_(-1.0)
+    ,stagnantChecks_(0)
+    ,published_(nullptr)
+    ,publishInterval_(0)
+    ,profiling_(false)
+    ,profile_()
+{
+    for ( const auto& node : *src_ ) {
+        if ( node.size() != dimension_ ) {
+            throw std::string("dimension of source node is different.");
+        }
+    }
+    validateMap();
+    metric_.prepare(map_, dimension_);
+    topology_.prepare(rows_, cols_);
+
+    sampler_ = EpochSampler(length_, randomIndex_, randomSeed());
+}
+
+
+template <typename T, typename Metric, typename Topology>
+KSOM<T, Metric, Topology>::KSOM(const std::vector<SparseNode<T>>& src,
+                const std::vector<std::vector<Node<T>>>& map,
+                int maxIterate, double alpha0,
+                double sigma0, bool randomly,
+                const Metric& metric, const Topology& topology) throw (std::string)
+    :randomIndex_(randomly)
+    ,sparseSrc_(src)
+    ,sparse_(true)
+    ,length_(sparseSrc_.size())
     ,dimension_(src[0].size())
     ,map_(map)
     ,rows_(map_.size())
@@ -81,13 +453,72 @@ KSOM<T>::KSOM(const std::vector<Node<T>>& src,
     ,alpha0_(alpha0)
     ,sigma0_(sigma0)
     ,maxIterate_(maxIterate)
+    ,timeConstant_(maxIterate)
     ,time_(0)
+    ,metric_(metric)
+    ,topology_(topology)
+    ,hierarchical_(false)
+    ,pyramidTolerance_(0.0)
+    ,projected_(false)
+    ,checkInterval_(0)
+    ,searchStats_({0, 0, 0})
+    ,pipelined_(false)
+    ,pendingIdx_(-1)
+    ,pendingBmu_(0, 0)
+    ,pendingRank_(0.0)
+    ,threads_(0)
+    ,index_(rows_, cols_)
+    ,indexTime_(-1)
+    ,criteria_({0.01, 0.0, 0.0, 0, 1, 0})
+    ,stopReason_(StopReason::None)
+    ,quantizationError_(-1.0)
+    ,displacement_(-1.0)
+    ,checkedError_(-1.0)
+    ,stagnantChecks_(0)
+    ,published_(nullptr)
+    ,publishInterval_(0)
+    ,profiling_(false)
+    ,profile_()
 {
-    for ( auto node : src_ ) {
+    static_assert(std::is_floating_point<T>::value,
+                    "sparse input requires floating point model vectors.");
+    static_assert(std::is_same<Metric, EuclideanMetric>::value,
+                    "sparse input supports EuclideanMetric only.");
+
+    for ( const auto& node : sparseSrc_ ) {
         if ( node.size() != dimension_ ) {
             throw std::string("dimension of source node is different.");
         }
     }
+    validateMap();
+    metric_.prepare(map_, dimension_);
+    topology_.prepare(rows_, cols_);
+
+    norms_  = std::vector<double>(rows_*cols_, 0.0);
+    scales_ = std::vector<double>(rows_*cols_, 1.0);
+    dots_   = std::vector<double>(rows_*cols_, 0.0);
+    for ( auto r = 0; r < rows_; r++ ) {
+        for ( auto c = 0; c < cols_; c++ ) {
+            const auto elems = map_[r][c].data();
+            for ( auto i = 0; i < dimension_; i++ ) {
+                norms_[r*cols_ + c] += static_cast<double>(elems[i])*elems[i];
+            }
+        }
+    }
+
+    sampler_ = EpochSampler(length_, randomIndex_, randomSeed());
+}
+
+
+template <typename T, typename Metric, typename Topology>
+KSOM<T, Metric, Topology>::~KSOM()
+{
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::validateMap() const throw (std::string) -> void
+{
     for ( auto row : map_ ) {
         if ( row.size() != cols_ ) {
             throw std::string("number of columns in map is different.");
@@ -98,178 +529,1637 @@ KSOM<T>::KSOM(const std::vector<Node<T>>& src,
             }
         }
     }
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::calcAlpha(int time) const -> double
+{
+    return alpha0_*exp(-static_cast<double>(time)/timeConstant_);
+}
+
 
-    std::random_device rnd;
-    mt_         = std::mt19937(rnd());
-    randIdx_    = std::uniform_int_distribution<>(0, length_ - 1);
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::calcSigma(int time) const -> double
+{
+    return sigma0_*exp(-static_cast<double>(time)/timeConstant_);
 }
 
 
-template <typename T>
-KSOM<T>::~KSOM()
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::calcH(double sqDistance, double sigma) const -> double
 {
+    return exp(-sqDistance/(2.0*sigma*sigma));
 }
 
 
-template <typename T>
-auto KSOM<T>::calcAlpha(int time) const -> double
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::calcRate(double rate, double weight) const -> double
 {
-    return alpha0_*exp(-static_cast<double>(time)/static_cast<double>(maxIterate_));
+    // presenting a sample weight times in a row moves a model vector by 1 - (1 - rate)^weight
+    return weight == 1.0 || rate >= 1.0 ? rate : 1.0 - pow(1.0 - rate, weight);
 }
 
 
-template <typename T>
-auto KSOM<T>::calcSigma(int time) const -> double
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::sampleWeight(int idx) const -> double
 {
-    return sigma0_*exp(-static_cast<double>(time)/static_cast<double>(maxIterate_));
+    return weights_.empty() ? 1.0 : weights_[idx];
 }
 
 
-template <typename T>
-auto KSOM<T>::calcH(double distance, int time) const -> double
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::nextIndex() -> unsigned int
 {
-    return exp(-pow(distance, 2.0)/(2*pow(calcSigma(time), 2.0)));
+    const auto index = sampler_.next();
+
+    // the next sample is loaded while this step runs
+    const auto upcoming = sampler_.peek();
+    if ( upcoming >= 0 ) {
+        if ( sparse_ ) {
+            const auto& node = sparseSrc_[upcoming];
+            prefetch(node.indices(), sizeof(int)*node.nnz());
+            prefetch(node.values(), sizeof(T)*node.nnz());
+        } else {
+            prefetch((*src_)[upcoming].data(), sizeof(T)*dimension_);
+        }
+    }
+
+    return index;
 }
 
 
-template <typename T>
-auto KSOM<T>::calcDistance(const Position& pt1, const Position& pt2) const -> double
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::calcDistance(const Node<T>& node1, const Node<T>& node2) const -> double
 {
-    const auto x1 = std::get<0>(pt1), y1 = std::get<1>(pt1);
-    const auto x2 = std::get<0>(pt2), y2 = std::get<1>(pt2);
+    return metric_.distance(node1.data(), node2.data(), dimension_);
+}
+
 
-    return sqrt(pow(x1 - x2, 2.0) + pow(y1 - y2, 2.0));
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::findNearestNode(int idx, Profile* profile, double* minRank) const -> Position
+{
+    return findNearestNode((*src_)[idx], profile, minRank);
 }
 
 
-template <typename T>
-auto KSOM<T>::nextIndex() -> unsigned int
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::findNearestNode(const Node<T>& refNode, Profile* profile, double* minRank) const -> Position
 {
-    auto index = 0U;
-    if ( randomIndex_ ) {
-        index = randIdx_(mt_);
+    const auto x = refNode.data();
+    if ( !hierarchical_ && !projected_ ) {
+        return findNearestNodeExhaustively(refNode, profile, minRank);
+    }
+
+    // both searches return the neuron of the lowest rank they asked for
+    auto cells = 0LL, neurons = 0LL;
+    auto lowest = MAX_DISTANCE;
+    const auto rank = [this, x, &neurons, &lowest](int r, int c) {
+        ++neurons;
+        const auto dis = metric_.rank(x, map_[r][c].data(), dimension_, r*cols_ + c);
+        lowest = std::min(lowest, dis);
+        return dis;
+    };
+    Position nearestPoint;
+    if ( projected_ ) {
+        // only the candidates count as visited, as the reduced distances are cheap
+        nearestPoint = projection_.search(x, rank, threadCount());
     } else {
-        index = time_ % src_.size();
+        nearestPoint = pyramid_.search(x,
+            [this, &cells](const T* ref, const T* w) {
+                ++cells;
+                return metric_.distance(ref, w, dimension_);
+            },
+            rank);
+    }
+    if ( profile != nullptr ) {
+        profile->neuronsVisited         += neurons;
+        profile->distanceEvaluations    += cells + neurons;
+    }
+    if ( minRank != nullptr ) {
+        *minRank = lowest;
     }
 
-    return index;
+    return nearestPoint;
 }
 
 
-template <typename T>
-auto KSOM<T>::calcDistance(const Node<T>& node1, const Node<T>& node2) const -> double
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::findNearestNodeExhaustively(const Node<T>& refNode, Profile* profile,
+                                                                double* minRank) const -> Position
 {
-    auto dis = 0.0;
+    if ( profile != nullptr ) {
+        profile->neuronsVisited         += rows_*cols_;
+        profile->distanceEvaluations    += rows_*cols_;
+    }
+
+    const auto x = refNode.data();
+    auto minDis = MAX_DISTANCE;
+    auto minIdx = 0;
     #ifdef _OPENMP
-    #pragma omp parallel for schedule(static) reduction(+:dis)
+    #pragma omp parallel num_threads(threadCount())
     #endif
-    for ( int i = 0; i < dimension_; i++ ) {
-        dis += pow(node1[i] - node2[i], 2.0);
+    {
+        auto localMinDis = MAX_DISTANCE;
+        auto localMinIdx = 0;
+        const auto visit = [&](int n) {
+            const auto dis = metric_.rank(x, map_[n/cols_][n%cols_].data(), dimension_, n);
+            if ( dis < localMinDis ) {
+                localMinDis = dis;
+                localMinIdx = n;
+            }
+        };
+        if ( partitionRows_.empty() ) {
+            #ifdef _OPENMP
+            #pragma omp for schedule(static)
+            #endif
+            for ( auto n = 0; n < rows_*cols_; n++ ) {
+                visit(n);
+            }
+        } else {
+            // every thread only reads the rows of its own NUMA partition
+            const auto rows = threadRows();
+            for ( auto n = rows.first*cols_; n < rows.second*cols_; n++ ) {
+                visit(n);
+            }
+        }
+        #ifdef _OPENMP
+        #pragma omp critical (updateDistance)
+        #endif
+        {
+            if ( localMinDis < minDis || (localMinDis == minDis && localMinIdx < minIdx) ) {
+                minDis = localMinDis;
+                minIdx = localMinIdx;
+            }
+        }
+    }
+    if ( minRank != nullptr ) {
+        *minRank = minDis;
     }
 
-    return sqrt(dis);
+    return std::make_tuple(minIdx/cols_, minIdx%cols_);
 }
 
 
-template <typename T>
-auto KSOM<T>::findNearestNode(int idx) const -> Position
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::learnNode(int idx, const Position& nearestPoint, int upcoming, Profile* profile) -> double
 {
-    const auto& refNode = src_[idx];
-    auto minDis = MAX_DISTANCE;
-    auto minDisRow = 0, minDisCol = 0;
+    // upcoming is the sample of the next step, or -1 when it is not known
+    if ( profile != nullptr ) {
+        profile->neuronsUpdated += rows_*cols_;
+    }
+
+    const auto x        = (*src_)[idx].data();
+    const auto weight   = sampleWeight(idx);
+    const auto alpha    = calcAlpha(time_);
+    const auto sigma    = calcSigma(time_);
+    const auto bmuRow   = std::get<0>(nearestPoint), bmuCol = std::get<1>(nearestPoint);
+    // summed per row and then in row order, so that it does not depend on the threads
+    std::vector<double> rowDisplacements(rows_, 0.0);
+    std::vector<double> projected(projected_ ? projection_.dimension() : 0);
+    if ( projected_ ) {
+        projection_.project(x, projected.data());
+    }
+
+    // the fused search is exhaustive, so it gives the same BMU as a separate sweep
+    const auto fused    = pipelined_ && !hierarchical_ && !projected_ && time_ + 1 < maxIterate_ && upcoming >= 0;
+    const auto next     = fused ? (*src_)[upcoming].data() : nullptr;
+    auto minDis         = MAX_DISTANCE;
+    auto minIdx         = 0;
+    if ( profile != nullptr && next != nullptr ) {
+        profile->neuronsVisited         += rows_*cols_;
+        profile->distanceEvaluations    += rows_*cols_;
+    }
     #ifdef _OPENMP
-    #pragma omp parallel for schedule(static)
+    #pragma omp parallel num_threads(threadCount())
     #endif
-    for ( auto r = 0; r < rows_; r++ ) {
-        #ifdef _OPENMP
-        #pragma omp parallel for schedule(static)
-        #endif
-        for ( auto c = 0; c < cols_; c++ ) {
-            auto dis = calcDistance(refNode, map_[r][c]);
+    {
+        auto localMinDis = MAX_DISTANCE;
+        auto localMinIdx = 0;
+        const auto learnRow = [&](int r) {
+            const auto sqDistances = topology_.row(bmuRow, bmuCol, r);
+            auto displacement = 0.0;
+            for ( auto c = 0; c < cols_; c++ ) {
+                const auto a = calcRate(calcH(sqDistances[c], sigma)*alpha, weight);
+
+                const auto w = map_[r][c].data();
+                auto moved = 0.0;
+                #ifdef _OPENMP
+                #pragma omp simd reduction(+:moved)
+                #endif
+                for ( auto i = 0; i < dimension_; i++ ) {
+                    const auto delta = static_cast<T>(a*(x[i] - w[i]));
+                    w[i] += delta;
+                    moved += static_cast<double>(delta)*delta;
+                }
+                metric_.update(w, dimension_, r*cols_ + c);
+                if ( projected_ ) {
+                    projection_.update(r*cols_ + c, a, projected.data());
+                }
+                displacement += sqrt(moved);
+
+                if ( next != nullptr ) {
+                    const auto dis = metric_.rank(next, w, dimension_, r*cols_ + c);
+                    if ( dis < localMinDis ) {
+                        localMinDis = dis;
+                        localMinIdx = r*cols_ + c;
+                    }
+                }
+            }
+            rowDisplacements[r] = displacement;
+        };
+        if ( partitionRows_.empty() ) {
+            #ifdef _OPENMP
+            #pragma omp for schedule(static)
+            #endif
+            for ( auto r = 0; r < rows_; r++ ) {
+                learnRow(r);
+            }
+        } else {
+            const auto rows = threadRows();
+            for ( auto r = rows.first; r < rows.second; r++ ) {
+                learnRow(r);
+            }
+        }
+        if ( next != nullptr ) {
             #ifdef _OPENMP
             #pragma omp critical (updateDistance)
             #endif
             {
-                if ( dis < minDis ) {
-                    minDis = dis;
-                    minDisRow = r;
-                    minDisCol = c;
+                if ( localMinDis < minDis || (localMinDis == minDis && localMinIdx < minIdx) ) {
+                    minDis = localMinDis;
+                    minIdx = localMinIdx;
+                }
+            }
+        }
+    }
+    pendingIdx_ = fused ? upcoming : -1;
+    pendingBmu_ = std::make_tuple(minIdx/cols_, minIdx%cols_);
+    pendingRank_ = minDis;
+
+    return std::accumulate(rowDisplacements.begin(), rowDisplacements.end(), 0.0)/(rows_*cols_);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::refreshPyramid(const Position& nearestPoint) -> void
+{
+    // neurons whose neighborhood coefficient stays below the tolerance are
+    // treated as unchanged, so only blocks around the BMU are pooled again
+    const auto sigma    = calcSigma(time_);
+    const auto radius   = -2.0*sigma*sigma*log(pyramidTolerance_);
+    const auto bmuRow   = std::get<0>(nearestPoint), bmuCol = std::get<1>(nearestPoint);
+    pyramid_.refresh(map_, [this, radius, bmuRow, bmuCol](int r0, int r1, int c0, int c1) {
+        for ( auto r = r0; r < r1; r++ ) {
+            const auto sqDistances = topology_.row(bmuRow, bmuCol, r);
+            for ( auto c = c0; c < c1; c++ ) {
+                if ( sqDistances[c] < radius ) {
+                    return true;
                 }
             }
         }
+        return false;
+    }, threadCount());
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::calcSparseDot(const SparseNode<T>& node, int r, int c) const -> double
+{
+    const auto elems    = map_[r][c].data();
+    const auto indices  = node.indices();
+    const auto values   = node.values();
+    const auto nnz      = node.nnz();
+
+    auto dot = 0.0;
+    for ( auto k = 0; k < nnz; k++ ) {
+        dot += static_cast<double>(values[k])*elems[indices[k]];
     }
 
-    return std::make_tuple(minDisRow, minDisCol);
+    return scales_[r*cols_ + c]*dot;
 }
 
 
-template <typename T>
-auto KSOM<T>::learnNode(int idx, const Position& nearestPoint) -> void
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::findNearestSparseNode(const SparseNode<T>& refNode, double* dots,
+                                                        Profile* profile) const -> Position
 {
-    const auto& refNode = src_[idx];
-    const auto alpha = calcAlpha(time_);
+    if ( profile != nullptr ) {
+        profile->neuronsVisited         += rows_*cols_;
+        profile->distanceEvaluations    += rows_*cols_;
+    }
+
+    // ||x - w||^2 = ||w||^2 - 2<x, w> + ||x||^2, with ||w||^2 cached in norms_
+    const auto refNorm = refNode.squaredNorm();
+    auto minDis = MAX_DISTANCE;
+    auto minIdx = 0;
     #ifdef _OPENMP
-    #pragma omp parallel for schedule(static)
+    #pragma omp parallel num_threads(threadCount())
     #endif
-    for ( auto r = 0; r < rows_; r++ ) {
+    {
+        auto localMinDis = MAX_DISTANCE;
+        auto localMinIdx = 0;
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for ( auto n = 0; n < rows_*cols_; n++ ) {
+            const auto dot = calcSparseDot(refNode, n/cols_, n%cols_);
+            const auto dis = norms_[n] - 2.0*dot + refNorm;
+            if ( dots != nullptr ) {
+                dots[n] = dot;
+            }
+            if ( dis < localMinDis ) {
+                localMinDis = dis;
+                localMinIdx = n;
+            }
+        }
         #ifdef _OPENMP
-        #pragma omp parallel for schedule(static)
+        #pragma omp critical (updateSparseDistance)
         #endif
+        {
+            if ( localMinDis < minDis || (localMinDis == minDis && localMinIdx < minIdx) ) {
+                minDis = localMinDis;
+                minIdx = localMinIdx;
+            }
+        }
+    }
+
+    return std::make_tuple(minIdx/cols_, minIdx%cols_);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::learnSparseNode(int idx, const Position& nearestPoint, Profile* profile) -> double
+{
+    const auto& refNode = sparseSrc_[idx];
+    const auto indices  = refNode.indices();
+    const auto values   = refNode.values();
+    const auto nnz      = refNode.nnz();
+    const auto refNorm  = refNode.squaredNorm();
+    const auto weight   = sampleWeight(idx);
+    const auto alpha    = calcAlpha(time_);
+    const auto sigma    = calcSigma(time_);
+    const auto bmuRow   = std::get<0>(nearestPoint), bmuCol = std::get<1>(nearestPoint);
+    // summed per row and then in row order, so that it does not depend on the threads
+    std::vector<double> rowDisplacements(rows_, 0.0);
+    auto updated        = 0LL;
+    #ifdef _OPENMP
+    #pragma omp parallel for num_threads(threadCount()) schedule(static) reduction(+:updated)
+    #endif
+    for ( auto r = 0; r < rows_; r++ ) {
+        const auto sqDistances = topology_.row(bmuRow, bmuCol, r);
         for ( auto c = 0; c < cols_; c++ ) {
-            auto currentPoint   = std::make_tuple(r, c);
-            const auto dis      = calcDistance(currentPoint, nearestPoint);
-            const auto h        = calcH(dis, time_);
+            const auto n    = r*cols_ + c;
+            const auto a    = calcRate(calcH(sqDistances[c], sigma)*alpha, weight);
+            if ( a <= 0.0 ) {
+                continue;
+            }
+            ++updated;
+            rowDisplacements[r] += a*sqrt(std::max(0.0, norms_[n] - 2.0*dots_[n] + refNorm));
 
-            #ifdef _OPENMP
-            #pragma omp parallel for schedule(static)
-            #endif
-            for ( auto i = 0; i < dimension_; i++ ) {
-                map_[r][c][i] += static_cast<T>(h*alpha*(refNode[i] - map_[r][c][i]));
+            // w' = (1 - a)w + ax, folded into the scale so that only nnz weights move
+            const auto elems = map_[r][c].data();
+            const auto scale = scales_[n]*(1.0 - a);
+            if ( scale < MIN_SPARSE_SCALE ) {
+                auto norm = 0.0;
+                for ( auto i = 0; i < dimension_; i++ ) {
+                    elems[i] = static_cast<T>(elems[i]*scale);
+                }
+                for ( auto k = 0; k < nnz; k++ ) {
+                    elems[indices[k]] += static_cast<T>(a*values[k]);
+                }
+                for ( auto i = 0; i < dimension_; i++ ) {
+                    norm += static_cast<double>(elems[i])*elems[i];
+                }
+                scales_[n]  = 1.0;
+                norms_[n]   = norm;
+            } else {
+                const auto step = a/scale;
+                for ( auto k = 0; k < nnz; k++ ) {
+                    elems[indices[k]] += static_cast<T>(step*values[k]);
+                }
+                norms_[n]   = (1.0 - a)*(1.0 - a)*norms_[n] + 2.0*a*(1.0 - a)*dots_[n] + a*a*refNorm;
+                scales_[n]  = scale;
             }
         }
     }
+    if ( profile != nullptr ) {
+        profile->neuronsUpdated += updated;
+    }
+
+    return std::accumulate(rowDisplacements.begin(), rowDisplacements.end(), 0.0)/(rows_*cols_);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::updateConvergence(double error, double displacement) -> void
+{
+    const auto smoothing = criteria_.smoothing;
+    quantizationError_  = quantizationError_ < 0.0 ? error : (1.0 - smoothing)*quantizationError_ + smoothing*error;
+    displacement_       = displacement_ < 0.0 ? displacement : (1.0 - smoothing)*displacement_ + smoothing*displacement;
+
+    const auto time = time_ + 1;
+    if ( criteria_.checkInterval <= 0 || time%criteria_.checkInterval != 0 || time < criteria_.minIterate ) {
+        return;
+    }
+
+    if ( criteria_.displacementTolerance > 0.0 && displacement_ < criteria_.displacementTolerance ) {
+        stopReason_ = StopReason::Displacement;
+        return;
+    }
+    if ( criteria_.errorTolerance > 0.0 ) {
+        if ( checkedError_ > 0.0 && (checkedError_ - quantizationError_)/checkedError_ < criteria_.errorTolerance ) {
+            ++stagnantChecks_;
+        } else {
+            stagnantChecks_ = 0;
+        }
+        checkedError_ = quantizationError_;
+        if ( stagnantChecks_ >= criteria_.patience ) {
+            stopReason_ = StopReason::QuantizationError;
+        }
+    }
+}
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::threadRows() const -> std::pair<int, int>
+{
+    // rows of the NUMA partition handled by the calling thread of the team
+    #ifdef _OPENMP
+    return numaThreadRows(partitionRows_, omp_get_thread_num(), omp_get_num_threads());
+    #else
+    return std::make_pair(0, rows_);
+    #endif
 }
 
-template <typename T>
-auto KSOM<T>::computeOnes() -> bool
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::threadCount() const -> int
+{
+    return threads_ > 0 ? threads_ : maxThreads();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::canCompute() -> bool
 {
+    if ( stopReason_ != StopReason::None ) {
+        return false;
+    }
     if ( time_ >= maxIterate_ ) {
+        stopReason_ = StopReason::MaxIterate;
         return false;
     }
 
-    const auto idx          = nextIndex();
-    const auto nearestPoint = findNearestNode(idx);
-    learnNode(idx, nearestPoint);
-    ++time_;
-
     return true;
 }
 
 
-template <typename T>
-auto KSOM<T>::compute() -> void
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::searchStep(int idx, Profile* profile, double& minRank) -> Position
 {
-    while ( computeOnes() ) {
-        ;
+    // the BMU of a dense step with the configured search
+    minRank = pendingRank_;
+    const auto nearestPoint = pendingIdx_ == idx ? pendingBmu_ : findNearestNode(idx, profile, &minRank);
+    if ( hierarchical_ || projected_ ) {
+        ++searchStats_.searches;
+        if ( checkInterval_ > 0 && searchStats_.searches%checkInterval_ == 0 ) {
+            ++searchStats_.checks;
+            if ( nearestPoint != findNearestNodeExhaustively((*src_)[idx], profile) ) {
+                ++searchStats_.mismatches;
+            }
+        }
     }
+
+    return nearestPoint;
 }
 
-template <typename T>
-auto KSOM<T>::time() const -> int
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::learnStep(int idx, const Position& nearestPoint, double minRank, int upcoming,
+                                            Profile* profile, PhaseTimer& timer) -> void
 {
-    return time_;
+    // everything of a dense step that follows the BMU search, which also
+    // gave the rank of the BMU
+    const auto error = metric_.fromRank((*src_)[idx].data(), minRank, dimension_);
+    timer.lap(profile_.searchTime);
+    const auto displacement = learnNode(idx, nearestPoint, upcoming, profile);
+    timer.lap(profile_.updateTime);
+    if ( hierarchical_ ) {
+        refreshPyramid(nearestPoint);
+    }
+    if ( projected_ && (time_ + 1)%PROJECTION_REFRESH_INTERVAL == 0 ) {
+        projection_.build(map_, threadCount());
+    }
+    finishStep(error, displacement);
 }
 
 
-template <typename T>
-auto KSOM<T>::map() const -> std::vector<std::vector<Node<T>>>
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::finishStep(double error, double displacement) -> void
 {
-    return map_;
+    updateConvergence(error, displacement);
+    ++time_;
+    if ( published_ != nullptr && time_%publishInterval_ == 0 ) {
+        publish(*published_);
+    }
 }
 
 
-}
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::computeOnes() -> bool
+{
+    if ( !canCompute() ) {
+        return false;
+    }
 
+    const auto profile = profiling_ ? &profile_ : nullptr;
+    PhaseTimer timer(profiling_);
+    if ( profiling_ && counters_ ) {
+        counters_->start();
+    }
 
-#endif
+    const auto idx = nextIndex();
+    timer.lap(profile_.samplingTime);
+
+    if ( sparse_ ) {
+        const auto nearestPoint = findNearestSparseNode(sparseSrc_[idx], dots_.data(), profile);
+        const auto n            = std::get<0>(nearestPoint)*cols_ + std::get<1>(nearestPoint);
+        const auto error        = sqrt(std::max(0.0, norms_[n] - 2.0*dots_[n] + sparseSrc_[idx].squaredNorm()));
+        timer.lap(profile_.searchTime);
+        const auto displacement = learnSparseNode(idx, nearestPoint, profile);
+        timer.lap(profile_.updateTime);
+        finishStep(error, displacement);
+    } else {
+        auto minRank = 0.0;
+        const auto nearestPoint = searchStep(idx, profile, minRank);
+        learnStep(idx, nearestPoint, minRank, sampler_.peek(), profile, timer);
+    }
+    timer.lap(profile_.bookkeepingTime);
+
+    if ( profiling_ ) {
+        ++profile_.steps;
+        if ( counters_ ) {
+            counters_->stop();
+        }
+    }
 
+    return true;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::compute() -> void
+{
+    while ( computeOnes() ) {
+        ;
+    }
+}
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::computeAsync(const std::function<void(const Progress&)>& callback,
+                                                int interval) throw (std::string) -> TrainingHandle
+{
+    // callback runs on the training thread every interval steps and once more at the end
+    if ( interval < 1 ) {
+        throw std::string("interval must be positive.");
+    }
+
+    const auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    auto result = std::async(std::launch::async, [this, cancelled, callback, interval]() {
+        auto reported = time_;
+        while ( !cancelled->load(std::memory_order_relaxed) && computeOnes() ) {
+            if ( callback && time_%interval == 0 ) {
+                callback(progress());
+                reported = time_;
+            }
+        }
+        if ( callback && reported != time_ ) {
+            callback(progress());
+        }
+
+        return stopReason_ == StopReason::None ? StopReason::Cancelled : stopReason_;
+    });
+
+    return TrainingHandle(cancelled, result.share());
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::progress() const -> Progress
+{
+    return {time_, maxIterate_, calcAlpha(time_), calcSigma(time_), quantizationError_, displacement_};
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::time() const -> int
+{
+    return time_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::map() const -> std::vector<std::vector<Node<T>>>
+{
+    if ( !sparse_ ) {
+        return map_;
+    }
+
+    auto map = map_;
+    for ( auto r = 0; r < rows_; r++ ) {
+        for ( auto c = 0; c < cols_; c++ ) {
+            map[r][c] *= static_cast<T>(scales_[r*cols_ + c]);
+        }
+    }
+
+    return map;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::bmu(const Node<T>& node) const throw (std::string) -> Position
+{
+    if ( node.size() != dimension_ ) {
+        throw std::string("dimension of node is different.");
+    }
+
+    if ( sparse_ ) {
+        return findNearestSparseNode(SparseNode<T>(node), nullptr);
+    }
+
+    return findNearestNode(node);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::bmu(const SparseNode<T>& node) const throw (std::string) -> Position
+{
+    if ( node.size() != dimension_ ) {
+        throw std::string("dimension of node is different.");
+    }
+
+    if ( sparse_ ) {
+        return findNearestSparseNode(node, nullptr);
+    }
+
+    return findNearestNode(node.toNode());
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::initializeLinearly() throw (std::string) -> void
+{
+    if ( sparse_ ) {
+        throw std::string("linear initialization does not support sparse input.");
+    }
+
+    // copied into the existing model vectors, which keeps their NUMA placement
+    const auto map = linearMap(*src_, rows_, cols_);
+    for ( auto r = 0; r < rows_; r++ ) {
+        for ( auto c = 0; c < cols_; c++ ) {
+            std::memcpy(map_[r][c].data(), map[r][c].data(), sizeof(T)*dimension_);
+        }
+    }
+
+    metric_.prepare(map_, dimension_);
+    if ( hierarchical_ ) {
+        pyramid_.build(map_, threadCount());
+    }
+    if ( projected_ ) {
+        projection_.build(map_, threadCount());
+    }
+    pendingIdx_ = -1;
+    indexTime_  = -1;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::enableHierarchicalSearch(int blockSize, int candidates,
+                                                        double tolerance, int checkInterval) throw (std::string) -> void
+{
+    if ( sparse_ ) {
+        throw std::string("hierarchical search does not support sparse input.");
+    }
+    if ( tolerance <= 0.0 || tolerance >= 1.0 ) {
+        throw std::string("tolerance must be between 0 and 1.");
+    }
+
+    pyramid_            = MapPyramid<T>(blockSize, candidates);
+    pyramidTolerance_   = tolerance;
+    checkInterval_      = checkInterval;
+    searchStats_        = {0, 0, 0};
+    pyramid_.build(map_, threadCount());
+    hierarchical_       = true;
+    projected_          = false;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::disableHierarchicalSearch() -> void
+{
+    hierarchical_ = false;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::enableProjectedSearch(int dimension, int candidates,
+                                                        ProjectionMethod method, int checkInterval) throw (std::string) -> void
+{
+    if ( sparse_ ) {
+        throw std::string("projected search does not support sparse input.");
+    }
+    if ( dimension < 1 || dimension > dimension_ ) {
+        throw std::string("projected dimension must be between 1 and dimension.");
+    }
+
+    ProjectedCodebook<T> projection(candidates);
+    projection.setMatrix(method == ProjectionMethod::PCA
+                            ? principalComponents(*src_, dimension).components
+                            : randomProjection(dimension, dimension_));
+    projection.build(map_, threadCount());
+    projection_     = projection;
+    checkInterval_  = checkInterval;
+    searchStats_    = {0, 0, 0};
+    projected_      = true;
+    hierarchical_   = false;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::disableProjectedSearch() -> void
+{
+    projected_ = false;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::enableBlockShuffle(int blockSize) -> void
+{
+    // blockSize of 0 picks as many samples as fit in half of the L2 cache
+    if ( blockSize <= 0 ) {
+        auto bytes = sizeof(T)*dimension_;
+        if ( sparse_ ) {
+            auto nonZeros = 0LL;
+            for ( const auto& node : sparseSrc_ ) {
+                nonZeros += node.nnz();
+            }
+            bytes = (sizeof(int) + sizeof(T))*nonZeros/length_;
+        }
+        blockSize = cacheBlockSize(bytes);
+    }
+    sampler_.setBlockSize(blockSize);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::disableBlockShuffle() -> void
+{
+    sampler_.setBlockSize(0);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::enablePipelining() throw (std::string) -> void
+{
+    // has no effect while an approximate search is enabled
+    if ( sparse_ ) {
+        throw std::string("pipelining does not support sparse input.");
+    }
+    pipelined_ = true;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::disablePipelining() -> void
+{
+    pipelined_  = false;
+    pendingIdx_ = -1;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::setThreads(int threads) throw (std::string) -> void
+{
+    // 0 restores the OpenMP default
+    if ( threads < 0 ) {
+        throw std::string("number of threads must not be negative.");
+    }
+
+    // rows are placed for the threads of a team of the old size
+    const auto team = threadCount();
+    threads_ = threads;
+    if ( !partitionRows_.empty() && threadCount() != team ) {
+        placePartitions();
+    }
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::threads() const -> int
+{
+    return threads_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::setTimeConstant(double timeConstant) throw (std::string) -> void
+{
+    // alpha and sigma decay by e every timeConstant steps; maxIterate by default
+    if ( !(timeConstant > 0.0) ) {
+        throw std::string("time constant must be positive.");
+    }
+
+    timeConstant_ = timeConstant;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::setSeed(uint64_t seed) -> void
+{
+    // the sample of every step from now on only depends on the seed and the step
+    sampler_.setSeed(seed);
+    sampler_.seek(time_);
+    pendingIdx_ = -1;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::seed() const -> uint64_t
+{
+    return sampler_.seed();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::indexSamples() -> const NeuronIndex&
+{
+    // one BMU pass over the input, which is reused until the map changes
+    if ( indexTime_ == time_ ) {
+        return index_;
+    }
+
+    std::vector<int> bmus(length_);
+    #ifdef _OPENMP
+    #pragma omp parallel for num_threads(threadCount()) schedule(dynamic, 64)
+    #endif
+    for ( auto idx = 0; idx < length_; idx++ ) {
+        const auto nearestPoint = sparse_ ? findNearestSparseNode(sparseSrc_[idx], nullptr) : findNearestNode(idx);
+        bmus[idx] = std::get<0>(nearestPoint)*cols_ + std::get<1>(nearestPoint);
+    }
+    index_.build(bmus);
+    indexTime_ = time_;
+
+    return index_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::nearestSamples(const Node<T>& node, int k) const throw (std::string) -> std::vector<int>
+{
+    // Samples of the last indexSamples() nearest to node, searched in square
+    // rings of neurons around its BMU until k samples are found, and then in
+    // one more ring; samples mapped farther away on the lattice are missed.
+    if ( sparse_ ) {
+        throw std::string("nearest samples do not support sparse input.");
+    }
+    if ( k < 1 ) {
+        throw std::string("number of samples must be positive.");
+    }
+    if ( indexTime_ < 0 ) {
+        throw std::string("samples are not indexed.");
+    }
+
+    const auto nearestPoint = bmu(node);
+    const auto bmuRow       = std::get<0>(nearestPoint), bmuCol = std::get<1>(nearestPoint);
+    const auto maxRadius    = std::max(std::max(bmuRow, rows_ - 1 - bmuRow), std::max(bmuCol, cols_ - 1 - bmuCol));
+    std::vector<std::pair<double, int>> candidates;
+    auto lastRadius = maxRadius;
+    for ( auto radius = 0; radius <= lastRadius; radius++ ) {
+        for ( auto r = std::max(0, bmuRow - radius); r <= std::min(rows_ - 1, bmuRow + radius); r++ ) {
+            const auto edge = r == bmuRow - radius || r == bmuRow + radius;
+            for ( auto c = std::max(0, bmuCol - radius); c <= std::min(cols_ - 1, bmuCol + radius); c++ ) {
+                if ( !edge && c != bmuCol - radius && c != bmuCol + radius ) {
+                    continue;
+                }
+                index_.forEach(r, c, [this, &node, &candidates](int idx) {
+                    candidates.emplace_back(calcDistance(node, (*src_)[idx]), idx);
+                });
+            }
+        }
+        if ( static_cast<int>(candidates.size()) >= k && lastRadius == maxRadius ) {
+            lastRadius = std::min(maxRadius, radius + 1);
+        }
+    }
+
+    const auto count = std::min(k, static_cast<int>(candidates.size()));
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+    std::vector<int> nearest(count);
+    for ( auto j = 0; j < count; j++ ) {
+        nearest[j] = candidates[j].second;
+    }
+
+    return nearest;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::tuningKey(bool approximate) const -> std::string
+{
+    // without approximate engines the tuning keeps the current engine, which is part of the key
+    const auto current = currentTuning();
+    std::ostringstream key;
+    key << cpuModel() << '\t' << maxThreads() << '\t' << typeid(T).name() << '\t' << typeid(Metric).name()
+        << '\t' << typeid(Topology).name() << '\t' << rows_ << 'x' << cols_ << 'x' << dimension_
+        << '\t' << (sparse_ ? "sparse" : "dense") << '\t';
+    if ( approximate ) {
+        key << "approximate";
+    } else {
+        key << "exact:" << static_cast<int>(current.engine) << ':' << current.engineSize;
+    }
+
+    return key.str();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::currentTuning() const -> TuningChoice
+{
+    if ( hierarchical_ ) {
+        return {SearchEngine::Hierarchical, pyramid_.blockSize(), threads_, pipelined_};
+    }
+    if ( projected_ ) {
+        return {SearchEngine::Projected, projection_.dimension(), threads_, pipelined_};
+    }
+
+    return {SearchEngine::Exhaustive, 0, threads_, pipelined_};
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::applyTuning(const TuningChoice& choice) -> void
+{
+    // an engine that is already enabled with the same size is kept as it is
+    const auto current          = currentTuning();
+    const auto checkInterval    = checkInterval_;
+    if ( choice.engine == SearchEngine::Exhaustive ) {
+        disableHierarchicalSearch();
+        disableProjectedSearch();
+    } else if ( choice.engine != current.engine || choice.engineSize != current.engineSize ) {
+        if ( choice.engine == SearchEngine::Hierarchical ) {
+            enableHierarchicalSearch(choice.engineSize);
+        } else {
+            enableProjectedSearch(choice.engineSize);
+        }
+        checkInterval_ = checkInterval;
+    }
+
+    setThreads(std::max(0, choice.threads));
+    if ( choice.pipelined && !sparse_ ) {
+        enablePipelining();
+    } else {
+        disablePipelining();
+    }
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::measureTuning(const TuningChoice& choice, int trials) const -> double
+{
+    // seconds per step, the best of a few runs on copies of this model
+    auto best = std::numeric_limits<double>::max();
+    for ( auto repeat = 0; repeat < TUNING_REPEATS; repeat++ ) {
+        KSOM trial(*this);
+        trial.published_                = nullptr;
+        trial.profiling_                = false;
+        trial.criteria_.checkInterval   = 0;
+        trial.stopReason_               = StopReason::None;
+        trial.time_                     = std::max(0, std::min(time_, maxIterate_ - trials - 1));
+        trial.applyTuning(choice);
+
+        // one step to warm up the caches and the thread team
+        trial.computeOnes();
+        const auto begin = std::chrono::steady_clock::now();
+        auto steps = 0;
+        while ( steps < trials && trial.computeOnes() ) {
+            ++steps;
+        }
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        best = std::min(best, elapsed/std::max(1, steps));
+    }
+
+    return best;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::autotune(const std::string& profilePath, bool approximate,
+                                            int trials) throw (std::string) -> TuningChoice
+{
+    // Times trials steps of every candidate on copies of this model and
+    // applies the fastest. With a profile path, a choice cached for this
+    // processor and problem is applied without trials, and a new one is saved.
+    if ( trials < 1 ) {
+        throw std::string("number of trials must be positive.");
+    }
+
+    const auto key = tuningKey(approximate);
+    TuningProfile profile;
+    auto best = currentTuning();
+    if ( !profilePath.empty() && profile.load(profilePath) && profile.find(key, best) ) {
+        applyTuning(best);
+        return best;
+    }
+
+    auto bestTime = std::numeric_limits<double>::max();
+    const auto consider = [&](const TuningChoice& choice) {
+        const auto elapsed = measureTuning(choice, trials);
+        if ( elapsed < bestTime ) {
+            bestTime    = elapsed;
+            best        = choice;
+        }
+    };
+
+    // the threads with the current engine first, then the engines with those threads
+    const auto current = best;
+    for ( const auto threads : threadCandidates() ) {
+        consider({current.engine, current.engineSize, threads, current.pipelined});
+    }
+    if ( !sparse_ ) {
+        std::vector<std::pair<SearchEngine, int>> engines;
+        if ( approximate ) {
+            engines.emplace_back(SearchEngine::Exhaustive, 0);
+            for ( const auto blockSize : {2, 4, 8} ) {
+                if ( rows_ >= 2*blockSize && cols_ >= 2*blockSize ) {
+                    engines.emplace_back(SearchEngine::Hierarchical, blockSize);
+                }
+            }
+            for ( const auto reduced : {8, 16, 32, 64} ) {
+                if ( 2*reduced <= dimension_ ) {
+                    engines.emplace_back(SearchEngine::Projected, reduced);
+                }
+            }
+        } else {
+            engines.emplace_back(current.engine, current.engineSize);
+        }
+
+        const auto threads = best.threads;
+        for ( const auto& engine : engines ) {
+            for ( const auto pipelined : {false, true} ) {
+                const auto measured = engine.first == current.engine && engine.second == current.engineSize
+                                        && pipelined == current.pipelined;
+                if ( measured || (pipelined && engine.first != SearchEngine::Exhaustive) ) {
+                    continue;
+                }
+                consider({engine.first, engine.second, threads, pipelined});
+            }
+        }
+    }
+
+    applyTuning(best);
+    if ( !profilePath.empty() ) {
+        profile.store(key, best);
+        profile.save(profilePath);
+    }
+
+    return best;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::searchStats() const -> SearchStats
+{
+    return searchStats_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::setStoppingCriteria(const StoppingCriteria& criteria) throw (std::string) -> void
+{
+    if ( criteria.smoothing <= 0.0 || criteria.smoothing > 1.0 ) {
+        throw std::string("smoothing must be in (0, 1].");
+    }
+    if ( criteria.patience < 1 ) {
+        throw std::string("patience must be positive.");
+    }
+
+    criteria_       = criteria;
+    checkedError_   = -1.0;
+    stagnantChecks_ = 0;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::quantizationError() const -> double
+{
+    return quantizationError_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::displacement() const -> double
+{
+    return displacement_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::stopReason() const -> StopReason
+{
+    return stopReason_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::isNeighbor(int n1, int n2) const -> bool
+{
+    return topology_.row(n1/cols_, n1%cols_, n2/cols_)[n2%cols_] <= NEIGHBOR_SQ_DISTANCE;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::calcModelDistance(int n1, int n2) const -> double
+{
+    const auto w1 = map_[n1/cols_][n1%cols_].data();
+    const auto w2 = map_[n2/cols_][n2%cols_].data();
+    if ( !sparse_ ) {
+        return metric_.distance(w1, w2, dimension_);
+    }
+
+    const auto scale1 = scales_[n1], scale2 = scales_[n2];
+    auto dis = 0.0;
+    #ifdef _OPENMP
+    #pragma omp simd reduction(+:dis)
+    #endif
+    for ( auto i = 0; i < dimension_; i++ ) {
+        const auto d = scale1*w1[i] - scale2*w2[i];
+        dis += d*d;
+    }
+
+    return sqrt(dis);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::evaluateNodes(const std::vector<Node<T>>& samples, const double* weights) const -> Quality
+{
+    // first and second BMU of a block of samples in one sweep over the map,
+    // so every model vector is loaded once per block instead of once per sample
+    const auto length   = static_cast<int>(samples.size());
+    const auto blocks   = (length + EVALUATION_BLOCK - 1)/EVALUATION_BLOCK;
+    auto errorSum       = 0.0;
+    auto topographicErrors = 0.0;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(+:errorSum, topographicErrors)
+    #endif
+    for ( auto b = 0; b < blocks; b++ ) {
+        const auto begin = b*EVALUATION_BLOCK;
+        const auto count = std::min(EVALUATION_BLOCK, length - begin);
+        double firstDis[EVALUATION_BLOCK], secondDis[EVALUATION_BLOCK];
+        int firstIdx[EVALUATION_BLOCK], secondIdx[EVALUATION_BLOCK];
+        for ( auto k = 0; k < count; k++ ) {
+            firstDis[k] = secondDis[k] = MAX_DISTANCE;
+            firstIdx[k] = secondIdx[k] = 0;
+        }
+
+        for ( auto n = 0; n < rows_*cols_; n++ ) {
+            const auto w = map_[n/cols_][n%cols_].data();
+            for ( auto k = 0; k < count; k++ ) {
+                const auto dis = metric_.rank(samples[begin + k].data(), w, dimension_, n);
+                if ( dis < firstDis[k] ) {
+                    secondDis[k] = firstDis[k];
+                    secondIdx[k] = firstIdx[k];
+                    firstDis[k] = dis;
+                    firstIdx[k] = n;
+                } else if ( dis < secondDis[k] ) {
+                    secondDis[k] = dis;
+                    secondIdx[k] = n;
+                }
+            }
+        }
+
+        for ( auto k = 0; k < count; k++ ) {
+            const auto n        = firstIdx[k];
+            const auto weight   = weights == nullptr ? 1.0 : weights[begin + k];
+            errorSum += weight*metric_.distance(samples[begin + k].data(), map_[n/cols_][n%cols_].data(), dimension_);
+            if ( rows_*cols_ > 1 && !isNeighbor(n, secondIdx[k]) ) {
+                topographicErrors += weight;
+            }
+        }
+    }
+
+    return {errorSum/length, topographicErrors/length};
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::evaluateSparseNodes(const std::vector<SparseNode<T>>& samples,
+                                                    const double* weights) const -> Quality
+{
+    const auto length   = static_cast<int>(samples.size());
+    auto errorSum       = 0.0;
+    auto topographicErrors = 0.0;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) reduction(+:errorSum, topographicErrors)
+    #endif
+    for ( auto s = 0; s < length; s++ ) {
+        auto firstDis = MAX_DISTANCE, secondDis = MAX_DISTANCE;
+        auto firstIdx = 0, secondIdx = 0;
+        for ( auto n = 0; n < rows_*cols_; n++ ) {
+            const auto dis = norms_[n] - 2.0*calcSparseDot(samples[s], n/cols_, n%cols_);
+            if ( dis < firstDis ) {
+                secondDis = firstDis;
+                secondIdx = firstIdx;
+                firstDis = dis;
+                firstIdx = n;
+            } else if ( dis < secondDis ) {
+                secondDis = dis;
+                secondIdx = n;
+            }
+        }
+
+        const auto weight = weights == nullptr ? 1.0 : weights[s];
+        errorSum += weight*sqrt(std::max(0.0, firstDis + samples[s].squaredNorm()));
+        if ( rows_*cols_ > 1 && !isNeighbor(firstIdx, secondIdx) ) {
+            topographicErrors += weight;
+        }
+    }
+
+    return {errorSum/length, topographicErrors/length};
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::evaluate() const -> Quality
+{
+    if ( sparse_ ) {
+        return evaluateSparseNodes(sparseSrc_, weights_.empty() ? nullptr : weights_.data());
+    }
+
+    return evaluateNodes(*src_, weights_.empty() ? nullptr : weights_.data());
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::evaluate(const std::vector<Node<T>>& samples) const throw (std::string) -> Quality
+{
+    if ( samples.empty() ) {
+        throw std::string("samples are empty.");
+    }
+    for ( const auto& node : samples ) {
+        if ( node.size() != dimension_ ) {
+            throw std::string("dimension of node is different.");
+        }
+    }
+
+    if ( sparse_ ) {
+        std::vector<SparseNode<T>> sparseSamples;
+        for ( const auto& node : samples ) {
+            sparseSamples.emplace_back(node);
+        }
+        return evaluateSparseNodes(sparseSamples);
+    }
+
+    return evaluateNodes(samples);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::evaluate(const std::vector<SparseNode<T>>& samples) const throw (std::string) -> Quality
+{
+    if ( samples.empty() ) {
+        throw std::string("samples are empty.");
+    }
+    for ( const auto& node : samples ) {
+        if ( node.size() != dimension_ ) {
+            throw std::string("dimension of node is different.");
+        }
+    }
+
+    if ( !sparse_ ) {
+        std::vector<Node<T>> denseSamples;
+        for ( const auto& node : samples ) {
+            denseSamples.push_back(node.toNode());
+        }
+        return evaluateNodes(denseSamples);
+    }
+
+    return evaluateSparseNodes(samples);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::uMatrix() const -> std::vector<std::vector<double>>
+{
+    // mean distance between every model vector and its neighbors on the map
+    std::vector<std::vector<double>> matrix(rows_, std::vector<double>(cols_, 0.0));
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for ( auto n = 0; n < rows_*cols_; n++ ) {
+        const auto& neighbors = topology_.neighbors(n);
+        if ( neighbors.empty() ) {
+            continue;
+        }
+
+        auto sum = 0.0;
+        for ( const auto m : neighbors ) {
+            sum += calcModelDistance(n, m);
+        }
+        matrix[n/cols_][n%cols_] = sum/neighbors.size();
+    }
+
+    return matrix;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::checkpointData() const -> CheckpointData<T>
+{
+    CheckpointData<T> data;
+    auto& header                = data.header;
+    header.rows                 = rows_;
+    header.cols                 = cols_;
+    header.dimension            = dimension_;
+    header.sparse               = sparse_ ? 1 : 0;
+    header.time                 = time_;
+    header.maxIterate           = maxIterate_;
+    header.alpha0               = alpha0_;
+    header.sigma0               = sigma0_;
+    header.timeConstant         = timeConstant_;
+    header.quantizationError    = quantizationError_;
+    header.displacement         = displacement_;
+    header.checkedError         = checkedError_;
+    header.stagnantChecks       = stagnantChecks_;
+    header.stopReason           = static_cast<int32_t>(stopReason_);
+
+    data.map = std::vector<T>(static_cast<size_t>(rows_)*cols_*dimension_);
+    for ( auto n = 0; n < rows_*cols_; n++ ) {
+        std::memcpy(&data.map[static_cast<size_t>(n)*dimension_], map_[n/cols_][n%cols_].data(), sizeof(T)*dimension_);
+    }
+    data.scales = scales_;
+
+    std::ostringstream rng;
+    sampler_.write(rng);
+    data.rng = rng.str();
+
+    return data;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::checkpoint(const std::string& path) const throw (std::string) -> void
+{
+    auto data = checkpointData();
+    writeCheckpoint(path, data);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::snapshotAsync(const std::string& path) const -> std::future<void>
+{
+    // training only waits for the copy; the returned future rethrows write errors
+    const auto data = std::make_shared<CheckpointData<T>>(checkpointData());
+    return std::async(std::launch::async, [data, path]() {
+        writeCheckpoint(path, *data);
+    });
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::restore(const std::string& path) throw (std::string) -> void
+{
+    const MappedCheckpoint checkpoint(path);
+    const auto& header = checkpoint.header();
+    if ( header.elementSize != sizeof(T) || header.rows != rows_ || header.cols != cols_
+            || header.dimension != dimension_ || (header.sparse != 0) != sparse_ ) {
+        throw std::string("shape of checkpoint is different.");
+    }
+    if ( header.maxIterate != maxIterate_ || header.alpha0 != alpha0_ || header.sigma0 != sigma0_
+            || header.timeConstant != timeConstant_ ) {
+        throw std::string("schedule of checkpoint is different.");
+    }
+
+    // everything is checked before the first change
+    auto sampler = sampler_;
+    std::istringstream rng(checkpoint.rng());
+    if ( header.time < 0 || header.time > maxIterate_ || header.stopReason < static_cast<int32_t>(StopReason::None)
+            || header.stopReason > static_cast<int32_t>(StopReason::Cancelled) || !sampler.read(rng) ) {
+        throw std::string("invalid checkpoint file.");
+    }
+
+    const auto map = checkpoint.map<T>();
+    for ( auto n = 0; n < rows_*cols_; n++ ) {
+        std::memcpy(map_[n/cols_][n%cols_].data(), &map[static_cast<size_t>(n)*dimension_], sizeof(T)*dimension_);
+    }
+    if ( sparse_ ) {
+        const auto scales = checkpoint.scales();
+        for ( auto n = 0; n < rows_*cols_; n++ ) {
+            const auto w = map_[n/cols_][n%cols_].data();
+            auto norm = 0.0;
+            for ( auto i = 0; i < dimension_; i++ ) {
+                norm += static_cast<double>(w[i])*w[i];
+            }
+            scales_[n]  = scales[n];
+            norms_[n]   = scales[n]*scales[n]*norm;
+        }
+    }
+
+    sampler_            = sampler;
+    time_               = header.time;
+    quantizationError_  = header.quantizationError;
+    displacement_       = header.displacement;
+    checkedError_       = header.checkedError;
+    stagnantChecks_     = header.stagnantChecks;
+    stopReason_         = static_cast<StopReason>(header.stopReason);
+
+    metric_.prepare(map_, dimension_);
+    if ( hierarchical_ ) {
+        pyramid_.build(map_, threadCount());
+    }
+    if ( projected_ ) {
+        projection_.build(map_, threadCount());
+    }
+    pendingIdx_ = -1;
+    indexTime_  = -1;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::publish(PublishedMap<T, Metric>& published) const throw (std::string) -> void
+{
+    if ( published.rows() != rows_ || published.cols() != cols_ || published.dimension() != dimension_ ) {
+        throw std::string("shape of published map is different.");
+    }
+
+    published.publish(time_, [this](T* codebook) {
+        for ( auto n = 0; n < rows_*cols_; n++ ) {
+            const auto w    = map_[n/cols_][n%cols_].data();
+            const auto dst  = codebook + static_cast<size_t>(n)*dimension_;
+            if ( sparse_ ) {
+                for ( auto i = 0; i < dimension_; i++ ) {
+                    dst[i] = static_cast<T>(scales_[n]*w[i]);
+                }
+            } else {
+                std::memcpy(dst, w, sizeof(T)*dimension_);
+            }
+        }
+    });
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::setPublishedMap(PublishedMap<T, Metric>* published, int interval) throw (std::string) -> void
+{
+    // publishes now and then every interval steps; nullptr stops publishing
+    if ( published != nullptr ) {
+        if ( interval < 1 ) {
+            throw std::string("interval must be positive.");
+        }
+        publish(*published);
+    }
+
+    published_          = published;
+    publishInterval_    = interval;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::setWeights(const std::vector<double>& weights) throw (std::string) -> void
+{
+    // weights are relative, e.g. the counts of kg::deduplicate(); an empty vector clears them
+    if ( weights.empty() ) {
+        weights_.clear();
+        return;
+    }
+    if ( static_cast<int>(weights.size()) != length_ ) {
+        throw std::string("number of weights is different from number of source nodes.");
+    }
+
+    auto sum = 0.0;
+    for ( const auto weight : weights ) {
+        if ( !(weight >= 0.0) ) {
+            throw std::string("weights must not be negative.");
+        }
+        sum += weight;
+    }
+    if ( sum <= 0.0 ) {
+        throw std::string("sum of weights must be positive.");
+    }
+
+    weights_ = weights;
+    for ( auto& weight : weights_ ) {
+        weight *= length_/sum;
+    }
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::enableNumaPartitioning(int nodes) throw (std::string) -> void
+{
+    // nodes = 0 uses every NUMA node of the machine
+    if ( sparse_ ) {
+        throw std::string("NUMA partitioning does not support sparse input.");
+    }
+    if ( nodes < 0 ) {
+        throw std::string("number of NUMA nodes must not be negative.");
+    }
+
+    const auto partitions = std::min(nodes == 0 ? numaNodeCount() : nodes, rows_);
+    partitionRows_ = numaPartitionRows(rows_, partitions);
+    placePartitions();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::placePartitions() -> void
+{
+    // the threads that will search and update a row allocate it again, so that
+    // first touch (or explicit binding) places its model vectors on their node;
+    // this takes the same team as the search and the update
+    partitionThreads_.assign(rows_, 0);
+    #ifdef _OPENMP
+    #pragma omp parallel num_threads(threadCount())
+    #endif
+    {
+        auto thread = 0;
+        #ifdef _OPENMP
+        thread = omp_get_thread_num();
+        bindToNumaNode(numaPartitionOf(thread, omp_get_num_threads(), numaPartitions()));
+        #endif
+        const auto rows = threadRows();
+        for ( auto r = rows.first; r < rows.second; r++ ) {
+            std::vector<Node<T>> row;
+            row.reserve(cols_);
+            for ( auto c = 0; c < cols_; c++ ) {
+                row.emplace_back(map_[r][c]);
+            }
+            map_[r].swap(row);
+            partitionThreads_[r] = thread;
+        }
+    }
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::disableNumaPartitioning() -> void
+{
+    partitionRows_.clear();
+    partitionThreads_.clear();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::numaPartitions() const -> int
+{
+    return partitionRows_.empty() ? 0 : partitionRows_.size() - 1;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::numaRowThreads() const -> std::vector<int>
+{
+    // empty unless partitioning is enabled
+    return partitionThreads_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::enableProfiling(bool hardwareCounters) -> void
+{
+    // starts from zero; hardware counters are silently left out where the
+    // kernel does not allow them, which profile().hardwareCounters tells
+    profile_    = Profile();
+    counters_   = nullptr;
+    if ( hardwareCounters ) {
+        counters_ = std::make_shared<HardwareCounters>();
+        if ( !counters_->open() ) {
+            counters_ = nullptr;
+        }
+    }
+    profiling_  = true;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::disableProfiling() -> void
+{
+    profiling_ = false;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOM<T, Metric, Topology>::profile() const -> Profile
+{
+    auto profile = profile_;
+    if ( counters_ ) {
+        counters_->read(profile);
+    }
+
+    return profile;
+}
+
+
+}
+
+
+#endif
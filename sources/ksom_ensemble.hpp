@@ -0,0 +1,306 @@
+#ifndef KG_KSOM_ENSEMBLE_H
+#define KG_KSOM_ENSEMBLE_H
+
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <cstdint>
+#include "node.hpp"
+#include "ksom.hpp"
+#include "sampler.hpp"
+
+
+namespace kg {
+
+
+// Trains many KSOMs over one input, e.g. for a sweep over map size, alpha0
+// and sigma0. The models share a single read-only copy of the input and all
+// learn the same sample in a step. Models with the same map shape find their
+// BMUs in one fused sweep over the neurons, so the sample is loaded once per
+// group, and the updates of different models run in parallel. A model that is
+// given its own search engine, threads, NUMA partitioning or pipelining
+// through model() leaves the sweep and searches as it would alone; a
+// pipelined model finds the BMU of the next sample of the ensemble.
+template <typename T, typename Metric=EuclideanMetric, typename Topology=RectangularTopology>
+class KSOMEnsemble {
+private:
+    using Model = KSOM<T, Metric, Topology>;
+    using Map   = std::vector<std::vector<Node<T>>>;
+
+    const std::shared_ptr<const std::vector<Node<T>>> src_;
+    const bool randomIndex_;
+    const Metric metric_;
+    const Topology topology_;
+
+    std::vector<std::unique_ptr<Model>> models_;
+    std::vector<std::vector<int>> groups_;
+    int time_;
+
+    EpochSampler sampler_;
+
+private:
+    inline auto nextIndex() -> int;
+    inline static auto sharesSweep(const Model& model) -> bool;
+    inline auto findNearestNodes(const std::vector<int>& models, int idx,
+                                    std::vector<double>& minRanks) const -> std::vector<typename Model::Position>;
+
+public:
+    KSOMEnsemble(const std::vector<Node<T>>& src, bool randomly=true,
+                    const Metric& metric=Metric(), const Topology& topology=Topology()) throw (std::string);
+    ~KSOMEnsemble();
+
+    auto add(const Map& map, int maxIterate, double alpha0, double sigma0) throw (std::string) -> int;
+    auto computeOnes() -> bool;
+    auto compute() -> void;
+    auto time() const -> int;
+    auto size() const -> int;
+    auto setSeed(uint64_t seed) -> void;
+    auto seed() const -> uint64_t;
+    auto model(int k) -> Model&;
+    auto model(int k) const -> const Model&;
+};
+
+
+template <typename T, typename Metric, typename Topology>
+KSOMEnsemble<T, Metric, Topology>::KSOMEnsemble(const std::vector<Node<T>>& src, bool randomly,
+                                                const Metric& metric, const Topology& topology) throw (std::string)
+    :src_(std::make_shared<const std::vector<Node<T>>>(src))
+    ,randomIndex_(randomly)
+    ,metric_(metric)
+    ,topology_(topology)
+    ,time_(0)
+{
+    if ( src_->empty() ) {
+        throw std::string("source is empty.");
+    }
+
+    sampler_ = EpochSampler(src_->size(), randomIndex_, randomSeed());
+}
+
+
+template <typename T, typename Metric, typename Topology>
+KSOMEnsemble<T, Metric, Topology>::~KSOMEnsemble()
+{
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::nextIndex() -> int
+{
+    return sampler_.next();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::sharesSweep(const Model& model) -> bool
+{
+    return !model.hierarchical_ && !model.projected_ && !model.pipelined_ && model.threads_ == 0
+            && model.partitionRows_.empty();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::findNearestNodes(const std::vector<int>& models, int idx,
+                                                            std::vector<double>& minRanks) const -> std::vector<typename Model::Position>
+{
+    // same result and tie-break as KSOM::findNearestNodeExhaustively for every model
+    const auto x            = (*src_)[idx].data();
+    const auto& first       = *models_[models[0]];
+    const auto cols         = first.cols_;
+    const auto dimension    = first.dimension_;
+    const auto neurons      = first.rows_*cols;
+    const auto count        = static_cast<int>(models.size());
+
+    std::vector<double> minDis(count, MAX_DISTANCE);
+    std::vector<int> minIdx(count, 0);
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        std::vector<double> localMinDis(count, MAX_DISTANCE);
+        std::vector<int> localMinIdx(count, 0);
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for ( auto n = 0; n < neurons; n++ ) {
+            for ( auto m = 0; m < count; m++ ) {
+                const auto& model   = *models_[models[m]];
+                const auto dis      = model.metric_.rank(x, model.map_[n/cols][n%cols].data(), dimension, n);
+                if ( dis < localMinDis[m] ) {
+                    localMinDis[m] = dis;
+                    localMinIdx[m] = n;
+                }
+            }
+        }
+        #ifdef _OPENMP
+        #pragma omp critical (updateEnsembleDistance)
+        #endif
+        {
+            for ( auto m = 0; m < count; m++ ) {
+                if ( localMinDis[m] < minDis[m] || (localMinDis[m] == minDis[m] && localMinIdx[m] < minIdx[m]) ) {
+                    minDis[m] = localMinDis[m];
+                    minIdx[m] = localMinIdx[m];
+                }
+            }
+        }
+    }
+
+    std::vector<typename Model::Position> nearestPoints;
+    for ( auto m = 0; m < count; m++ ) {
+        nearestPoints.push_back(std::make_tuple(minIdx[m]/cols, minIdx[m]%cols));
+    }
+    minRanks = minDis;
+
+    return nearestPoints;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::add(const Map& map, int maxIterate,
+                                            double alpha0, double sigma0) throw (std::string) -> int
+{
+    models_.emplace_back(new Model(src_, map, maxIterate, alpha0, sigma0, randomIndex_, metric_, topology_));
+    const auto k = static_cast<int>(models_.size()) - 1;
+
+    for ( auto& group : groups_ ) {
+        const auto& model = *models_[group[0]];
+        if ( model.rows_ == models_[k]->rows_ && model.cols_ == models_[k]->cols_ ) {
+            group.push_back(k);
+            return k;
+        }
+    }
+    groups_.push_back(std::vector<int>(1, k));
+
+    return k;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::computeOnes() -> bool
+{
+    // steps every model that has not stopped yet with the same sample
+    const auto idx = nextIndex();
+    std::vector<std::pair<int, typename Model::Position>> steps;
+    std::vector<double> stepRanks;
+    for ( const auto& group : groups_ ) {
+        std::vector<int> models;
+        auto profiling = false;
+        for ( const auto k : group ) {
+            if ( !models_[k]->canCompute() ) {
+                continue;
+            }
+            if ( sharesSweep(*models_[k]) ) {
+                models.push_back(k);
+                profiling = profiling || models_[k]->profiling_;
+            } else {
+                auto& model         = *models_[k];
+                const auto profile  = model.profiling_ ? &model.profile_ : nullptr;
+                PhaseTimer timer(model.profiling_);
+                auto minRank = 0.0;
+                steps.emplace_back(k, model.searchStep(idx, profile, minRank));
+                stepRanks.push_back(minRank);
+                timer.lap(model.profile_.searchTime);
+            }
+        }
+        if ( models.empty() ) {
+            continue;
+        }
+
+        PhaseTimer timer(profiling);
+        std::vector<double> minRanks;
+        const auto nearestPoints = findNearestNodes(models, idx, minRanks);
+        auto elapsed = 0LL;
+        timer.lap(elapsed);
+        for ( auto m = 0U; m < models.size(); m++ ) {
+            auto& model = *models_[models[m]];
+            if ( model.profiling_ ) {
+                model.profile_.searchTime           += elapsed;
+                model.profile_.neuronsVisited       += model.rows_*model.cols_;
+                model.profile_.distanceEvaluations  += model.rows_*model.cols_;
+            }
+            steps.emplace_back(models[m], nearestPoints[m]);
+            stepRanks.push_back(minRanks[m]);
+        }
+    }
+    if ( steps.empty() ) {
+        return false;
+    }
+
+    const auto upcoming = sampler_.peek();
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) if(steps.size() > 1)
+    #endif
+    for ( auto s = 0; s < static_cast<int>(steps.size()); s++ ) {
+        auto& model         = *models_[steps[s].first];
+        const auto profile  = model.profiling_ ? &model.profile_ : nullptr;
+        PhaseTimer timer(model.profiling_);
+        model.learnStep(idx, steps[s].second, stepRanks[s], upcoming, profile, timer);
+        timer.lap(model.profile_.bookkeepingTime);
+        if ( profile != nullptr ) {
+            ++profile->steps;
+        }
+    }
+    ++time_;
+
+    return true;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::compute() -> void
+{
+    while ( computeOnes() ) {
+        ;
+    }
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::time() const -> int
+{
+    return time_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::size() const -> int
+{
+    return models_.size();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::setSeed(uint64_t seed) -> void
+{
+    sampler_.setSeed(seed);
+    sampler_.seek(time_);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::seed() const -> uint64_t
+{
+    return sampler_.seed();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::model(int k) -> Model&
+{
+    return *models_[k];
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto KSOMEnsemble<T, Metric, Topology>::model(int k) const -> const Model&
+{
+    return *models_[k];
+}
+
+
+}
+
+
+#endif
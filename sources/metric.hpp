@@ -0,0 +1,306 @@
+#ifndef KG_METRIC_H
+#define KG_METRIC_H
+
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include "node.hpp"
+
+
+namespace kg {
+
+
+// Distance metrics are passed to KSOM as a template parameter.
+// distance() is the true distance between two vectors, while rank() is a
+// cheaper value with the same ordering that the BMU search compares, and
+// fromRank() turns the rank of x back into its distance.
+// prepare() and update() let a metric cache per-neuron data of the map.
+
+
+class EuclideanMetric {
+public:
+    template <typename T>
+    auto prepare(const std::vector<std::vector<Node<T>>>& map, int dimension) throw (std::string) -> void;
+    template <typename T>
+    auto update(const T* w, int dimension, int n) -> void;
+    template <typename T>
+    auto rank(const T* x, const T* w, int dimension, int n) const -> double;
+    template <typename T>
+    auto distance(const T* x, const T* w, int dimension) const -> double;
+    template <typename T>
+    auto fromRank(const T* x, double rank, int dimension) const -> double;
+};
+
+
+class ManhattanMetric {
+public:
+    template <typename T>
+    auto prepare(const std::vector<std::vector<Node<T>>>& map, int dimension) throw (std::string) -> void;
+    template <typename T>
+    auto update(const T* w, int dimension, int n) -> void;
+    template <typename T>
+    auto rank(const T* x, const T* w, int dimension, int n) const -> double;
+    template <typename T>
+    auto distance(const T* x, const T* w, int dimension) const -> double;
+    template <typename T>
+    auto fromRank(const T* x, double rank, int dimension) const -> double;
+};
+
+
+class WeightedEuclideanMetric {
+private:
+    std::vector<double> weights_;
+
+public:
+    WeightedEuclideanMetric(const std::vector<double>& weights=std::vector<double>());
+    template <typename T>
+    auto prepare(const std::vector<std::vector<Node<T>>>& map, int dimension) throw (std::string) -> void;
+    template <typename T>
+    auto update(const T* w, int dimension, int n) -> void;
+    template <typename T>
+    auto rank(const T* x, const T* w, int dimension, int n) const -> double;
+    template <typename T>
+    auto distance(const T* x, const T* w, int dimension) const -> double;
+    template <typename T>
+    auto fromRank(const T* x, double rank, int dimension) const -> double;
+};
+
+
+// keeps 1/||w|| of every neuron, so the BMU search is a single dot product
+// against an implicitly normalized map
+class CosineMetric {
+private:
+    std::vector<double> invNorms_;
+
+private:
+    template <typename T>
+    static auto calcInvNorm(const T* w, int dimension) -> double;
+
+public:
+    template <typename T>
+    auto prepare(const std::vector<std::vector<Node<T>>>& map, int dimension) throw (std::string) -> void;
+    template <typename T>
+    auto update(const T* w, int dimension, int n) -> void;
+    template <typename T>
+    auto rank(const T* x, const T* w, int dimension, int n) const -> double;
+    template <typename T>
+    auto distance(const T* x, const T* w, int dimension) const -> double;
+    template <typename T>
+    auto fromRank(const T* x, double rank, int dimension) const -> double;
+};
+
+
+template <typename T>
+auto EuclideanMetric::prepare(const std::vector<std::vector<Node<T>>>&, int) throw (std::string) -> void
+{
+}
+
+
+template <typename T>
+auto EuclideanMetric::update(const T*, int, int) -> void
+{
+}
+
+
+template <typename T>
+auto EuclideanMetric::rank(const T* x, const T* w, int dimension, int) const -> double
+{
+    auto dis = 0.0;
+    #ifdef _OPENMP
+    #pragma omp simd reduction(+:dis)
+    #endif
+    for ( int i = 0; i < dimension; i++ ) {
+        const auto d = static_cast<double>(x[i]) - static_cast<double>(w[i]);
+        dis += d*d;
+    }
+
+    return dis;
+}
+
+
+template <typename T>
+auto EuclideanMetric::distance(const T* x, const T* w, int dimension) const -> double
+{
+    return sqrt(rank(x, w, dimension, 0));
+}
+
+
+template <typename T>
+auto EuclideanMetric::fromRank(const T*, double rank, int) const -> double
+{
+    return sqrt(rank);
+}
+
+
+template <typename T>
+auto ManhattanMetric::prepare(const std::vector<std::vector<Node<T>>>&, int) throw (std::string) -> void
+{
+}
+
+
+template <typename T>
+auto ManhattanMetric::update(const T*, int, int) -> void
+{
+}
+
+
+template <typename T>
+auto ManhattanMetric::rank(const T* x, const T* w, int dimension, int) const -> double
+{
+    auto dis = 0.0;
+    #ifdef _OPENMP
+    #pragma omp simd reduction(+:dis)
+    #endif
+    for ( int i = 0; i < dimension; i++ ) {
+        dis += std::fabs(static_cast<double>(x[i]) - static_cast<double>(w[i]));
+    }
+
+    return dis;
+}
+
+
+template <typename T>
+auto ManhattanMetric::distance(const T* x, const T* w, int dimension) const -> double
+{
+    return rank(x, w, dimension, 0);
+}
+
+
+template <typename T>
+auto ManhattanMetric::fromRank(const T*, double rank, int) const -> double
+{
+    return rank;
+}
+
+
+inline WeightedEuclideanMetric::WeightedEuclideanMetric(const std::vector<double>& weights)
+    :weights_(weights)
+{
+}
+
+
+template <typename T>
+auto WeightedEuclideanMetric::prepare(const std::vector<std::vector<Node<T>>>&, int dimension) throw (std::string) -> void
+{
+    if ( weights_.size() != static_cast<size_t>(dimension) ) {
+        throw std::string("dimension of metric weights is different.");
+    }
+}
+
+
+template <typename T>
+auto WeightedEuclideanMetric::update(const T*, int, int) -> void
+{
+}
+
+
+template <typename T>
+auto WeightedEuclideanMetric::rank(const T* x, const T* w, int dimension, int) const -> double
+{
+    const auto weights = weights_.data();
+    auto dis = 0.0;
+    #ifdef _OPENMP
+    #pragma omp simd reduction(+:dis)
+    #endif
+    for ( int i = 0; i < dimension; i++ ) {
+        const auto d = static_cast<double>(x[i]) - static_cast<double>(w[i]);
+        dis += weights[i]*d*d;
+    }
+
+    return dis;
+}
+
+
+template <typename T>
+auto WeightedEuclideanMetric::distance(const T* x, const T* w, int dimension) const -> double
+{
+    return sqrt(rank(x, w, dimension, 0));
+}
+
+
+template <typename T>
+auto WeightedEuclideanMetric::fromRank(const T*, double rank, int) const -> double
+{
+    return sqrt(rank);
+}
+
+
+template <typename T>
+auto CosineMetric::calcInvNorm(const T* w, int dimension) -> double
+{
+    auto norm = 0.0;
+    #ifdef _OPENMP
+    #pragma omp simd reduction(+:norm)
+    #endif
+    for ( int i = 0; i < dimension; i++ ) {
+        norm += static_cast<double>(w[i])*static_cast<double>(w[i]);
+    }
+
+    return norm > 0.0 ? 1.0/sqrt(norm) : 0.0;
+}
+
+
+template <typename T>
+auto CosineMetric::prepare(const std::vector<std::vector<Node<T>>>& map, int dimension) throw (std::string) -> void
+{
+    const auto cols = map[0].size();
+    invNorms_ = std::vector<double>(map.size()*cols);
+    for ( auto r = 0U; r < map.size(); r++ ) {
+        for ( auto c = 0U; c < cols; c++ ) {
+            invNorms_[r*cols + c] = calcInvNorm(map[r][c].data(), dimension);
+        }
+    }
+}
+
+
+template <typename T>
+auto CosineMetric::update(const T* w, int dimension, int n) -> void
+{
+    invNorms_[n] = calcInvNorm(w, dimension);
+}
+
+
+template <typename T>
+auto CosineMetric::rank(const T* x, const T* w, int dimension, int n) const -> double
+{
+    // ||x|| is the same for every neuron, so it does not change the ordering
+    auto dot = 0.0;
+    #ifdef _OPENMP
+    #pragma omp simd reduction(+:dot)
+    #endif
+    for ( int i = 0; i < dimension; i++ ) {
+        dot += static_cast<double>(x[i])*static_cast<double>(w[i]);
+    }
+
+    return -dot*invNorms_[n];
+}
+
+
+template <typename T>
+auto CosineMetric::distance(const T* x, const T* w, int dimension) const -> double
+{
+    auto dot = 0.0;
+    #ifdef _OPENMP
+    #pragma omp simd reduction(+:dot)
+    #endif
+    for ( int i = 0; i < dimension; i++ ) {
+        dot += static_cast<double>(x[i])*static_cast<double>(w[i]);
+    }
+
+    return 1.0 - dot*calcInvNorm(x, dimension)*calcInvNorm(w, dimension);
+}
+
+
+template <typename T>
+auto CosineMetric::fromRank(const T* x, double rank, int dimension) const -> double
+{
+    // the rank lacks only the 1/||x|| factor of the cosine similarity
+    return 1.0 + rank*calcInvNorm(x, dimension);
+}
+
+
+}
+
+
+#endif
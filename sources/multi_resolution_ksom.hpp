@@ -0,0 +1,317 @@
+#ifndef KG_MULTI_RESOLUTION_KSOM_H
+#define KG_MULTI_RESOLUTION_KSOM_H
+
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include "node.hpp"
+#include "ksom.hpp"
+
+
+namespace kg {
+
+
+namespace {
+    constexpr auto REFINEMENT_SHARE = 0.1;
+};
+
+
+// Trains a small map first and repeatedly upsamples its model vectors by
+// bilinear interpolation until the final size is reached. The maxIterate
+// steps are split over the levels: the final level only gets a short
+// refinement of REFINEMENT_SHARE of them, and the coarser levels share the
+// rest. Every level follows one schedule over all maxIterate steps from the
+// step where the level begins, with sigma rescaled to the lattice of the
+// level. Level k samples with the seed plus k.
+template <typename T, typename Metric=EuclideanMetric, typename Topology=RectangularTopology>
+class MultiResolutionKSOM {
+private:
+    using Map = std::vector<std::vector<Node<T>>>;
+
+    const std::shared_ptr<const std::vector<Node<T>>> src_;
+    const int finalRows_;
+    const int finalCols_;
+    const int maxIterate_;
+    const double scale_;
+    const bool randomIndex_;
+    const Metric metric_;
+    const Topology topology_;
+
+    // shape and number of steps of every level
+    std::vector<std::pair<int, int>> shapes_;
+    std::vector<int> steps_;
+
+    std::unique_ptr<KSOM<T, Metric, Topology>> ksom_;
+    int rows_;
+    int cols_;
+    const double alpha0_;
+    const double sigma0_;
+    int level_;
+    int time_;
+    long long work_;
+    uint64_t seed_;
+
+private:
+    inline auto planLevels() -> void;
+    inline auto levelKSOM(const Map& map) const -> std::unique_ptr<KSOM<T, Metric, Topology>>;
+    inline auto nextLevel() -> bool;
+
+public:
+    MultiResolutionKSOM(const std::vector<Node<T>>& src, const Map& map,
+                        int finalRows, int finalCols, int maxIterate,
+                        double alpha0, double sigma0, double scale=2.0,
+                        bool randomly=true, const Metric& metric=Metric(),
+                        const Topology& topology=Topology()) throw (std::string);
+    ~MultiResolutionKSOM();
+
+    static auto upsample(const Map& map, int rows, int cols) -> Map;
+
+    auto computeOnes() -> bool;
+    auto compute() -> void;
+    auto time() const -> int;
+    auto progress() const -> Progress;
+    auto level() const -> int;
+    auto work() const -> long long;
+    auto map() const -> Map;
+    auto setSeed(uint64_t seed) -> void;
+    auto seed() const -> uint64_t;
+};
+
+
+template <typename T, typename Metric, typename Topology>
+MultiResolutionKSOM<T, Metric, Topology>::MultiResolutionKSOM(const std::vector<Node<T>>& src,
+                                                                const Map& map,
+                                                                int finalRows, int finalCols,
+                                                                int maxIterate, double alpha0,
+                                                                double sigma0, double scale,
+                                                                bool randomly, const Metric& metric,
+                                                                const Topology& topology) throw (std::string)
+    :src_(std::make_shared<const std::vector<Node<T>>>(src))
+    ,finalRows_(finalRows)
+    ,finalCols_(finalCols)
+    ,maxIterate_(maxIterate)
+    ,scale_(scale)
+    ,randomIndex_(randomly)
+    ,metric_(metric)
+    ,topology_(topology)
+    ,rows_(map.size())
+    ,cols_(map[0].size())
+    ,alpha0_(alpha0)
+    ,sigma0_(sigma0)
+    ,level_(0)
+    ,time_(0)
+    ,work_(0)
+    ,seed_(randomSeed())
+{
+    if ( scale_ <= 1.0 ) {
+        throw std::string("scale must be greater than 1.");
+    }
+    if ( rows_ > finalRows_ || cols_ > finalCols_ ) {
+        throw std::string("initial map is larger than final map.");
+    }
+
+    planLevels();
+    ksom_ = levelKSOM(map);
+    ksom_->setSeed(seed_);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+MultiResolutionKSOM<T, Metric, Topology>::~MultiResolutionKSOM()
+{
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::upsample(const Map& map, int rows, int cols) -> Map
+{
+    const auto srcRows = static_cast<int>(map.size()), srcCols = static_cast<int>(map[0].size());
+    const auto dimension = map[0][0].size();
+    const auto rowStep = rows > 1 ? static_cast<double>(srcRows - 1)/(rows - 1) : 0.0;
+    const auto colStep = cols > 1 ? static_cast<double>(srcCols - 1)/(cols - 1) : 0.0;
+
+    Map upsampled(rows, std::vector<Node<T>>(cols, Node<T>(dimension)));
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for ( auto r = 0; r < rows; r++ ) {
+        const auto y    = r*rowStep;
+        const auto r0   = std::min(static_cast<int>(y), srcRows - 1);
+        const auto r1   = std::min(r0 + 1, srcRows - 1);
+        const auto fy   = y - r0;
+        for ( auto c = 0; c < cols; c++ ) {
+            const auto x    = c*colStep;
+            const auto c0   = std::min(static_cast<int>(x), srcCols - 1);
+            const auto c1   = std::min(c0 + 1, srcCols - 1);
+            const auto fx   = x - c0;
+
+            const auto w00 = map[r0][c0].data(), w01 = map[r0][c1].data();
+            const auto w10 = map[r1][c0].data(), w11 = map[r1][c1].data();
+            const auto w = upsampled[r][c].data();
+            for ( auto i = 0; i < dimension; i++ ) {
+                const auto top      = (1.0 - fx)*w00[i] + fx*w01[i];
+                const auto bottom   = (1.0 - fx)*w10[i] + fx*w11[i];
+                w[i] = static_cast<T>((1.0 - fy)*top + fy*bottom);
+            }
+        }
+    }
+
+    return upsampled;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::planLevels() -> void
+{
+    auto rows = rows_, cols = cols_;
+    shapes_.emplace_back(rows, cols);
+    while ( rows < finalRows_ || cols < finalCols_ ) {
+        rows = std::min(finalRows_, std::max(rows + 1, static_cast<int>(std::lround(rows*scale_))));
+        cols = std::min(finalCols_, std::max(cols + 1, static_cast<int>(std::lround(cols*scale_))));
+        shapes_.emplace_back(rows, cols);
+    }
+
+    // every level runs at least one step
+    const auto levels = static_cast<int>(shapes_.size());
+    if ( levels == 1 ) {
+        steps_.push_back(maxIterate_);
+        return;
+    }
+    const auto refinement = std::max(1, static_cast<int>(std::lround(maxIterate_*REFINEMENT_SHARE)));
+    const auto coarse = std::max(0, maxIterate_ - refinement);
+    for ( auto k = 0; k < levels - 1; k++ ) {
+        steps_.push_back(std::max(1, coarse/(levels - 1) + (k < coarse%(levels - 1) ? 1 : 0)));
+    }
+    steps_.push_back(refinement);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::levelKSOM(const Map& map) const -> std::unique_ptr<KSOM<T, Metric, Topology>>
+{
+    // alpha and sigma of the whole schedule at the first step of the level,
+    // decaying with the time constant of the whole schedule from there on
+    auto start = 0;
+    for ( auto k = 0; k < level_; k++ ) {
+        start += steps_[k];
+    }
+    const auto decay = exp(-static_cast<double>(start)/maxIterate_);
+    const auto growth = std::max(static_cast<double>(shapes_[level_].first)/shapes_[0].first,
+                                    static_cast<double>(shapes_[level_].second)/shapes_[0].second);
+    const auto sigma0 = level_ == 0 ? sigma0_ : std::max(1.0, growth*sigma0_*decay);
+
+    auto ksom = std::make_unique<KSOM<T, Metric, Topology>>(src_, map, steps_[level_], alpha0_*decay, sigma0,
+                                                            randomIndex_, metric_, topology_);
+    ksom->setTimeConstant(maxIterate_);
+
+    return ksom;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::nextLevel() -> bool
+{
+    if ( level_ + 1 >= static_cast<int>(shapes_.size()) ) {
+        return false;
+    }
+
+    const auto map = upsample(ksom_->map(), shapes_[level_ + 1].first, shapes_[level_ + 1].second);
+    ++level_;
+    rows_ = shapes_[level_].first;
+    cols_ = shapes_[level_].second;
+    ksom_ = levelKSOM(map);
+    ksom_->setSeed(seed_ + level_);
+
+    return true;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::computeOnes() -> bool
+{
+    if ( !ksom_->computeOnes() ) {
+        if ( !nextLevel() || !ksom_->computeOnes() ) {
+            return false;
+        }
+    }
+
+    ++time_;
+    work_ += static_cast<long long>(rows_)*cols_;
+
+    return true;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::compute() -> void
+{
+    while ( computeOnes() ) {
+        ;
+    }
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::time() const -> int
+{
+    return time_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::progress() const -> Progress
+{
+    // alpha and sigma of the next step of the current level
+    auto progress       = ksom_->progress();
+    progress.time       = time_;
+    progress.maxIterate = maxIterate_;
+
+    return progress;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::level() const -> int
+{
+    return level_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::work() const -> long long
+{
+    return work_;
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::map() const -> Map
+{
+    return ksom_->map();
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::setSeed(uint64_t seed) -> void
+{
+    seed_ = seed;
+    ksom_->setSeed(seed_ + level_);
+}
+
+
+template <typename T, typename Metric, typename Topology>
+auto MultiResolutionKSOM<T, Metric, Topology>::seed() const -> uint64_t
+{
+    return seed_;
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,188 @@
+#ifndef KG_NEURON_INDEX_H
+#define KG_NEURON_INDEX_H
+
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+
+namespace kg {
+
+
+// Samples grouped by their BMU in CSR form: the samples of neuron n are
+// samples_[offsets_[n]] ... samples_[offsets_[n + 1] - 1], in increasing
+// order, so that the samples of a neuron or of a region of the map are
+// found without another pass over the input.
+class NeuronIndex {
+private:
+    int rows_;
+    int cols_;
+    std::vector<int> bmus_;
+    std::vector<int> offsets_;
+    std::vector<int> samples_;
+
+public:
+    NeuronIndex(int rows=0, int cols=0);
+
+    auto build(const std::vector<int>& bmus) throw (std::string) -> void;
+    auto size() const -> int;
+    auto bmu(int idx) const -> int;
+    auto hits(int r, int c) const -> int;
+    auto hits() const -> std::vector<std::vector<int>>;
+    auto samples(int r, int c) const -> std::vector<int>;
+    auto region(int r0, int c0, int r1, int c1) const -> std::vector<int>;
+    auto majorityLabels(const std::vector<int>& labels) const throw (std::string) -> std::vector<std::vector<int>>;
+    template <typename Visit>
+    auto forEach(int r, int c, Visit visit) const -> void;
+};
+
+
+inline NeuronIndex::NeuronIndex(int rows, int cols)
+    :rows_(rows)
+    ,cols_(cols)
+    ,offsets_(rows*cols + 1, 0)
+{
+}
+
+
+inline auto NeuronIndex::build(const std::vector<int>& bmus) throw (std::string) -> void
+{
+    // bmus[idx] is the neuron r*cols + c of sample idx
+    const auto neurons = rows_*cols_;
+    std::vector<int> offsets(neurons + 1, 0);
+    for ( const auto n : bmus ) {
+        if ( n < 0 || n >= neurons ) {
+            throw std::string("BMU is out of the map.");
+        }
+        ++offsets[n + 1];
+    }
+    for ( auto n = 0; n < neurons; n++ ) {
+        offsets[n + 1] += offsets[n];
+    }
+
+    std::vector<int> samples(bmus.size());
+    auto cursor = offsets;
+    for ( auto idx = 0; idx < static_cast<int>(bmus.size()); idx++ ) {
+        samples[cursor[bmus[idx]]++] = idx;
+    }
+
+    bmus_       = bmus;
+    offsets_    = std::move(offsets);
+    samples_    = std::move(samples);
+}
+
+
+inline auto NeuronIndex::size() const -> int
+{
+    return bmus_.size();
+}
+
+
+inline auto NeuronIndex::bmu(int idx) const -> int
+{
+    return bmus_[idx];
+}
+
+
+inline auto NeuronIndex::hits(int r, int c) const -> int
+{
+    const auto n = r*cols_ + c;
+    return offsets_[n + 1] - offsets_[n];
+}
+
+
+inline auto NeuronIndex::hits() const -> std::vector<std::vector<int>>
+{
+    std::vector<std::vector<int>> histogram(rows_, std::vector<int>(cols_));
+    for ( auto r = 0; r < rows_; r++ ) {
+        for ( auto c = 0; c < cols_; c++ ) {
+            histogram[r][c] = hits(r, c);
+        }
+    }
+
+    return histogram;
+}
+
+
+inline auto NeuronIndex::samples(int r, int c) const -> std::vector<int>
+{
+    const auto n = r*cols_ + c;
+    return std::vector<int>(samples_.begin() + offsets_[n], samples_.begin() + offsets_[n + 1]);
+}
+
+
+inline auto NeuronIndex::region(int r0, int c0, int r1, int c1) const -> std::vector<int>
+{
+    // samples of the rows [r0, r1) and columns [c0, c1), clipped to the map, neuron by neuron
+    r0 = std::max(r0, 0);
+    c0 = std::max(c0, 0);
+    r1 = std::min(r1, rows_);
+    c1 = std::min(c1, cols_);
+    std::vector<int> found;
+    for ( auto r = r0; r < r1; r++ ) {
+        if ( c0 < c1 ) {
+            found.insert(found.end(), samples_.begin() + offsets_[r*cols_ + c0], samples_.begin() + offsets_[r*cols_ + c1]);
+        }
+    }
+
+    return found;
+}
+
+
+inline auto NeuronIndex::majorityLabels(const std::vector<int>& labels) const throw (std::string) -> std::vector<std::vector<int>>
+{
+    // the most frequent non-negative label of the samples of every neuron,
+    // the smallest one on ties, and -1 for neurons without labelled samples
+    if ( labels.size() != bmus_.size() ) {
+        throw std::string("number of labels is different from number of samples.");
+    }
+
+    std::vector<std::vector<int>> majority(rows_, std::vector<int>(cols_, -1));
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic, 16)
+    #endif
+    for ( auto n = 0; n < rows_*cols_; n++ ) {
+        std::vector<int> votes;
+        for ( auto k = offsets_[n]; k < offsets_[n + 1]; k++ ) {
+            if ( labels[samples_[k]] >= 0 ) {
+                votes.push_back(labels[samples_[k]]);
+            }
+        }
+        std::sort(votes.begin(), votes.end());
+
+        auto best = -1, bestCount = 0;
+        for ( auto begin = 0U; begin < votes.size(); ) {
+            auto end = begin;
+            while ( end < votes.size() && votes[end] == votes[begin] ) {
+                ++end;
+            }
+            if ( static_cast<int>(end - begin) > bestCount ) {
+                best        = votes[begin];
+                bestCount   = end - begin;
+            }
+            begin = end;
+        }
+        majority[n/cols_][n%cols_] = best;
+    }
+
+    return majority;
+}
+
+
+template <typename Visit>
+auto NeuronIndex::forEach(int r, int c, Visit visit) const -> void
+{
+    // calls visit(idx) for every sample of the neuron without copying them
+    const auto n = r*cols_ + c;
+    for ( auto k = offsets_[n]; k < offsets_[n + 1]; k++ ) {
+        visit(samples_[k]);
+    }
+}
+
+
+}
+
+
+#endif
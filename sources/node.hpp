@@ -14,12 +14,14 @@ class Node {
 private:
     T* elems_;
     size_t size_;
+    bool owner_;
 
 private:
     auto copyMember(const Node<T>& rhs) -> void;
 
 public:
     Node(size_t size=1);
+    Node(T* elems, size_t size);
     Node(const Node<T>& rhs);
     ~Node();
     auto operator+() const -> Node<T>;
@@ -44,6 +46,7 @@ public:
     auto operator[](size_t idx) const -> T&;
     auto setElem(T elem, size_t idx) -> void;
     auto elem(size_t idx) const -> T;
+    auto data() const -> T*;
     auto size() const -> int;
 };
 
@@ -63,15 +66,27 @@ auto Node<T>::copyMember(const Node<T>& rhs) -> void
 template <typename T>
 Node<T>::Node(size_t size)
     :size_(size)
+    ,owner_(true)
 {
     elems_ = new T[size_];
     std::memset(elems_, 0, sizeof(T)*size_);
 }
 
 
+// refers to elems, which must outlive the node; a copy owns its elements
+template <typename T>
+Node<T>::Node(T* elems, size_t size)
+    :elems_(elems)
+    ,size_(size)
+    ,owner_(false)
+{
+}
+
+
 template <typename T>
 Node<T>::Node(const Node<T>& rhs)
     :size_(rhs.size_)
+    ,owner_(true)
 {
     elems_ = new T[size_];
     copyMember(rhs);
@@ -81,7 +96,9 @@ Node<T>::Node(const Node<T>& rhs)
 template <typename T>
 Node<T>::~Node()
 {
-    delete[] elems_;
+    if ( owner_ ) {
+        delete[] elems_;
+    }
 }
 
 
@@ -262,7 +279,10 @@ auto Node<T>::operator=(const Node& rhs) -> Node<T>&
 
     T* tmp = elems_;
     elems_ = new T[size_];
-    delete[] tmp;
+    if ( owner_ ) {
+        delete[] tmp;
+    }
+    owner_ = true;
     copyMember(rhs);
 
     return *this;
@@ -437,6 +457,13 @@ auto Node<T>::elem(size_t idx) const -> T
 }
 
 
+template <typename T>
+auto Node<T>::data() const -> T*
+{
+    return elems_;
+}
+
+
 template <typename T>
 auto Node<T>::size() const -> int
 {
@@ -0,0 +1,99 @@
+#ifndef KG_NUMA_H
+#define KG_NUMA_H
+
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <dirent.h>
+#ifdef KSOM_NUMA
+#include <numa.h>
+#endif
+
+
+namespace kg {
+
+
+// Helpers for splitting the rows of a map across NUMA nodes.
+// Without KSOM_NUMA, nodes are counted from sysfs and placement relies on
+// first touch by threads pinned through OMP_PROC_BIND/OMP_PLACES; with
+// KSOM_NUMA (link with -lnuma) threads are also bound to their node explicitly.
+
+
+inline auto numaNodeCount() -> int
+{
+    #ifdef KSOM_NUMA
+    if ( numa_available() >= 0 ) {
+        return std::max(1, numa_max_node() + 1);
+    }
+    #endif
+
+    auto count = 0;
+    if ( const auto dir = opendir("/sys/devices/system/node") ) {
+        while ( const auto entry = readdir(dir) ) {
+            if ( std::strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9' ) {
+                ++count;
+            }
+        }
+        closedir(dir);
+    }
+
+    return std::max(1, count);
+}
+
+
+inline auto bindToNumaNode(int node) -> bool
+{
+    #ifdef KSOM_NUMA
+    return numa_available() >= 0 && numa_run_on_node(node) == 0;
+    #else
+    (void)node;
+    return false;
+    #endif
+}
+
+
+// first row of every partition followed by the number of rows
+inline auto numaPartitionRows(int rows, int partitions) -> std::vector<int>
+{
+    std::vector<int> bounds(partitions + 1);
+    for ( auto p = 0; p <= partitions; p++ ) {
+        bounds[p] = static_cast<long long>(rows)*p/partitions;
+    }
+
+    return bounds;
+}
+
+
+// partition of thread out of threads: threads are dealt to the partitions in
+// contiguous groups, matching OMP_PROC_BIND=close, and share its rows evenly
+inline auto numaPartitionOf(int thread, int threads, int partitions) -> int
+{
+    return threads >= partitions ? thread*partitions/threads : (thread*partitions + threads - 1)/threads;
+}
+
+
+inline auto numaThreadRows(const std::vector<int>& bounds, int thread, int threads) -> std::pair<int, int>
+{
+    const auto partitions = static_cast<int>(bounds.size()) - 1;
+    if ( threads < partitions ) {
+        const auto first = (thread*partitions + threads - 1)/threads;
+        const auto last  = ((thread + 1)*partitions + threads - 1)/threads;
+        return std::make_pair(bounds[first], bounds[last]);
+    }
+
+    const auto p        = thread*partitions/threads;
+    const auto first    = (p*threads + partitions - 1)/partitions;
+    const auto count    = ((p + 1)*threads + partitions - 1)/partitions - first;
+    const auto k        = thread - first;
+    const auto rows     = bounds[p + 1] - bounds[p];
+
+    return std::make_pair(bounds[p] + rows*k/count, bounds[p] + rows*(k + 1)/count);
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef KG_PCA_H
+#define KG_PCA_H
+
+
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include "node.hpp"
+
+
+namespace kg {
+
+
+namespace {
+    constexpr auto PCA_OVERSAMPLING = 8;
+    constexpr auto PCA_SEED = 1U;
+    constexpr auto JACOBI_SWEEPS = 64;
+};
+
+
+// components are orthonormal rows of length dimension, sorted by
+// decreasing variance of the input along them
+struct PrincipalComponents {
+    std::vector<double> mean;
+    std::vector<std::vector<double>> components;
+    std::vector<double> variances;
+};
+
+
+// orthonormalizes the columns of the rows x cols row-major matrix a; a
+// column that depends on the previous ones is replaced by the first unit
+// vector that does not, so the columns always span cols dimensions
+inline auto orthonormalizeColumns(std::vector<double>& a, int rows, int cols) -> void
+{
+    auto unit = 0;
+    for ( auto j = 0; j < cols; j++ ) {
+        auto original = 0.0;
+        for ( auto i = 0; i < rows; i++ ) {
+            original += a[i*cols + j]*a[i*cols + j];
+        }
+
+        while ( true ) {
+            for ( auto k = 0; k < j; k++ ) {
+                auto dot = 0.0;
+                for ( auto i = 0; i < rows; i++ ) {
+                    dot += a[i*cols + j]*a[i*cols + k];
+                }
+                for ( auto i = 0; i < rows; i++ ) {
+                    a[i*cols + j] -= dot*a[i*cols + k];
+                }
+            }
+
+            auto norm = 0.0;
+            for ( auto i = 0; i < rows; i++ ) {
+                norm += a[i*cols + j]*a[i*cols + j];
+            }
+            if ( norm > 1.0e-20*original && norm > 1.0e-300 ) {
+                norm = sqrt(norm);
+                for ( auto i = 0; i < rows; i++ ) {
+                    a[i*cols + j] /= norm;
+                }
+                break;
+            }
+
+            for ( auto i = 0; i < rows; i++ ) {
+                a[i*cols + j] = i == unit ? 1.0 : 0.0;
+            }
+            original = 1.0;
+            ++unit;
+        }
+    }
+}
+
+
+// cyclic Jacobi eigendecomposition of the symmetric size x size matrix a;
+// a ends up diagonal and the columns of vectors are the eigenvectors
+inline auto symmetricEigen(std::vector<double>& a, int size, std::vector<double>& vectors) -> void
+{
+    vectors = std::vector<double>(size*size, 0.0);
+    for ( auto i = 0; i < size; i++ ) {
+        vectors[i*size + i] = 1.0;
+    }
+
+    for ( auto sweep = 0; sweep < JACOBI_SWEEPS; sweep++ ) {
+        auto off = 0.0, diagonal = 0.0;
+        for ( auto p = 0; p < size; p++ ) {
+            diagonal += a[p*size + p]*a[p*size + p];
+            for ( auto q = p + 1; q < size; q++ ) {
+                off += a[p*size + q]*a[p*size + q];
+            }
+        }
+        if ( off <= 1.0e-30*std::max(diagonal, 1.0e-300) ) {
+            break;
+        }
+
+        for ( auto p = 0; p < size; p++ ) {
+            for ( auto q = p + 1; q < size; q++ ) {
+                if ( a[p*size + q] == 0.0 ) {
+                    continue;
+                }
+                const auto theta    = (a[q*size + q] - a[p*size + p])/(2.0*a[p*size + q]);
+                const auto t        = (theta >= 0.0 ? 1.0 : -1.0)/(std::fabs(theta) + sqrt(theta*theta + 1.0));
+                const auto c        = 1.0/sqrt(t*t + 1.0);
+                const auto s        = t*c;
+                for ( auto k = 0; k < size; k++ ) {
+                    const auto akp = a[k*size + p], akq = a[k*size + q];
+                    a[k*size + p] = c*akp - s*akq;
+                    a[k*size + q] = s*akp + c*akq;
+                }
+                for ( auto k = 0; k < size; k++ ) {
+                    const auto apk = a[p*size + k], aqk = a[q*size + k];
+                    a[p*size + k] = c*apk - s*aqk;
+                    a[q*size + k] = s*apk + c*aqk;
+                }
+                for ( auto k = 0; k < size; k++ ) {
+                    const auto vkp = vectors[k*size + p], vkq = vectors[k*size + q];
+                    vectors[k*size + p] = c*vkp - s*vkq;
+                    vectors[k*size + q] = s*vkp + c*vkq;
+                }
+            }
+        }
+    }
+}
+
+
+// Z = C Q for the covariance C of src, streamed over the samples so that C
+// is never formed; q and the result are dimension x width row-major
+template <typename T>
+auto multiplyCovariance(const std::vector<Node<T>>& src, const std::vector<double>& mean,
+                        const std::vector<double>& q, int width) -> std::vector<double>
+{
+    const auto length       = static_cast<int>(src.size());
+    const auto dimension    = static_cast<int>(mean.size());
+    std::vector<double> z(dimension*width, 0.0);
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        std::vector<double> local(dimension*width, 0.0), centered(dimension), y(width);
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for ( auto s = 0; s < length; s++ ) {
+            const auto x = src[s].data();
+            std::fill(y.begin(), y.end(), 0.0);
+            for ( auto i = 0; i < dimension; i++ ) {
+                centered[i] = x[i] - mean[i];
+                for ( auto j = 0; j < width; j++ ) {
+                    y[j] += centered[i]*q[i*width + j];
+                }
+            }
+            for ( auto i = 0; i < dimension; i++ ) {
+                for ( auto j = 0; j < width; j++ ) {
+                    local[i*width + j] += centered[i]*y[j];
+                }
+            }
+        }
+        #ifdef _OPENMP
+        #pragma omp critical (multiplyCovariance)
+        #endif
+        {
+            for ( auto k = 0; k < dimension*width; k++ ) {
+                z[k] += local[k];
+            }
+        }
+    }
+
+    for ( auto& value : z ) {
+        value /= length;
+    }
+
+    return z;
+}
+
+
+// Top count principal components of src by randomized subspace iteration:
+// a random subspace slightly wider than count is multiplied by the
+// covariance iterations times, and the result is diagonalized in that
+// subspace. Every iteration is one parallel pass over the input.
+template <typename T>
+auto principalComponents(const std::vector<Node<T>>& src, int count, int iterations=4) throw (std::string) -> PrincipalComponents
+{
+    if ( src.empty() ) {
+        throw std::string("source is empty.");
+    }
+    const auto length       = static_cast<int>(src.size());
+    const auto dimension    = src[0].size();
+    if ( count < 1 || count > dimension ) {
+        throw std::string("number of components must be between 1 and dimension.");
+    }
+    for ( const auto& node : src ) {
+        if ( node.size() != dimension ) {
+            throw std::string("dimension of source node is different.");
+        }
+    }
+
+    PrincipalComponents result;
+    result.mean = std::vector<double>(dimension, 0.0);
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+        std::vector<double> local(dimension, 0.0);
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for ( auto s = 0; s < length; s++ ) {
+            const auto x = src[s].data();
+            for ( auto i = 0; i < dimension; i++ ) {
+                local[i] += x[i];
+            }
+        }
+        #ifdef _OPENMP
+        #pragma omp critical (principalComponents)
+        #endif
+        {
+            for ( auto i = 0; i < dimension; i++ ) {
+                result.mean[i] += local[i];
+            }
+        }
+    }
+    for ( auto& value : result.mean ) {
+        value /= length;
+    }
+
+    const auto width = std::min(dimension, count + PCA_OVERSAMPLING);
+    std::mt19937 mt(PCA_SEED);
+    std::normal_distribution<> normal(0.0, 1.0);
+    std::vector<double> q(dimension*width);
+    for ( auto& value : q ) {
+        value = normal(mt);
+    }
+    orthonormalizeColumns(q, dimension, width);
+    for ( auto it = 0; it < iterations; it++ ) {
+        q = multiplyCovariance(src, result.mean, q, width);
+        orthonormalizeColumns(q, dimension, width);
+    }
+
+    // Rayleigh-Ritz: B = Q^T C Q is small, and its eigenvectors rotate Q
+    const auto z = multiplyCovariance(src, result.mean, q, width);
+    std::vector<double> b(width*width, 0.0), vectors;
+    for ( auto j = 0; j < width; j++ ) {
+        for ( auto k = 0; k < width; k++ ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                b[j*width + k] += q[i*width + j]*z[i*width + k];
+            }
+        }
+    }
+    for ( auto j = 0; j < width; j++ ) {
+        for ( auto k = j + 1; k < width; k++ ) {
+            b[j*width + k] = b[k*width + j] = 0.5*(b[j*width + k] + b[k*width + j]);
+        }
+    }
+    symmetricEigen(b, width, vectors);
+
+    std::vector<int> order(width);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&b, width](int j, int k) {
+        return b[j*width + j] > b[k*width + k];
+    });
+    for ( auto c = 0; c < count; c++ ) {
+        const auto j = order[c];
+        std::vector<double> component(dimension, 0.0);
+        for ( auto i = 0; i < dimension; i++ ) {
+            for ( auto k = 0; k < width; k++ ) {
+                component[i] += q[i*width + k]*vectors[k*width + j];
+            }
+        }
+        result.components.push_back(component);
+        result.variances.push_back(std::max(0.0, b[j*width + j]));
+    }
+
+    return result;
+}
+
+
+// Linear initialization of a rows x cols map: model vectors are spread
+// evenly over the plane of the two top principal components, one standard
+// deviation to either side of the mean, with the longer side of the map
+// along the first component.
+template <typename T>
+auto linearMap(const std::vector<Node<T>>& src, int rows, int cols) throw (std::string) -> std::vector<std::vector<Node<T>>>
+{
+    if ( rows < 1 || cols < 1 ) {
+        throw std::string("map must not be empty.");
+    }
+
+    const auto dimension    = src.empty() ? 0 : src[0].size();
+    const auto pca          = principalComponents(src, std::min(2, dimension));
+    const auto components   = static_cast<int>(pca.components.size());
+    std::vector<std::vector<Node<T>>> map(rows, std::vector<Node<T>>(cols, Node<T>(dimension)));
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            const auto u = rows > 1 ? 2.0*r/(rows - 1) - 1.0 : 0.0;
+            const auto v = cols > 1 ? 2.0*c/(cols - 1) - 1.0 : 0.0;
+            const double coords[] = {rows >= cols ? u : v, rows >= cols ? v : u};
+            const auto w = map[r][c].data();
+            for ( auto i = 0; i < dimension; i++ ) {
+                auto value = pca.mean[i];
+                for ( auto k = 0; k < components; k++ ) {
+                    value += coords[k]*sqrt(pca.variances[k])*pca.components[k][i];
+                }
+                w[i] = static_cast<T>(value);
+            }
+        }
+    }
+
+    return map;
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef KG_PROFILE_H
+#define KG_PROFILE_H
+
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace kg {
+
+
+// Cumulative cost of the training steps run while profiling was enabled.
+// Phases are in nanoseconds: sampling is nextIndex(), search the BMU search,
+// update the neighborhood update, and bookkeeping the convergence signals,
+// pyramid refresh and publishing. Hardware counters are only filled when
+// hardwareCounters is true, i.e. when the kernel allowed perf_event_open.
+struct Profile {
+    long long steps;
+    long long samplingTime;
+    long long searchTime;
+    long long updateTime;
+    long long bookkeepingTime;
+    long long neuronsVisited;
+    long long neuronsUpdated;
+    long long distanceEvaluations;
+    bool hardwareCounters;
+    long long cycles;
+    long long instructions;
+    long long cacheMisses;
+    long long branchMisses;
+};
+
+
+enum class ProfileFormat {
+    Text,
+    Json,
+};
+
+
+// cycles, instructions, cache misses and branch misses of the calling thread
+// and of the threads it starts after open(), counted only between start()
+// and stop()
+class HardwareCounters {
+private:
+    std::vector<int> fds_;
+
+public:
+    HardwareCounters();
+    HardwareCounters(const HardwareCounters&) = delete;
+    auto operator=(const HardwareCounters&) -> HardwareCounters& = delete;
+    ~HardwareCounters();
+
+    auto open() -> bool;
+    auto start() -> void;
+    auto stop() -> void;
+    auto read(Profile& profile) const -> void;
+};
+
+
+// wall clock of one phase, which costs nothing while disabled
+class PhaseTimer {
+private:
+    const bool enabled_;
+    std::chrono::steady_clock::time_point begin_;
+
+public:
+    PhaseTimer(bool enabled);
+    auto lap(long long& elapsed) -> void;
+};
+
+
+inline HardwareCounters::HardwareCounters()
+{
+}
+
+
+inline HardwareCounters::~HardwareCounters()
+{
+    #ifdef __linux__
+    for ( const auto fd : fds_ ) {
+        close(fd);
+    }
+    #endif
+}
+
+
+inline auto HardwareCounters::open() -> bool
+{
+    #ifdef __linux__
+    const uint64_t configs[] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    for ( const auto config : configs ) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.config         = config;
+        attr.disabled       = 1;
+        attr.inherit        = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+
+        const auto fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        if ( fd < 0 ) {
+            for ( const auto opened : fds_ ) {
+                close(opened);
+            }
+            fds_.clear();
+            return false;
+        }
+        fds_.push_back(fd);
+    }
+
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+
+inline auto HardwareCounters::start() -> void
+{
+    #ifdef __linux__
+    for ( const auto fd : fds_ ) {
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    #endif
+}
+
+
+inline auto HardwareCounters::stop() -> void
+{
+    #ifdef __linux__
+    for ( const auto fd : fds_ ) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+    #endif
+}
+
+
+inline auto HardwareCounters::read(Profile& profile) const -> void
+{
+    profile.hardwareCounters = !fds_.empty();
+    #ifdef __linux__
+    long long* values[] = {&profile.cycles, &profile.instructions, &profile.cacheMisses, &profile.branchMisses};
+    for ( auto k = 0U; k < fds_.size(); k++ ) {
+        uint64_t value = 0;
+        if ( ::read(fds_[k], &value, sizeof(value)) == sizeof(value) ) {
+            *values[k] = static_cast<long long>(value);
+        }
+    }
+    #endif
+}
+
+
+inline PhaseTimer::PhaseTimer(bool enabled)
+    :enabled_(enabled)
+{
+    if ( enabled_ ) {
+        begin_ = std::chrono::steady_clock::now();
+    }
+}
+
+
+inline auto PhaseTimer::lap(long long& elapsed) -> void
+{
+    // adds the time since the previous lap to elapsed and starts the next phase
+    if ( !enabled_ ) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    elapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(now - begin_).count();
+    begin_ = now;
+}
+
+
+inline auto formatProfile(const Profile& profile, ProfileFormat format) -> std::string
+{
+    const std::vector<std::pair<const char*, long long>> fields = {
+        {"steps",               profile.steps},
+        {"samplingTime",        profile.samplingTime},
+        {"searchTime",          profile.searchTime},
+        {"updateTime",          profile.updateTime},
+        {"bookkeepingTime",     profile.bookkeepingTime},
+        {"neuronsVisited",      profile.neuronsVisited},
+        {"neuronsUpdated",      profile.neuronsUpdated},
+        {"distanceEvaluations", profile.distanceEvaluations},
+        {"cycles",              profile.cycles},
+        {"instructions",        profile.instructions},
+        {"cacheMisses",         profile.cacheMisses},
+        {"branchMisses",        profile.branchMisses},
+    };
+    const auto count = profile.hardwareCounters ? fields.size() : fields.size() - 4;
+
+    std::ostringstream out;
+    if ( format == ProfileFormat::Json ) {
+        out << "{\n";
+        for ( auto k = 0U; k < count; k++ ) {
+            out << "  \"" << fields[k].first << "\": " << fields[k].second << ",\n";
+        }
+        out << "  \"hardwareCounters\": " << (profile.hardwareCounters ? "true" : "false") << "\n}\n";
+    } else {
+        for ( auto k = 0U; k < count; k++ ) {
+            out << fields[k].first << " " << fields[k].second << "\n";
+        }
+    }
+
+    return out.str();
+}
+
+
+inline auto writeProfile(const std::string& path, const Profile& profile,
+                            ProfileFormat format=ProfileFormat::Json) throw (std::string) -> void
+{
+    std::ofstream file(path);
+    file << formatProfile(profile, format);
+    if ( !file ) {
+        throw std::string("cannot write profile file.");
+    }
+}
+
+
+}
+
+
+#endif
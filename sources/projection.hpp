@@ -0,0 +1,224 @@
+#ifndef KG_PROJECTION_H
+#define KG_PROJECTION_H
+
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include "node.hpp"
+
+
+namespace kg {
+
+
+namespace {
+    constexpr auto PROJECTION_SEED = 1U;
+    constexpr auto PROJECTION_REFRESH_INTERVAL = 1024;
+};
+
+
+enum class ProjectionMethod {
+    Random,
+    PCA,
+};
+
+
+// reduced x dimension Gaussian matrix scaled by 1/sqrt(reduced), which
+// preserves Euclidean distances in expectation
+inline auto randomProjection(int reduced, int dimension) -> std::vector<std::vector<double>>
+{
+    std::mt19937 mt(PROJECTION_SEED);
+    std::normal_distribution<> normal(0.0, 1.0/sqrt(reduced));
+    std::vector<std::vector<double>> rows(reduced, std::vector<double>(dimension));
+    for ( auto& row : rows ) {
+        for ( auto& value : row ) {
+            value = normal(mt);
+        }
+    }
+
+    return rows;
+}
+
+
+// Model vectors projected to a few dimensions for a two-stage BMU search:
+// the candidates nearest in the reduced space are ranked again exactly.
+// Projection is linear, so update() follows a learning step of a model
+// vector without projecting it again; build() removes the rounding drift.
+template <typename T>
+class ProjectedCodebook {
+private:
+    using Map = std::vector<std::vector<Node<T>>>;
+
+    int candidates_;
+    int reduced_;
+    int dimension_;
+    int cols_;
+    std::vector<double> matrix_;
+    std::vector<double> codebook_;
+
+public:
+    ProjectedCodebook(int candidates=16) throw (std::string);
+
+    auto setMatrix(const std::vector<std::vector<double>>& rows) throw (std::string) -> void;
+    auto build(const Map& map, int threads) -> void;
+    auto project(const T* x, double* y) const -> void;
+    auto update(int n, double rate, const double* y) -> void;
+    template <typename Rank>
+    auto search(const T* x, Rank rank, int threads) const -> std::tuple<int, int>;
+    auto dimension() const -> int;
+    auto candidates() const -> int;
+};
+
+
+template <typename T>
+ProjectedCodebook<T>::ProjectedCodebook(int candidates) throw (std::string)
+    :candidates_(candidates)
+    ,reduced_(0)
+    ,dimension_(0)
+    ,cols_(0)
+{
+    if ( candidates_ < 1 ) {
+        throw std::string("number of candidates must be positive.");
+    }
+}
+
+
+template <typename T>
+auto ProjectedCodebook<T>::setMatrix(const std::vector<std::vector<double>>& rows) throw (std::string) -> void
+{
+    if ( rows.empty() || rows[0].empty() ) {
+        throw std::string("projection is empty.");
+    }
+
+    reduced_    = rows.size();
+    dimension_  = rows[0].size();
+    matrix_.clear();
+    for ( const auto& row : rows ) {
+        if ( static_cast<int>(row.size()) != dimension_ ) {
+            throw std::string("rows of projection have different lengths.");
+        }
+        matrix_.insert(matrix_.end(), row.begin(), row.end());
+    }
+}
+
+
+template <typename T>
+auto ProjectedCodebook<T>::build(const Map& map, int threads) -> void
+{
+    const auto rows = static_cast<int>(map.size());
+    cols_           = map[0].size();
+    codebook_       = std::vector<double>(rows*cols_*reduced_);
+    #ifdef _OPENMP
+    #pragma omp parallel for num_threads(threads) schedule(static)
+    #endif
+    for ( auto n = 0; n < rows*cols_; n++ ) {
+        project(map[n/cols_][n%cols_].data(), &codebook_[n*reduced_]);
+    }
+}
+
+
+template <typename T>
+auto ProjectedCodebook<T>::project(const T* x, double* y) const -> void
+{
+    for ( auto k = 0; k < reduced_; k++ ) {
+        const auto row = &matrix_[k*dimension_];
+        auto sum = 0.0;
+        for ( auto i = 0; i < dimension_; i++ ) {
+            sum += row[i]*x[i];
+        }
+        y[k] = sum;
+    }
+}
+
+
+template <typename T>
+auto ProjectedCodebook<T>::update(int n, double rate, const double* y) -> void
+{
+    const auto p = &codebook_[n*reduced_];
+    for ( auto k = 0; k < reduced_; k++ ) {
+        p[k] += rate*(y[k] - p[k]);
+    }
+}
+
+
+template <typename T>
+template <typename Rank>
+auto ProjectedCodebook<T>::search(const T* x, Rank rank, int threads) const -> std::tuple<int, int>
+{
+    const auto neurons = static_cast<int>(codebook_.size())/reduced_;
+    std::vector<double> y(reduced_);
+    project(x, y.data());
+
+    // every thread keeps a max-heap of its nearest candidates in the reduced space
+    std::vector<std::pair<double, int>> nearest;
+    #ifdef _OPENMP
+    #pragma omp parallel num_threads(threads)
+    #endif
+    {
+        std::vector<std::pair<double, int>> heap;
+        #ifdef _OPENMP
+        #pragma omp for schedule(static)
+        #endif
+        for ( auto n = 0; n < neurons; n++ ) {
+            const auto p = &codebook_[n*reduced_];
+            auto dis = 0.0;
+            for ( auto k = 0; k < reduced_; k++ ) {
+                dis += (y[k] - p[k])*(y[k] - p[k]);
+            }
+            if ( static_cast<int>(heap.size()) < candidates_ ) {
+                heap.emplace_back(dis, n);
+                std::push_heap(heap.begin(), heap.end());
+            } else if ( std::make_pair(dis, n) < heap.front() ) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = std::make_pair(dis, n);
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+        #ifdef _OPENMP
+        #pragma omp critical (projectedSearch)
+        #endif
+        {
+            nearest.insert(nearest.end(), heap.begin(), heap.end());
+        }
+    }
+
+    const auto count = std::min(candidates_, static_cast<int>(nearest.size()));
+    std::partial_sort(nearest.begin(), nearest.begin() + count, nearest.end());
+    auto minDis = std::numeric_limits<double>::max();
+    auto minIdx = 0;
+    for ( auto k = 0; k < count; k++ ) {
+        const auto n    = nearest[k].second;
+        const auto dis  = rank(n/cols_, n%cols_);
+        if ( dis < minDis || (dis == minDis && n < minIdx) ) {
+            minDis = dis;
+            minIdx = n;
+        }
+    }
+
+    return std::make_tuple(minIdx/cols_, minIdx%cols_);
+}
+
+
+template <typename T>
+auto ProjectedCodebook<T>::dimension() const -> int
+{
+    return reduced_;
+}
+
+
+template <typename T>
+auto ProjectedCodebook<T>::candidates() const -> int
+{
+    return candidates_;
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef KG_PUBLISHED_MAP_H
+#define KG_PUBLISHED_MAP_H
+
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <limits>
+#include "node.hpp"
+#include "metric.hpp"
+
+
+namespace kg {
+
+
+// Versions of a map published by one training thread and read by any number
+// of query threads without locks. The model vectors live in a small ring of
+// preallocated buffers: a reader pins the current buffer with a reference
+// count, and the writer only refills buffers that are neither current nor
+// pinned, so queries never see a half-written map and never allocate.
+template <typename T, typename Metric=EuclideanMetric>
+class PublishedMap {
+private:
+    struct Buffer {
+        std::vector<T> codebook;
+        long long version;
+        std::atomic<int> readers;
+    };
+
+    const int rows_;
+    const int cols_;
+    const int dimension_;
+    const Metric metric_;
+    std::vector<std::unique_ptr<Buffer>> buffers_;
+    std::atomic<int> current_;
+
+private:
+    inline auto acquire() const -> int;
+    inline auto release(int idx) const -> void;
+
+public:
+    PublishedMap(int rows, int cols, int dimension, int buffers=3,
+                    const Metric& metric=Metric()) throw (std::string);
+    ~PublishedMap();
+
+    template <typename Fill>
+    auto publish(long long version, Fill fill) -> void;
+    template <typename Func>
+    auto read(Func func) const -> bool;
+    auto bmu(const Node<T>& node, long long* version=nullptr) const throw (std::string) -> std::tuple<int, int>;
+    auto version() const -> long long;
+    auto rows() const -> int;
+    auto cols() const -> int;
+    auto dimension() const -> int;
+};
+
+
+template <typename T, typename Metric>
+PublishedMap<T, Metric>::PublishedMap(int rows, int cols, int dimension, int buffers,
+                                        const Metric& metric) throw (std::string)
+    :rows_(rows)
+    ,cols_(cols)
+    ,dimension_(dimension)
+    ,metric_(metric)
+    ,current_(-1)
+{
+    if ( buffers < 2 ) {
+        throw std::string("at least 2 buffers are required.");
+    }
+
+    for ( auto b = 0; b < buffers; b++ ) {
+        buffers_.emplace_back(new Buffer());
+        buffers_.back()->codebook   = std::vector<T>(static_cast<size_t>(rows_)*cols_*dimension_);
+        buffers_.back()->version    = -1;
+        buffers_.back()->readers    = 0;
+    }
+}
+
+
+template <typename T, typename Metric>
+PublishedMap<T, Metric>::~PublishedMap()
+{
+}
+
+
+template <typename T, typename Metric>
+auto PublishedMap<T, Metric>::acquire() const -> int
+{
+    while ( true ) {
+        const auto idx = current_.load();
+        if ( idx < 0 ) {
+            return idx;
+        }
+
+        // the pin only counts if the buffer was still current after taking it
+        buffers_[idx]->readers.fetch_add(1);
+        if ( current_.load() == idx ) {
+            return idx;
+        }
+        buffers_[idx]->readers.fetch_sub(1);
+    }
+}
+
+
+template <typename T, typename Metric>
+auto PublishedMap<T, Metric>::release(int idx) const -> void
+{
+    buffers_[idx]->readers.fetch_sub(1);
+}
+
+
+template <typename T, typename Metric>
+template <typename Fill>
+auto PublishedMap<T, Metric>::publish(long long version, Fill fill) -> void
+{
+    // fill(T* codebook) writes rows*cols*dimension elements in row-major order
+    const auto current = current_.load();
+    auto idx = -1;
+    while ( idx < 0 ) {
+        for ( auto b = 0; b < static_cast<int>(buffers_.size()); b++ ) {
+            if ( b != current && buffers_[b]->readers.load() == 0 ) {
+                idx = b;
+                break;
+            }
+        }
+        if ( idx < 0 ) {
+            std::this_thread::yield();
+        }
+    }
+
+    fill(buffers_[idx]->codebook.data());
+    buffers_[idx]->version = version;
+    current_.store(idx);
+}
+
+
+template <typename T, typename Metric>
+template <typename Func>
+auto PublishedMap<T, Metric>::read(Func func) const -> bool
+{
+    // func(const T* codebook, long long version) sees one consistent version
+    const auto idx = acquire();
+    if ( idx < 0 ) {
+        return false;
+    }
+
+    try {
+        func(static_cast<const T*>(buffers_[idx]->codebook.data()), buffers_[idx]->version);
+    } catch ( ... ) {
+        release(idx);
+        throw;
+    }
+    release(idx);
+
+    return true;
+}
+
+
+template <typename T, typename Metric>
+auto PublishedMap<T, Metric>::bmu(const Node<T>& node, long long* version) const throw (std::string) -> std::tuple<int, int>
+{
+    if ( node.size() != dimension_ ) {
+        throw std::string("dimension of node is different.");
+    }
+
+    const auto x = node.data();
+    auto minDis = std::numeric_limits<double>::max();
+    auto minIdx = 0;
+    const auto published = read([&](const T* codebook, long long publishedVersion) {
+        for ( auto n = 0; n < rows_*cols_; n++ ) {
+            const auto dis = metric_.distance(x, codebook + static_cast<size_t>(n)*dimension_, dimension_);
+            if ( dis < minDis ) {
+                minDis = dis;
+                minIdx = n;
+            }
+        }
+        if ( version != nullptr ) {
+            *version = publishedVersion;
+        }
+    });
+    if ( !published ) {
+        throw std::string("no map has been published.");
+    }
+
+    return std::make_tuple(minIdx/cols_, minIdx%cols_);
+}
+
+
+template <typename T, typename Metric>
+auto PublishedMap<T, Metric>::version() const -> long long
+{
+    auto version = -1LL;
+    read([&version](const T*, long long publishedVersion) {
+        version = publishedVersion;
+    });
+
+    return version;
+}
+
+
+template <typename T, typename Metric>
+auto PublishedMap<T, Metric>::rows() const -> int
+{
+    return rows_;
+}
+
+
+template <typename T, typename Metric>
+auto PublishedMap<T, Metric>::cols() const -> int
+{
+    return cols_;
+}
+
+
+template <typename T, typename Metric>
+auto PublishedMap<T, Metric>::dimension() const -> int
+{
+    return dimension_;
+}
+
+
+}
+
+
+#endif
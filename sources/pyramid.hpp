@@ -0,0 +1,284 @@
+#ifndef KG_PYRAMID_H
+#define KG_PYRAMID_H
+
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include "node.hpp"
+
+
+namespace kg {
+
+
+// Pyramid of pooled model vectors for a coarse-to-fine BMU search.
+// Level 0 averages blockSize x blockSize neurons of the map, and every
+// further level averages blockSize x blockSize cells of the level below,
+// until the top level is no larger than one block.
+template <typename T>
+class MapPyramid {
+private:
+    using Map = std::vector<std::vector<Node<T>>>;
+
+    int blockSize_;
+    int candidates_;
+    int dimension_;
+    int mapRows_;
+    int mapCols_;
+    std::vector<int> rows_;
+    std::vector<int> cols_;
+    std::vector<std::vector<T>> levels_;
+    std::vector<std::vector<int>> counts_;
+    std::vector<std::vector<char>> dirty_;
+
+private:
+    inline auto poolBlock(const Map& map, int r, int c) -> void;
+    inline auto poolCell(int level, int r, int c) -> void;
+    inline auto childRange(int level, int r, int c) const -> std::tuple<int, int, int, int>;
+
+public:
+    MapPyramid(int blockSize=4, int candidates=4) throw (std::string);
+
+    auto build(const Map& map, int threads) -> void;
+    template <typename Touched>
+    auto refresh(const Map& map, Touched touched, int threads) -> void;
+    template <typename Distance, typename Rank>
+    auto search(const T* x, Distance distance, Rank rank) const -> std::tuple<int, int>;
+    auto levels() const -> int;
+    auto blockSize() const -> int;
+    auto cell(int level, int r, int c) const -> const T*;
+};
+
+
+template <typename T>
+MapPyramid<T>::MapPyramid(int blockSize, int candidates) throw (std::string)
+    :blockSize_(blockSize)
+    ,candidates_(candidates)
+    ,dimension_(0)
+    ,mapRows_(0)
+    ,mapCols_(0)
+{
+    if ( blockSize_ < 2 ) {
+        throw std::string("block size must be at least 2.");
+    }
+    if ( candidates_ < 1 ) {
+        throw std::string("number of candidates must be positive.");
+    }
+}
+
+
+template <typename T>
+auto MapPyramid<T>::childRange(int level, int r, int c) const -> std::tuple<int, int, int, int>
+{
+    const auto rows = level == 0 ? mapRows_ : rows_[level - 1];
+    const auto cols = level == 0 ? mapCols_ : cols_[level - 1];
+
+    return std::make_tuple(r*blockSize_, std::min((r + 1)*blockSize_, rows),
+                            c*blockSize_, std::min((c + 1)*blockSize_, cols));
+}
+
+
+template <typename T>
+auto MapPyramid<T>::poolBlock(const Map& map, int r, int c) -> void
+{
+    int r0, r1, c0, c1;
+    std::tie(r0, r1, c0, c1) = childRange(0, r, c);
+
+    std::vector<double> sum(dimension_, 0.0);
+    for ( auto mr = r0; mr < r1; mr++ ) {
+        for ( auto mc = c0; mc < c1; mc++ ) {
+            const auto w = map[mr][mc].data();
+            for ( auto i = 0; i < dimension_; i++ ) {
+                sum[i] += w[i];
+            }
+        }
+    }
+
+    const auto count = (r1 - r0)*(c1 - c0);
+    const auto pooled = &levels_[0][(r*cols_[0] + c)*dimension_];
+    for ( auto i = 0; i < dimension_; i++ ) {
+        pooled[i] = static_cast<T>(sum[i]/count);
+    }
+    counts_[0][r*cols_[0] + c] = count;
+}
+
+
+template <typename T>
+auto MapPyramid<T>::poolCell(int level, int r, int c) -> void
+{
+    int r0, r1, c0, c1;
+    std::tie(r0, r1, c0, c1) = childRange(level, r, c);
+
+    // children are weighted by the number of neurons they cover
+    std::vector<double> sum(dimension_, 0.0);
+    auto count = 0;
+    for ( auto cr = r0; cr < r1; cr++ ) {
+        for ( auto cc = c0; cc < c1; cc++ ) {
+            const auto child        = cr*cols_[level - 1] + cc;
+            const auto weight       = counts_[level - 1][child];
+            const auto w            = &levels_[level - 1][child*dimension_];
+            for ( auto i = 0; i < dimension_; i++ ) {
+                sum[i] += static_cast<double>(weight)*w[i];
+            }
+            count += weight;
+        }
+    }
+
+    const auto pooled = &levels_[level][(r*cols_[level] + c)*dimension_];
+    for ( auto i = 0; i < dimension_; i++ ) {
+        pooled[i] = static_cast<T>(sum[i]/count);
+    }
+    counts_[level][r*cols_[level] + c] = count;
+}
+
+
+template <typename T>
+auto MapPyramid<T>::build(const Map& map, int threads) -> void
+{
+    mapRows_    = map.size();
+    mapCols_    = map[0].size();
+    dimension_  = map[0][0].size();
+    rows_.clear();
+    cols_.clear();
+
+    auto rows = mapRows_, cols = mapCols_;
+    do {
+        rows = (rows + blockSize_ - 1)/blockSize_;
+        cols = (cols + blockSize_ - 1)/blockSize_;
+        rows_.push_back(rows);
+        cols_.push_back(cols);
+    } while ( rows > blockSize_ || cols > blockSize_ );
+
+    levels_ = std::vector<std::vector<T>>(rows_.size());
+    counts_ = std::vector<std::vector<int>>(rows_.size());
+    dirty_  = std::vector<std::vector<char>>(rows_.size());
+    for ( auto l = 0U; l < rows_.size(); l++ ) {
+        levels_[l]  = std::vector<T>(rows_[l]*cols_[l]*dimension_);
+        counts_[l]  = std::vector<int>(rows_[l]*cols_[l], 0);
+        dirty_[l]   = std::vector<char>(rows_[l]*cols_[l], 1);
+    }
+
+    refresh(map, [](int, int, int, int) { return true; }, threads);
+}
+
+
+template <typename T>
+template <typename Touched>
+auto MapPyramid<T>::refresh(const Map& map, Touched touched, int threads) -> void
+{
+    // touched(r0, r1, c0, c1) tells whether any neuron of the block moved
+    #ifdef _OPENMP
+    #pragma omp parallel for num_threads(threads) schedule(static)
+    #endif
+    for ( auto n = 0; n < rows_[0]*cols_[0]; n++ ) {
+        const auto r = n/cols_[0], c = n%cols_[0];
+        int r0, r1, c0, c1;
+        std::tie(r0, r1, c0, c1) = childRange(0, r, c);
+        dirty_[0][n] = touched(r0, r1, c0, c1) ? 1 : 0;
+        if ( dirty_[0][n] ) {
+            poolBlock(map, r, c);
+        }
+    }
+
+    for ( auto l = 1; l < static_cast<int>(rows_.size()); l++ ) {
+        #ifdef _OPENMP
+        #pragma omp parallel for num_threads(threads) schedule(static)
+        #endif
+        for ( auto n = 0; n < rows_[l]*cols_[l]; n++ ) {
+            const auto r = n/cols_[l], c = n%cols_[l];
+            int r0, r1, c0, c1;
+            std::tie(r0, r1, c0, c1) = childRange(l, r, c);
+
+            auto dirty = false;
+            for ( auto cr = r0; cr < r1 && !dirty; cr++ ) {
+                for ( auto cc = c0; cc < c1 && !dirty; cc++ ) {
+                    dirty = dirty_[l - 1][cr*cols_[l - 1] + cc] != 0;
+                }
+            }
+            dirty_[l][n] = dirty ? 1 : 0;
+            if ( dirty ) {
+                poolCell(l, r, c);
+            }
+        }
+    }
+}
+
+
+template <typename T>
+template <typename Distance, typename Rank>
+auto MapPyramid<T>::search(const T* x, Distance distance, Rank rank) const -> std::tuple<int, int>
+{
+    // keep the best candidates_ cells of each level and descend into their children
+    const auto top = static_cast<int>(rows_.size()) - 1;
+    std::vector<std::pair<int, int>> cells;
+    for ( auto r = 0; r < rows_[top]; r++ ) {
+        for ( auto c = 0; c < cols_[top]; c++ ) {
+            cells.emplace_back(r, c);
+        }
+    }
+
+    std::vector<std::pair<double, int>> scored;
+    for ( auto l = top; l >= 0; l-- ) {
+        scored.clear();
+        for ( const auto& cell : cells ) {
+            const auto n = cell.first*cols_[l] + cell.second;
+            scored.emplace_back(distance(x, &levels_[l][n*dimension_]), n);
+        }
+        const auto kept = std::min(static_cast<int>(scored.size()), candidates_);
+        std::partial_sort(scored.begin(), scored.begin() + kept, scored.end());
+
+        cells.clear();
+        for ( auto k = 0; k < kept; k++ ) {
+            int r0, r1, c0, c1;
+            std::tie(r0, r1, c0, c1) = childRange(l, scored[k].second/cols_[l], scored[k].second%cols_[l]);
+            for ( auto cr = r0; cr < r1; cr++ ) {
+                for ( auto cc = c0; cc < c1; cc++ ) {
+                    cells.emplace_back(cr, cc);
+                }
+            }
+        }
+    }
+
+    auto minDis = std::numeric_limits<double>::max();
+    auto minIdx = std::numeric_limits<int>::max();
+    for ( const auto& cell : cells ) {
+        const auto n    = cell.first*mapCols_ + cell.second;
+        const auto dis  = rank(cell.first, cell.second);
+        if ( dis < minDis || (dis == minDis && n < minIdx) ) {
+            minDis = dis;
+            minIdx = n;
+        }
+    }
+
+    return std::make_tuple(minIdx/mapCols_, minIdx%mapCols_);
+}
+
+
+template <typename T>
+auto MapPyramid<T>::levels() const -> int
+{
+    return rows_.size();
+}
+
+
+template <typename T>
+auto MapPyramid<T>::blockSize() const -> int
+{
+    return blockSize_;
+}
+
+
+template <typename T>
+auto MapPyramid<T>::cell(int level, int r, int c) const -> const T*
+{
+    return &levels_[level][(r*cols_[level] + c)*dimension_];
+}
+
+
+}
+
+
+#endif
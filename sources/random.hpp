@@ -0,0 +1,141 @@
+#ifndef KG_RANDOM_H
+#define KG_RANDOM_H
+
+
+#include <array>
+#include <random>
+#include <iterator>
+#include <utility>
+#include <cstdint>
+
+
+namespace kg {
+
+
+namespace {
+    constexpr uint32_t PHILOX_M0 = 0xD2511F53;
+    constexpr uint32_t PHILOX_M1 = 0xCD9E8D57;
+    constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+    constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+    constexpr auto PHILOX_ROUNDS = 10;
+};
+
+
+using PhiloxBlock = std::array<uint32_t, 4>;
+
+
+// Philox4x32-10 of Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3":
+// a bijection of the counter under the key, so that every block of random
+// bits is a pure function of (key, counter) and can be drawn in any order
+inline auto philox(PhiloxBlock counter, uint64_t key) -> PhiloxBlock
+{
+    auto k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+    for ( auto round = 0; round < PHILOX_ROUNDS; round++ ) {
+        const auto p0 = static_cast<uint64_t>(PHILOX_M0)*counter[0];
+        const auto p1 = static_cast<uint64_t>(PHILOX_M1)*counter[2];
+        counter = {{static_cast<uint32_t>(p1 >> 32) ^ counter[1] ^ k0, static_cast<uint32_t>(p1),
+                    static_cast<uint32_t>(p0 >> 32) ^ counter[3] ^ k1, static_cast<uint32_t>(p0)}};
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    return counter;
+}
+
+
+// Uniform random bit generator over the stream-th sequence of the seed: word
+// k of a stream is word k%4 of the Philox block with counter (k/4, stream).
+class CounterEngine {
+private:
+    uint64_t seed_;
+    uint64_t stream_;
+    uint64_t block_;
+    PhiloxBlock buffer_;
+    int used_;
+
+public:
+    using result_type = uint32_t;
+
+    CounterEngine(uint64_t seed=0, uint64_t stream=0);
+
+    static constexpr auto min() -> result_type;
+    static constexpr auto max() -> result_type;
+    auto operator()() -> result_type;
+    auto below(uint32_t bound) -> uint32_t;
+};
+
+
+// seed for models that were not given one
+inline auto randomSeed() -> uint64_t
+{
+    std::random_device rnd;
+    return static_cast<uint64_t>(rnd()) << 32 | rnd();
+}
+
+
+// Fisher-Yates shuffle, which unlike std::shuffle draws the same permutation
+// on every standard library
+template <typename Iterator>
+inline auto permute(Iterator first, Iterator last, CounterEngine& engine) -> void
+{
+    const auto length = std::distance(first, last);
+    for ( auto k = length - 1; k > 0; k-- ) {
+        std::iter_swap(first + k, first + engine.below(static_cast<uint32_t>(k + 1)));
+    }
+}
+
+
+inline CounterEngine::CounterEngine(uint64_t seed, uint64_t stream)
+    :seed_(seed)
+    ,stream_(stream)
+    ,block_(0)
+    ,buffer_()
+    ,used_(4)
+{
+}
+
+
+inline constexpr auto CounterEngine::min() -> result_type
+{
+    return 0;
+}
+
+
+inline constexpr auto CounterEngine::max() -> result_type
+{
+    return 0xFFFFFFFF;
+}
+
+
+inline auto CounterEngine::operator()() -> result_type
+{
+    if ( used_ == 4 ) {
+        buffer_ = philox({{static_cast<uint32_t>(block_), static_cast<uint32_t>(block_ >> 32),
+                            static_cast<uint32_t>(stream_), static_cast<uint32_t>(stream_ >> 32)}}, seed_);
+        ++block_;
+        used_ = 0;
+    }
+
+    return buffer_[used_++];
+}
+
+
+inline auto CounterEngine::below(uint32_t bound) -> uint32_t
+{
+    // unbiased integer in [0, bound), by Lemire's multiply-and-reject
+    auto product = static_cast<uint64_t>((*this)())*bound;
+    if ( static_cast<uint32_t>(product) < bound ) {
+        const auto threshold = (0U - bound)%bound;
+        while ( static_cast<uint32_t>(product) < threshold ) {
+            product = static_cast<uint64_t>((*this)())*bound;
+        }
+    }
+
+    return static_cast<uint32_t>(product >> 32);
+}
+
+
+}
+
+
+#endif
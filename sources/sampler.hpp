@@ -0,0 +1,225 @@
+#ifndef KG_SAMPLER_H
+#define KG_SAMPLER_H
+
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <istream>
+#include <ostream>
+#include <cstdint>
+#include <unistd.h>
+#include "random.hpp"
+
+
+namespace kg {
+
+
+namespace {
+    constexpr auto CACHE_LINE = 64;
+    constexpr auto DEFAULT_CACHE_SIZE = 256*1024;
+};
+
+
+// Draws every sample once per epoch, in an order shuffled at the start of
+// the epoch. With a block size, the epoch visits blocks of consecutive
+// samples in shuffled order and shuffles the samples within each block, so
+// that the samples of a block stay in cache while the block is visited.
+// Without shuffling, samples are drawn in order.
+// The order of an epoch is drawn from the counter-based stream (seed, epoch),
+// so the sample of step t only depends on the seed, t and the block size.
+class EpochSampler {
+private:
+    int length_;
+    bool shuffled_;
+    int blockSize_;
+    std::vector<int> order_;
+    int position_;
+    uint64_t seed_;
+    long long epoch_;
+
+private:
+    inline auto shuffle() -> void;
+
+public:
+    EpochSampler(int length=1, bool shuffled=true, uint64_t seed=0);
+
+    auto next() -> int;
+    auto peek() const -> int;
+    auto seek(long long step) -> void;
+    auto setSeed(uint64_t seed) -> void;
+    auto seed() const -> uint64_t;
+    auto setBlockSize(int blockSize) -> void;
+    auto blockSize() const -> int;
+    auto write(std::ostream& out) const -> void;
+    auto read(std::istream& in) -> bool;
+};
+
+
+// samples that fit in half of the L2 cache
+inline auto cacheBlockSize(size_t sampleBytes) -> int
+{
+    #ifdef _SC_LEVEL2_CACHE_SIZE
+    const auto cache = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    #else
+    const auto cache = 0L;
+    #endif
+    const auto bytes = cache > 0 ? static_cast<size_t>(cache) : static_cast<size_t>(DEFAULT_CACHE_SIZE);
+
+    return std::max(1, static_cast<int>(bytes/2/std::max<size_t>(sampleBytes, 1)));
+}
+
+
+// hints the cache to load bytes at data before they are read
+inline auto prefetch(const void* data, size_t bytes) -> void
+{
+    #if defined(__GNUC__) || defined(__clang__)
+    const auto p = static_cast<const char*>(data);
+    for ( auto offset = 0UL; offset < bytes; offset += CACHE_LINE ) {
+        __builtin_prefetch(p + offset, 0, 1);
+    }
+    #else
+    (void)data;
+    (void)bytes;
+    #endif
+}
+
+
+inline EpochSampler::EpochSampler(int length, bool shuffled, uint64_t seed)
+    :length_(length)
+    ,shuffled_(shuffled)
+    ,blockSize_(0)
+    ,position_(length)
+    ,seed_(seed)
+    ,epoch_(-1)
+{
+}
+
+
+inline auto EpochSampler::shuffle() -> void
+{
+    CounterEngine engine(seed_, epoch_);
+    order_ = std::vector<int>(length_);
+    std::iota(order_.begin(), order_.end(), 0);
+    if ( blockSize_ <= 0 || blockSize_ >= length_ ) {
+        permute(order_.begin(), order_.end(), engine);
+        return;
+    }
+
+    const auto blocks = (length_ + blockSize_ - 1)/blockSize_;
+    std::vector<int> blockOrder(blocks);
+    std::iota(blockOrder.begin(), blockOrder.end(), 0);
+    permute(blockOrder.begin(), blockOrder.end(), engine);
+    auto k = 0;
+    for ( const auto block : blockOrder ) {
+        const auto first = k;
+        for ( auto idx = block*blockSize_; idx < std::min((block + 1)*blockSize_, length_); idx++ ) {
+            order_[k++] = idx;
+        }
+        permute(order_.begin() + first, order_.begin() + k, engine);
+    }
+}
+
+
+inline auto EpochSampler::next() -> int
+{
+    if ( position_ >= length_ ) {
+        position_ = 0;
+        ++epoch_;
+        if ( shuffled_ ) {
+            shuffle();
+        }
+    }
+
+    const auto idx = shuffled_ ? order_[position_] : position_;
+    ++position_;
+
+    return idx;
+}
+
+
+inline auto EpochSampler::peek() const -> int
+{
+    // the next sample, or -1 when the next epoch is not shuffled yet
+    if ( position_ >= length_ ) {
+        return shuffled_ ? -1 : 0;
+    }
+
+    return shuffled_ ? order_[position_] : position_;
+}
+
+
+inline auto EpochSampler::seek(long long step) -> void
+{
+    // the next sample is the one of step
+    epoch_      = step/length_;
+    position_   = step%length_;
+    if ( shuffled_ ) {
+        shuffle();
+    }
+}
+
+
+inline auto EpochSampler::setSeed(uint64_t seed) -> void
+{
+    // the rest of the current epoch is drawn again with the new seed
+    seed_ = seed;
+    if ( shuffled_ && position_ < length_ ) {
+        shuffle();
+    }
+}
+
+
+inline auto EpochSampler::seed() const -> uint64_t
+{
+    return seed_;
+}
+
+
+inline auto EpochSampler::setBlockSize(int blockSize) -> void
+{
+    // takes effect from the next epoch
+    blockSize_ = std::max(0, blockSize);
+}
+
+
+inline auto EpochSampler::blockSize() const -> int
+{
+    return blockSize_;
+}
+
+
+inline auto EpochSampler::write(std::ostream& out) const -> void
+{
+    out << seed_ << ' ' << epoch_ << ' ' << position_ << ' ' << blockSize_;
+}
+
+
+inline auto EpochSampler::read(std::istream& in) -> bool
+{
+    // false, and nothing changed, when the state cannot be parsed or does not fit the length
+    auto seed = static_cast<uint64_t>(0);
+    auto epoch = 0LL;
+    auto position = 0, blockSize = 0;
+    if ( !(in >> seed >> epoch >> position >> blockSize)
+            || epoch < -1 || position < 0 || position > length_ || blockSize < 0 ) {
+        return false;
+    }
+
+    seed_       = seed;
+    epoch_      = epoch;
+    position_   = position;
+    blockSize_  = blockSize;
+    if ( shuffled_ && position_ < length_ ) {
+        shuffle();
+    }
+
+    return true;
+}
+
+
+}
+
+
+#endif
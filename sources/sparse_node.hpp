@@ -0,0 +1,210 @@
+#ifndef KG_SPARSE_NODE_H
+#define KG_SPARSE_NODE_H
+
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "node.hpp"
+
+
+namespace kg {
+
+
+// Sparse input vector stored as one CSR row: strictly increasing indices
+// and the matching non-zero values. size() is the full (dense) dimension.
+template <typename T>
+class SparseNode {
+private:
+    std::vector<int> indices_;
+    std::vector<T> values_;
+    size_t size_;
+    double squaredNorm_;
+
+private:
+    auto updateSquaredNorm() -> void;
+
+public:
+    SparseNode(size_t size=1);
+    SparseNode(size_t size, const std::vector<int>& indices,
+                const std::vector<T>& values) throw (std::string);
+    explicit SparseNode(const Node<T>& node);
+    auto setElem(T elem, size_t idx) -> void;
+    auto elem(size_t idx) const -> T;
+    auto index(int k) const -> int;
+    auto value(int k) const -> T;
+    auto indices() const -> const int*;
+    auto values() const -> const T*;
+    auto nnz() const -> int;
+    auto size() const -> int;
+    auto squaredNorm() const -> double;
+    auto toNode() const -> Node<T>;
+};
+
+
+template <typename T>
+auto SparseNode<T>::updateSquaredNorm() -> void
+{
+    squaredNorm_ = 0.0;
+    for ( const auto& val : values_ ) {
+        squaredNorm_ += static_cast<double>(val)*static_cast<double>(val);
+    }
+}
+
+
+template <typename T>
+SparseNode<T>::SparseNode(size_t size)
+    :size_(size)
+    ,squaredNorm_(0.0)
+{
+}
+
+
+template <typename T>
+SparseNode<T>::SparseNode(size_t size, const std::vector<int>& indices,
+                            const std::vector<T>& values) throw (std::string)
+    :indices_(indices)
+    ,values_(values)
+    ,size_(size)
+    ,squaredNorm_(0.0)
+{
+    if ( indices_.size() != values_.size() ) {
+        throw std::string("different size");
+    }
+    for ( auto k = 0U; k < indices_.size(); k++ ) {
+        if ( indices_[k] < 0 || static_cast<size_t>(indices_[k]) >= size_ ) {
+            throw std::string("out of range.");
+        }
+        if ( k > 0 && indices_[k] <= indices_[k - 1] ) {
+            throw std::string("indices must be strictly increasing.");
+        }
+    }
+
+    updateSquaredNorm();
+}
+
+
+template <typename T>
+SparseNode<T>::SparseNode(const Node<T>& node)
+    :size_(node.size())
+    ,squaredNorm_(0.0)
+{
+    const auto elems = node.data();
+    for ( auto i = 0; i < node.size(); i++ ) {
+        if ( elems[i] != static_cast<T>(0) ) {
+            indices_.push_back(i);
+            values_.push_back(elems[i]);
+        }
+    }
+
+    updateSquaredNorm();
+}
+
+
+template <typename T>
+auto SparseNode<T>::setElem(T elem, size_t idx) -> void
+{
+    if ( idx >= size_ ) {
+        throw std::string("out of range.");
+    }
+
+    const auto it = std::lower_bound(indices_.begin(), indices_.end(), static_cast<int>(idx));
+    const auto k  = it - indices_.begin();
+    if ( it != indices_.end() && *it == static_cast<int>(idx) ) {
+        if ( elem == static_cast<T>(0) ) {
+            indices_.erase(it);
+            values_.erase(values_.begin() + k);
+        } else {
+            values_[k] = elem;
+        }
+    } else if ( elem != static_cast<T>(0) ) {
+        indices_.insert(it, static_cast<int>(idx));
+        values_.insert(values_.begin() + k, elem);
+    }
+
+    updateSquaredNorm();
+}
+
+
+template <typename T>
+auto SparseNode<T>::elem(size_t idx) const -> T
+{
+    if ( idx >= size_ ) {
+        throw std::string("out of range.");
+    }
+
+    const auto it = std::lower_bound(indices_.begin(), indices_.end(), static_cast<int>(idx));
+    if ( it == indices_.end() || *it != static_cast<int>(idx) ) {
+        return static_cast<T>(0);
+    }
+
+    return values_[it - indices_.begin()];
+}
+
+
+template <typename T>
+auto SparseNode<T>::index(int k) const -> int
+{
+    return indices_[k];
+}
+
+
+template <typename T>
+auto SparseNode<T>::value(int k) const -> T
+{
+    return values_[k];
+}
+
+
+template <typename T>
+auto SparseNode<T>::indices() const -> const int*
+{
+    return indices_.data();
+}
+
+
+template <typename T>
+auto SparseNode<T>::values() const -> const T*
+{
+    return values_.data();
+}
+
+
+template <typename T>
+auto SparseNode<T>::nnz() const -> int
+{
+    return indices_.size();
+}
+
+
+template <typename T>
+auto SparseNode<T>::size() const -> int
+{
+    return size_;
+}
+
+
+template <typename T>
+auto SparseNode<T>::squaredNorm() const -> double
+{
+    return squaredNorm_;
+}
+
+
+template <typename T>
+auto SparseNode<T>::toNode() const -> Node<T>
+{
+    Node<T> node(size_);
+    const auto elems = node.data();
+    for ( auto k = 0U; k < indices_.size(); k++ ) {
+        elems[indices_[k]] = values_[k];
+    }
+
+    return node;
+}
+
+
+}
+
+
+#endif
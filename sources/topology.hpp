@@ -0,0 +1,283 @@
+#ifndef KG_TOPOLOGY_H
+#define KG_TOPOLOGY_H
+
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <cmath>
+#include <limits>
+
+
+namespace kg {
+
+
+// Map topologies are passed to KSOM as a template parameter.
+// prepare() precomputes squared lattice distances once, and row() returns
+// the squared distances from the neuron (bmuRow, bmuCol) to every neuron of
+// row r, so the neighborhood update is a plain table scan.
+// neighbors(n) lists the neurons at lattice distance 1 from n = r*cols + c.
+
+
+namespace {
+    constexpr auto NEIGHBOR_SQ_DISTANCE = 1.0 + 1.0e-9;
+};
+
+
+class RectangularTopology {
+protected:
+    int rows_;
+    int cols_;
+    std::vector<double> table_;
+    std::vector<std::vector<int>> neighbors_;
+
+protected:
+    template <typename Func>
+    auto prepareOffsets(int rows, int cols, Func sqDistance) -> void;
+
+public:
+    RectangularTopology();
+    auto prepare(int rows, int cols) throw (std::string) -> void;
+    auto row(int bmuRow, int bmuCol, int r) const -> const double*;
+    auto neighbors(int n) const -> const std::vector<int>&;
+};
+
+
+// rectangular lattice whose opposite edges are joined
+class ToroidalTopology : public RectangularTopology {
+public:
+    auto prepare(int rows, int cols) throw (std::string) -> void;
+};
+
+
+// odd rows are shifted by half a neuron, so every neuron has six neighbors
+class HexagonalTopology {
+private:
+    int rows_;
+    int cols_;
+    std::vector<double> table_;
+    std::vector<std::vector<int>> neighbors_;
+
+public:
+    HexagonalTopology();
+    auto prepare(int rows, int cols) throw (std::string) -> void;
+    auto row(int bmuRow, int bmuCol, int r) const -> const double*;
+    auto neighbors(int n) const -> const std::vector<int>&;
+};
+
+
+// arbitrary neighborhood graph over the neurons n = r*cols + c, with the
+// hop count as lattice distance; unreachable neurons are never updated
+class GraphTopology {
+private:
+    int rows_;
+    int cols_;
+    std::vector<std::pair<int, int>> edges_;
+    std::vector<double> table_;
+    std::vector<std::vector<int>> neighbors_;
+
+public:
+    GraphTopology(const std::vector<std::pair<int, int>>& edges=std::vector<std::pair<int, int>>());
+    auto prepare(int rows, int cols) throw (std::string) -> void;
+    auto row(int bmuRow, int bmuCol, int r) const -> const double*;
+    auto neighbors(int n) const -> const std::vector<int>&;
+};
+
+
+inline RectangularTopology::RectangularTopology()
+    :rows_(0)
+    ,cols_(0)
+{
+}
+
+
+template <typename Func>
+auto RectangularTopology::prepareOffsets(int rows, int cols, Func sqDistance) -> void
+{
+    // table_[(dr + rows - 1)*(2*cols - 1) + (dc + cols - 1)] for every offset
+    rows_   = rows;
+    cols_   = cols;
+    table_  = std::vector<double>((2*rows - 1)*(2*cols - 1));
+    for ( auto dr = 1 - rows; dr < rows; dr++ ) {
+        for ( auto dc = 1 - cols; dc < cols; dc++ ) {
+            table_[(dr + rows - 1)*(2*cols - 1) + (dc + cols - 1)] = sqDistance(dr, dc);
+        }
+    }
+
+    // neighbors lie within one row and column, possibly across a joined edge
+    neighbors_ = std::vector<std::vector<int>>(rows*cols);
+    for ( auto n = 0; n < rows*cols; n++ ) {
+        const auto r0 = n/cols, c0 = n%cols;
+        for ( auto dr = -1; dr <= 1; dr++ ) {
+            const auto r = (r0 + dr + rows)%rows;
+            const auto sqDistances = row(r0, c0, r);
+            for ( auto dc = -1; dc <= 1; dc++ ) {
+                const auto c = (c0 + dc + cols)%cols;
+                const auto m = r*cols + c;
+                if ( m != n && sqDistances[c] <= NEIGHBOR_SQ_DISTANCE
+                        && std::find(neighbors_[n].begin(), neighbors_[n].end(), m) == neighbors_[n].end() ) {
+                    neighbors_[n].push_back(m);
+                }
+            }
+        }
+    }
+}
+
+
+inline auto RectangularTopology::prepare(int rows, int cols) throw (std::string) -> void
+{
+    prepareOffsets(rows, cols, [](int dr, int dc) {
+        return static_cast<double>(dr*dr + dc*dc);
+    });
+}
+
+
+inline auto RectangularTopology::row(int bmuRow, int bmuCol, int r) const -> const double*
+{
+    return &table_[(r - bmuRow + rows_ - 1)*(2*cols_ - 1) + (cols_ - 1 - bmuCol)];
+}
+
+
+inline auto RectangularTopology::neighbors(int n) const -> const std::vector<int>&
+{
+    return neighbors_[n];
+}
+
+
+inline auto ToroidalTopology::prepare(int rows, int cols) throw (std::string) -> void
+{
+    prepareOffsets(rows, cols, [rows, cols](int dr, int dc) {
+        const auto wr = std::min(std::abs(dr), rows - std::abs(dr));
+        const auto wc = std::min(std::abs(dc), cols - std::abs(dc));
+        return static_cast<double>(wr*wr + wc*wc);
+    });
+}
+
+
+inline HexagonalTopology::HexagonalTopology()
+    :rows_(0)
+    ,cols_(0)
+{
+}
+
+
+inline auto HexagonalTopology::prepare(int rows, int cols) throw (std::string) -> void
+{
+    // one offset table per parity of the BMU row
+    const auto height   = (2*rows - 1)*(2*cols - 1);
+    rows_               = rows;
+    cols_               = cols;
+    table_              = std::vector<double>(2*height);
+    for ( auto parity = 0; parity < 2; parity++ ) {
+        for ( auto dr = 1 - rows; dr < rows; dr++ ) {
+            const auto shift    = 0.5*(((parity + dr)&1) - parity);
+            const auto dy       = 0.5*sqrt(3.0)*dr;
+            for ( auto dc = 1 - cols; dc < cols; dc++ ) {
+                const auto dx = dc + shift;
+                table_[parity*height + (dr + rows - 1)*(2*cols - 1) + (dc + cols - 1)] = dx*dx + dy*dy;
+            }
+        }
+    }
+
+    neighbors_ = std::vector<std::vector<int>>(rows*cols);
+    for ( auto n = 0; n < rows*cols; n++ ) {
+        for ( auto r = std::max(0, n/cols - 1); r <= std::min(rows - 1, n/cols + 1); r++ ) {
+            const auto sqDistances = row(n/cols, n%cols, r);
+            for ( auto c = std::max(0, n%cols - 1); c <= std::min(cols - 1, n%cols + 1); c++ ) {
+                if ( r*cols + c != n && sqDistances[c] <= NEIGHBOR_SQ_DISTANCE ) {
+                    neighbors_[n].push_back(r*cols + c);
+                }
+            }
+        }
+    }
+}
+
+
+inline auto HexagonalTopology::row(int bmuRow, int bmuCol, int r) const -> const double*
+{
+    const auto height = (2*rows_ - 1)*(2*cols_ - 1);
+    return &table_[(bmuRow&1)*height + (r - bmuRow + rows_ - 1)*(2*cols_ - 1) + (cols_ - 1 - bmuCol)];
+}
+
+
+inline auto HexagonalTopology::neighbors(int n) const -> const std::vector<int>&
+{
+    return neighbors_[n];
+}
+
+
+inline GraphTopology::GraphTopology(const std::vector<std::pair<int, int>>& edges)
+    :rows_(0)
+    ,cols_(0)
+    ,edges_(edges)
+{
+}
+
+
+inline auto GraphTopology::prepare(int rows, int cols) throw (std::string) -> void
+{
+    const auto size = rows*cols;
+    std::vector<std::vector<int>> adjacency(size);
+    for ( const auto& edge : edges_ ) {
+        if ( edge.first < 0 || edge.first >= size || edge.second < 0 || edge.second >= size ) {
+            throw std::string("edge of topology is out of range.");
+        }
+        if ( edge.first != edge.second ) {
+            adjacency[edge.first].push_back(edge.second);
+            adjacency[edge.second].push_back(edge.first);
+        }
+    }
+
+    for ( auto& neighbors : adjacency ) {
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    }
+
+    rows_   = rows;
+    cols_   = cols;
+    table_  = std::vector<double>(static_cast<size_t>(size)*size, std::numeric_limits<double>::infinity());
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for ( auto src = 0; src < size; src++ ) {
+        const auto distances = &table_[static_cast<size_t>(src)*size];
+        std::queue<int> queue;
+        distances[src] = 0.0;
+        queue.push(src);
+        while ( !queue.empty() ) {
+            const auto n = queue.front();
+            queue.pop();
+            for ( const auto next : adjacency[n] ) {
+                if ( distances[next] == std::numeric_limits<double>::infinity() ) {
+                    distances[next] = distances[n] + 1.0;
+                    queue.push(next);
+                }
+            }
+        }
+        for ( auto n = 0; n < size; n++ ) {
+            distances[n] *= distances[n];
+        }
+    }
+    neighbors_ = adjacency;
+}
+
+
+inline auto GraphTopology::row(int bmuRow, int bmuCol, int r) const -> const double*
+{
+    return &table_[static_cast<size_t>(bmuRow*cols_ + bmuCol)*rows_*cols_ + r*cols_];
+}
+
+
+inline auto GraphTopology::neighbors(int n) const -> const std::vector<int>&
+{
+    return neighbors_[n];
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,276 @@
+#ifndef KG_TRANSPORT_H
+#define KG_TRANSPORT_H
+
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <chrono>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+
+
+namespace kg {
+
+
+namespace {
+    constexpr auto CONNECT_RETRY_INTERVAL = 10;
+};
+
+
+// Transports sum buffers over the workers of a BatchKSOM. A transport has
+// rank() and size(), and allreduce(data, count) replaces data on every
+// worker with the element-wise sum over all workers, adding the workers in
+// rank order so that every worker ends up with bitwise identical sums.
+
+
+// first source node and end of the shard of rank out of size workers
+inline auto shardOf(int length, int rank, int size) -> std::pair<int, int>
+{
+    return std::make_pair(static_cast<long long>(length)*rank/size, static_cast<long long>(length)*(rank + 1)/size);
+}
+
+
+// a single worker
+class LocalTransport {
+public:
+    auto rank() const -> int;
+    auto size() const -> int;
+    auto allreduce(double* data, size_t count) -> void;
+};
+
+
+// Workers on one machine connected through a Unix-domain socket at path.
+// Rank 0 listens and sums; the others connect, retrying until timeout, and
+// send their buffers to rank 0, which sends the sums back. Rank 0 also gives
+// up when the workers have not all introduced themselves by the timeout.
+class SocketTransport {
+private:
+    const std::string path_;
+    const int rank_;
+    const int size_;
+    std::vector<int> fds_;
+
+private:
+    inline auto sendAll(int fd, const void* data, size_t bytes) const throw (std::string) -> void;
+    inline auto receiveAll(int fd, void* data, size_t bytes) const throw (std::string) -> void;
+
+public:
+    SocketTransport(const std::string& path, int rank, int size,
+                    std::chrono::milliseconds timeout=std::chrono::milliseconds(10000)) throw (std::string);
+    SocketTransport(const SocketTransport&) = delete;
+    auto operator=(const SocketTransport&) -> SocketTransport& = delete;
+    ~SocketTransport();
+
+    auto rank() const -> int;
+    auto size() const -> int;
+    auto allreduce(double* data, size_t count) throw (std::string) -> void;
+};
+
+
+inline auto LocalTransport::rank() const -> int
+{
+    return 0;
+}
+
+
+inline auto LocalTransport::size() const -> int
+{
+    return 1;
+}
+
+
+inline auto LocalTransport::allreduce(double*, size_t) -> void
+{
+}
+
+
+inline SocketTransport::SocketTransport(const std::string& path, int rank, int size,
+                                        std::chrono::milliseconds timeout) throw (std::string)
+    :path_(path)
+    ,rank_(rank)
+    ,size_(size)
+    ,fds_(size, -1)
+{
+    if ( size_ < 1 || rank_ < 0 || rank_ >= size_ ) {
+        throw std::string("rank must be between 0 and size - 1.");
+    }
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if ( path_.size() >= sizeof(address.sun_path) ) {
+        throw std::string("socket path is too long.");
+    }
+    std::strcpy(address.sun_path, path_.c_str());
+
+    if ( rank_ == 0 ) {
+        const auto listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path_.c_str());
+        if ( listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+                || listen(listener, size_) != 0 ) {
+            if ( listener >= 0 ) {
+                close(listener);
+            }
+            throw std::string("cannot listen on socket.");
+        }
+
+        // workers introduce themselves by rank, in any order
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        const auto remaining = [&deadline]() {
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            return static_cast<int>(std::max<long long>(0, std::min<long long>(left, std::numeric_limits<int>::max())));
+        };
+        const auto fail = [this, listener](int fd) {
+            if ( fd >= 0 ) {
+                close(fd);
+            }
+            for ( auto& worker : fds_ ) {
+                if ( worker >= 0 ) {
+                    close(worker);
+                    worker = -1;
+                }
+            }
+            close(listener);
+            unlink(path_.c_str());
+            throw std::string("cannot accept worker.");
+        };
+        for ( auto k = 1; k < size_; k++ ) {
+            pollfd pending = {listener, POLLIN, 0};
+            auto ready = 0;
+            do {
+                ready = poll(&pending, 1, remaining());
+            } while ( ready < 0 && errno == EINTR );
+            if ( ready <= 0 ) {
+                fail(-1);
+            }
+
+            // the timeout only covers the introduction, not the training that follows
+            const auto fd = accept(listener, nullptr, nullptr);
+            const auto left = remaining();
+            timeval wait = {static_cast<time_t>(left/1000), static_cast<suseconds_t>(left%1000*1000)};
+            const timeval forever = {0, 0};
+            auto worker = 0;
+            if ( fd < 0 || left == 0 || setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait)) != 0
+                    || recv(fd, &worker, sizeof(worker), MSG_WAITALL) != sizeof(worker)
+                    || setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &forever, sizeof(forever)) != 0
+                    || worker < 1 || worker >= size_ || fds_[worker] >= 0 ) {
+                fail(fd);
+            }
+            fds_[worker] = fd;
+        }
+        close(listener);
+        return;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while ( true ) {
+        const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ( fd < 0 ) {
+            throw std::string("cannot create socket.");
+        }
+        if ( connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 ) {
+            fds_[0] = fd;
+            break;
+        }
+        close(fd);
+        if ( std::chrono::steady_clock::now() >= deadline ) {
+            throw std::string("cannot connect to rank 0.");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(CONNECT_RETRY_INTERVAL));
+    }
+    sendAll(fds_[0], &rank_, sizeof(rank_));
+}
+
+
+inline SocketTransport::~SocketTransport()
+{
+    for ( const auto fd : fds_ ) {
+        if ( fd >= 0 ) {
+            close(fd);
+        }
+    }
+    if ( rank_ == 0 ) {
+        unlink(path_.c_str());
+    }
+}
+
+
+inline auto SocketTransport::sendAll(int fd, const void* data, size_t bytes) const throw (std::string) -> void
+{
+    auto p = static_cast<const char*>(data);
+    while ( bytes > 0 ) {
+        const auto sent = send(fd, p, bytes, MSG_NOSIGNAL);
+        if ( sent < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( sent <= 0 ) {
+            throw std::string("cannot send to worker.");
+        }
+        p       += sent;
+        bytes   -= sent;
+    }
+}
+
+
+inline auto SocketTransport::receiveAll(int fd, void* data, size_t bytes) const throw (std::string) -> void
+{
+    auto p = static_cast<char*>(data);
+    while ( bytes > 0 ) {
+        const auto received = recv(fd, p, bytes, 0);
+        if ( received < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( received <= 0 ) {
+            throw std::string("cannot receive from worker.");
+        }
+        p       += received;
+        bytes   -= received;
+    }
+}
+
+
+inline auto SocketTransport::rank() const -> int
+{
+    return rank_;
+}
+
+
+inline auto SocketTransport::size() const -> int
+{
+    return size_;
+}
+
+
+inline auto SocketTransport::allreduce(double* data, size_t count) throw (std::string) -> void
+{
+    if ( rank_ != 0 ) {
+        sendAll(fds_[0], data, sizeof(double)*count);
+        receiveAll(fds_[0], data, sizeof(double)*count);
+        return;
+    }
+
+    std::vector<double> buffer(count);
+    for ( auto worker = 1; worker < size_; worker++ ) {
+        receiveAll(fds_[worker], buffer.data(), sizeof(double)*count);
+        for ( auto k = 0U; k < count; k++ ) {
+            data[k] += buffer[k];
+        }
+    }
+    for ( auto worker = 1; worker < size_; worker++ ) {
+        sendAll(fds_[worker], data, sizeof(double)*count);
+    }
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include "../sources/autotune.hpp"
+
+
+class AutotuneTest : public ::testing::Test {
+protected:
+    AutotuneTest()
+    {
+    }
+
+    ~AutotuneTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(AutotuneTest, ThreadCandidates)
+{
+    ASSERT_FALSE(kg::cpuModel().empty());
+
+    const auto threads = kg::threadCandidates();
+    ASSERT_EQ(1, threads.front());
+    ASSERT_EQ(kg::maxThreads(), threads.back());
+    for ( auto k = 1U; k < threads.size(); k++ ) {
+        ASSERT_LT(threads[k - 1], threads[k]);
+    }
+}
+
+
+TEST_F(AutotuneTest, SavingAndLoadingProfile)
+{
+    const std::string path = "autotune_test_profile.txt";
+    kg::TuningProfile profile;
+    profile.store("cpu\tf\t8x8x3", {kg::SearchEngine::Exhaustive, 0, 4, true});
+    profile.store("cpu\tf\t64x64x512", {kg::SearchEngine::Projected, 32, 8, false});
+    profile.store("cpu\tf\t8x8x3", {kg::SearchEngine::Exhaustive, 0, 2, true});
+    ASSERT_EQ(2, profile.size());
+    profile.save(path);
+
+    // lines that cannot be parsed are skipped
+    std::ofstream(path, std::ios::app) << "broken line\n" << "cpu\t7\t0\t1\t0\n";
+    kg::TuningProfile loaded;
+    ASSERT_TRUE(loaded.load(path));
+    ASSERT_EQ(2, loaded.size());
+
+    kg::TuningChoice choice;
+    ASSERT_TRUE(loaded.find("cpu\tf\t8x8x3", choice));
+    ASSERT_EQ(kg::SearchEngine::Exhaustive, choice.engine);
+    ASSERT_EQ(2, choice.threads);
+    ASSERT_TRUE(choice.pipelined);
+    ASSERT_TRUE(loaded.find("cpu\tf\t64x64x512", choice));
+    ASSERT_EQ(kg::SearchEngine::Projected, choice.engine);
+    ASSERT_EQ(32, choice.engineSize);
+    ASSERT_EQ(8, choice.threads);
+    ASSERT_FALSE(choice.pipelined);
+    ASSERT_FALSE(loaded.find("cpu\tf\t8x8x4", choice));
+    std::remove(path.c_str());
+
+    ASSERT_FALSE(loaded.load(path));
+    ASSERT_THROW(profile.save("autotune_test_missing/profile.txt"), std::string);
+}
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "../sources/node.hpp"
+#include "../sources/ksom.hpp"
+#include "../sources/transport.hpp"
+#include "../sources/batch_ksom.hpp"
+
+
+class BatchKSOMTest : public ::testing::Test {
+protected:
+    BatchKSOMTest()
+    {
+    }
+
+    ~BatchKSOMTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(BatchKSOMTest, Epoch)
+{
+    // with a tiny sigma the neighbors do not interact, and an epoch moves
+    // every neuron to the weighted mean of the samples it won
+    std::vector<kg::Node<double>> source(6, kg::Node<double>(1));
+    const double values[] = {1.0, 2.0, 3.0, 11.0, 12.0, 13.0};
+    for ( auto n = 0; n < 6; n++ ) {
+        source[n][0] = values[n];
+    }
+    std::vector<std::vector<kg::Node<double>>> map(1, std::vector<kg::Node<double>>(3, kg::Node<double>(1)));
+    map[0][0][0] = 0.0;
+    map[0][1][0] = 10.0;
+    map[0][2][0] = 100.0;
+
+    kg::LocalTransport transport;
+    kg::BatchKSOM<double, kg::LocalTransport> som(source, map, 2, 0.1, transport);
+    som.setWeights({1.0, 1.0, 1.0, 1.0, 1.0, 4.0});
+    ASSERT_TRUE(som.computeOnes());
+    ASSERT_EQ(1, som.time());
+    auto trained = som.model().map();
+    ASSERT_DOUBLE_EQ(2.0, trained[0][0][0]);
+    ASSERT_DOUBLE_EQ(12.5, trained[0][1][0]);
+    ASSERT_DOUBLE_EQ(100.0, trained[0][2][0]);
+
+    som.compute();
+    ASSERT_EQ(2, som.time());
+    ASSERT_FALSE(som.computeOnes());
+    ASSERT_EQ(kg::StopReason::MaxIterate, som.model().stopReason());
+
+    ASSERT_THROW((kg::BatchKSOM<double, kg::LocalTransport>(std::vector<kg::Node<double>>(), map, 2, 0.1, transport)), std::string);
+}
+
+
+TEST_F(BatchKSOMTest, Processes)
+{
+    constexpr auto dimension = 3, length = 300, workers = 3, rows = 5, cols = 4, maxEpoch = 5;
+    std::mt19937 mt(1);
+    std::uniform_real_distribution<> rand(0.0, 1.0);
+    std::vector<kg::Node<double>> source(length, kg::Node<double>(dimension));
+    for ( auto& node : source ) {
+        for ( auto i = 0; i < dimension; i++ ) {
+            node[i] = rand(mt);
+        }
+    }
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+    for ( auto& row : map ) {
+        for ( auto& node : row ) {
+            node = source[static_cast<int>(rand(mt)*length)];
+        }
+    }
+    const auto shard = [&source](int rank) {
+        const auto range = kg::shardOf(length, rank, workers);
+        return std::vector<kg::Node<double>>(source.begin() + range.first, source.begin() + range.second);
+    };
+    // the other workers run this test again in fresh processes, as OpenMP
+    // is not safe to use in a process forked after it started its threads
+    if ( const auto worker = getenv("KSOM_BATCH_WORKER") ) {
+        const auto rank = std::stoi(worker);
+        try {
+            kg::SocketTransport transport(getenv("KSOM_BATCH_PATH"), rank, workers);
+            kg::BatchKSOM<double> som(shard(rank), map, maxEpoch, 2.0, transport);
+            som.compute();
+            _exit(som.time() == maxEpoch ? 0 : 1);
+        } catch ( ... ) {
+            _exit(2);
+        }
+    }
+
+    const auto path = "/tmp/ksom_batch_test_" + std::to_string(getpid());
+    std::vector<pid_t> children;
+    for ( auto rank = 1; rank < workers; rank++ ) {
+        std::vector<std::string> strings = {"KSOM_BATCH_WORKER=" + std::to_string(rank), "KSOM_BATCH_PATH=" + path};
+        for ( auto env = environ; *env != nullptr; env++ ) {
+            strings.push_back(*env);
+        }
+        std::vector<char*> envp;
+        for ( auto& string : strings ) {
+            envp.push_back(&string[0]);
+        }
+        envp.push_back(nullptr);
+        char program[] = "/proc/self/exe", filter[] = "--gtest_filter=BatchKSOMTest.Processes";
+        char* argv[] = {program, filter, nullptr};
+
+        const auto pid = fork();
+        ASSERT_GE(pid, 0);
+        if ( pid == 0 ) {
+            dup2(open("/dev/null", O_WRONLY), STDOUT_FILENO);
+            execve(program, argv, envp.data());
+            _exit(3);
+        }
+        children.push_back(pid);
+    }
+
+    kg::SocketTransport transport(path, 0, workers);
+    kg::BatchKSOM<double> distributed(shard(0), map, maxEpoch, 2.0, transport);
+    distributed.compute();
+    for ( const auto pid : children ) {
+        auto status = 0;
+        ASSERT_EQ(pid, waitpid(pid, &status, 0));
+        ASSERT_TRUE(WIFEXITED(status));
+        ASSERT_EQ(0, WEXITSTATUS(status));
+    }
+
+    kg::LocalTransport local;
+    kg::BatchKSOM<double, kg::LocalTransport> single(source, map, maxEpoch, 2.0, local);
+    single.compute();
+    const auto expected = single.model().map(), actual = distributed.model().map();
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                ASSERT_NEAR(expected[r][c][i], actual[r][c][i], 1.0e-9);
+            }
+        }
+    }
+    ASSERT_NEAR(single.model().quantizationError(), distributed.model().quantizationError(), 1.0e-9);
+
+    ASSERT_THROW(kg::SocketTransport(path, 3, workers), std::string);
+}
+
+
+TEST_F(BatchKSOMTest, Threads)
+{
+    // every sum is formed in a fixed order, so the epochs do not depend on the threads
+    constexpr auto dimension = 3, length = 200, rows = 6, cols = 5, maxEpoch = 4;
+    std::mt19937 mt(1);
+    std::uniform_real_distribution<> rand(0.0, 1.0);
+    std::vector<kg::Node<double>> source(length, kg::Node<double>(dimension));
+    for ( auto& node : source ) {
+        for ( auto i = 0; i < dimension; i++ ) {
+            node[i] = rand(mt);
+        }
+    }
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+    for ( auto& row : map ) {
+        for ( auto& node : row ) {
+            node = source[static_cast<int>(rand(mt)*length)];
+        }
+    }
+
+    kg::LocalTransport transport;
+    kg::BatchKSOM<double, kg::LocalTransport> single(source, map, maxEpoch, 2.0, transport);
+    single.model().setThreads(1);
+    single.compute();
+    for ( const auto threads : {2, 3} ) {
+        kg::BatchKSOM<double, kg::LocalTransport> parallel(source, map, maxEpoch, 2.0, transport);
+        parallel.model().setThreads(threads);
+        parallel.compute();
+        const auto expected = single.model().map(), actual = parallel.model().map();
+        for ( auto r = 0; r < rows; r++ ) {
+            for ( auto c = 0; c < cols; c++ ) {
+                for ( auto i = 0; i < dimension; i++ ) {
+                    ASSERT_EQ(expected[r][c][i], actual[r][c][i]);
+                }
+            }
+        }
+        ASSERT_EQ(single.model().quantizationError(), parallel.model().quantizationError());
+        ASSERT_EQ(single.model().displacement(), parallel.model().displacement());
+    }
+}
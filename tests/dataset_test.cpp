@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+#include "../sources/node.hpp"
+#include "../sources/dataset.hpp"
+
+
+class DatasetTest : public ::testing::Test {
+protected:
+    const std::string path;
+
+protected:
+    DatasetTest()
+        :path("dataset_test.tmp")
+    {
+    }
+
+    ~DatasetTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+        std::remove(path.c_str());
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+
+    auto write(const std::string& content) -> void
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+    }
+};
+
+
+TEST_F(DatasetTest, Layout)
+{
+    kg::Dataset<double> dataset(3, 10);
+    ASSERT_EQ(3, dataset.rows());
+    ASSERT_EQ(10, dataset.dimension());
+    ASSERT_EQ(16, dataset.stride());
+    for ( auto r = 0; r < 3; r++ ) {
+        ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(dataset.row(r))%64);
+    }
+    ASSERT_THROW(kg::Dataset<double>(-1, 2), std::string);
+}
+
+
+TEST_F(DatasetTest, ParsingNumbers)
+{
+    const std::vector<std::pair<std::string, double>> cases = {
+        {"0", 0.0}, {"-12", -12.0}, {"+3.25", 3.25}, {".5", 0.5}, {"7.", 7.0},
+        {"1.5e-3", 1.5e-3}, {"2E+10", 2e10}, {"123456789.123456", 123456789.123456},
+        {"1e-300", 1e-300},
+    };
+    for ( const auto& c : cases ) {
+        auto p = c.first.data();
+        double value;
+        ASSERT_TRUE(kg::parseNumber(p, c.first.data() + c.first.size(), value));
+        ASSERT_DOUBLE_EQ(c.second, value);
+        ASSERT_EQ(c.first.data() + c.first.size(), p);
+    }
+
+    const std::string invalid = "abc";
+    auto p = invalid.data();
+    double value;
+    ASSERT_FALSE(kg::parseNumber(p, invalid.data() + invalid.size(), value));
+}
+
+
+TEST_F(DatasetTest, LoadingCSV)
+{
+    write("x,y,z\n1,2,3\n\n-4.5, 5e1 ,6\r\n7,8,9");
+    const auto dataset = kg::loadCSV<double>(path, {0, true, true});
+    ASSERT_EQ(3, dataset.rows());
+    ASSERT_EQ(3, dataset.dimension());
+    ASSERT_DOUBLE_EQ(-4.5, dataset.row(1)[0]);
+    ASSERT_DOUBLE_EQ(50.0, dataset.row(1)[1]);
+    ASSERT_DOUBLE_EQ(9.0, dataset.row(2)[2]);
+
+    ASSERT_TRUE(dataset.hasStatistics());
+    const auto& statistics = dataset.statistics();
+    ASSERT_DOUBLE_EQ(-4.5, statistics.min[0]);
+    ASSERT_DOUBLE_EQ(50.0, statistics.max[1]);
+    ASSERT_DOUBLE_EQ(6.0, statistics.mean[2]);
+
+    const auto nodes = dataset.toNodes();
+    ASSERT_EQ(3U, nodes.size());
+    ASSERT_EQ(3, nodes[0].size());
+    ASSERT_DOUBLE_EQ(2.0, nodes[0][1]);
+
+    // shared rows stay in the buffer of the dataset; a copy of one owns its elements
+    auto loaded = kg::loadCSV<double>(path, {0, true, false});
+    const auto second = loaded.row(1);
+    const auto shared = kg::shareDataset(std::move(loaded));
+    ASSERT_EQ(3U, shared->size());
+    ASSERT_EQ(3, (*shared)[1].size());
+    ASSERT_EQ(second, (*shared)[1].data());
+    ASSERT_DOUBLE_EQ(50.0, (*shared)[1][1]);
+    const auto copy = (*shared)[1];
+    ASSERT_NE(second, copy.data());
+    ASSERT_DOUBLE_EQ(50.0, copy[1]);
+}
+
+
+TEST_F(DatasetTest, LoadingLargeTSV)
+{
+    // enough lines to be split into several chunks
+    std::ostringstream content;
+    for ( auto k = 0; k < 5000; k++ ) {
+        content << k << "\t" << -k << "\t0.25\n";
+    }
+    write(content.str());
+
+    const auto dataset = kg::loadCSV<float>(path);
+    ASSERT_EQ(5000, dataset.rows());
+    ASSERT_EQ(3, dataset.dimension());
+    ASSERT_FALSE(dataset.hasStatistics());
+    for ( auto k = 0; k < 5000; k++ ) {
+        ASSERT_EQ(static_cast<float>(k), dataset.row(k)[0]);
+        ASSERT_EQ(static_cast<float>(-k), dataset.row(k)[1]);
+        ASSERT_EQ(0.25f, dataset.row(k)[2]);
+    }
+}
+
+
+TEST_F(DatasetTest, LoadingInvalidCSV)
+{
+    ASSERT_THROW(kg::loadCSV<double>("no_such_file.csv"), std::string);
+
+    write("1 2 3\n4 5\n");
+    ASSERT_THROW(kg::loadCSV<double>(path), std::string);
+
+    write("1,2\n3,x\n");
+    ASSERT_THROW(kg::loadCSV<double>(path), std::string);
+
+    write("\n\n");
+    ASSERT_THROW(kg::loadCSV<double>(path), std::string);
+}
+
+
+TEST_F(DatasetTest, LoadingBinary)
+{
+    const std::vector<int> values = {1, 2, 3, 4, 5, 6};
+    write(std::string(reinterpret_cast<const char*>(values.data()), sizeof(int)*values.size()));
+
+    auto dataset = kg::loadBinary<int>(path, 2, true);
+    ASSERT_EQ(3, dataset.rows());
+    ASSERT_EQ(6, dataset.row(2)[1]);
+    ASSERT_DOUBLE_EQ(3.0, dataset.statistics().mean[0]);
+    ASSERT_DOUBLE_EQ(6.0, dataset.statistics().max[1]);
+
+    ASSERT_THROW(kg::loadBinary<int>(path, 4), std::string);
+    ASSERT_THROW(kg::loadBinary<int>(path, 0), std::string);
+
+    dataset = kg::loadBinary<int>(path, 3);
+    ASSERT_FALSE(dataset.hasStatistics());
+    dataset.computeStatistics();
+    ASSERT_DOUBLE_EQ(3.5, dataset.statistics().mean[1]);
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../sources/node.hpp"
+#include "../sources/deduplicate.hpp"
+
+
+class DeduplicateTest : public ::testing::Test {
+protected:
+    const int dimension;
+    std::vector<kg::Node<int>> source;
+
+protected:
+    DeduplicateTest()
+        :dimension(3)
+    {
+    }
+
+    ~DeduplicateTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+        const int colors[][3] = {
+            {255, 0, 0}, {0, 255, 0}, {255, 0, 0}, {0, 0, 255}, {0, 255, 0}, {255, 0, 0},
+        };
+        source = std::vector<kg::Node<int>>(6, kg::Node<int>(dimension));
+        for ( auto k = 0; k < 6; k++ ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                source[k][i] = colors[k][i];
+            }
+        }
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(DeduplicateTest, Hashing)
+{
+    ASSERT_EQ(kg::hashNode(source[0]), kg::hashNode(source[2]));
+    ASSERT_NE(kg::hashNode(source[0]), kg::hashNode(source[1]));
+}
+
+
+TEST_F(DeduplicateTest, Deduplication)
+{
+    const auto unique = kg::deduplicate(source);
+    ASSERT_EQ(3U, unique.nodes.size());
+    ASSERT_EQ(std::vector<int>({3, 2, 1}), unique.counts);
+    ASSERT_EQ(std::vector<double>({3.0, 2.0, 1.0}), unique.weights());
+    ASSERT_EQ(255, unique.nodes[0][0]);
+    ASSERT_EQ(255, unique.nodes[1][1]);
+    ASSERT_EQ(255, unique.nodes[2][2]);
+
+    source.push_back(kg::Node<int>(dimension + 1));
+    ASSERT_THROW(kg::deduplicate(source), std::string);
+
+    const auto empty = kg::deduplicate(std::vector<kg::Node<int>>());
+    ASSERT_TRUE(empty.nodes.empty());
+}
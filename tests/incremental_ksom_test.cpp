@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <tuple>
+#include <cmath>
+#include <cstdio>
+#include <unistd.h>
+#include "../sources/node.hpp"
+#include "../sources/incremental_ksom.hpp"
+
+
+class IncrementalKSOMTest : public ::testing::Test {
+protected:
+    using Map = std::vector<std::vector<kg::Node<double>>>;
+
+    IncrementalKSOMTest()
+    {
+    }
+
+    ~IncrementalKSOMTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+
+    // samples around the corners of the unit cube
+    static auto clusters(int length, std::mt19937& mt) -> std::vector<kg::Node<double>>
+    {
+        std::normal_distribution<> noise(0.0, 0.05);
+        std::uniform_int_distribution<> corner(0, 7);
+        std::vector<kg::Node<double>> samples(length, kg::Node<double>(3));
+        for ( auto& node : samples ) {
+            const auto c = corner(mt);
+            for ( auto i = 0; i < 3; i++ ) {
+                node[i] = ((c >> i) & 1) + noise(mt);
+            }
+        }
+
+        return samples;
+    }
+
+    static auto randomMap(int rows, int cols, const std::vector<kg::Node<double>>& samples, std::mt19937& mt) -> Map
+    {
+        std::uniform_int_distribution<> pick(0, samples.size() - 1);
+        Map map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(3)));
+        for ( auto& row : map ) {
+            for ( auto& node : row ) {
+                node = samples[pick(mt)];
+            }
+        }
+
+        return map;
+    }
+};
+
+
+TEST_F(IncrementalKSOMTest, Refresh)
+{
+    // with a threshold of 0 a converged refresh is a fixed point of the batch
+    // SOM: every BMU is exact, and every model vector is the neighborhood-
+    // weighted mean of the samples
+    constexpr auto rows = 3, cols = 3;
+    constexpr auto sigma = 0.5;
+    std::mt19937 mt(1);
+    auto samples = clusters(300, mt);
+    kg::IncrementalKSOM<double> som(randomMap(rows, cols, samples, mt), sigma);
+    som.append(samples);
+    ASSERT_THROW(som.bmu(0), std::string);
+    ASSERT_LT(som.refresh(1000).epochs, 1000);
+
+    const auto more = clusters(30, mt);
+    samples.insert(samples.end(), more.begin(), more.end());
+    som.append(more);
+    const auto stats = som.refresh(1000);
+    ASSERT_LT(stats.epochs, 1000);
+    ASSERT_GE(stats.searches, 30);
+    ASSERT_EQ(330, som.length());
+
+    const auto map = som.map();
+    const auto distance = [&map](const kg::Node<double>& x, int n) {
+        auto dis = 0.0;
+        for ( auto i = 0; i < 3; i++ ) {
+            dis += (x[i] - map[n/cols][n%cols][i])*(x[i] - map[n/cols][n%cols][i]);
+        }
+        return sqrt(dis);
+    };
+    std::vector<int> bmus;
+    auto error = 0.0;
+    for ( auto idx = 0; idx < som.length(); idx++ ) {
+        auto best = 0;
+        for ( auto n = 1; n < rows*cols; n++ ) {
+            if ( distance(samples[idx], n) < distance(samples[idx], best) ) {
+                best = n;
+            }
+        }
+        int r, c;
+        std::tie(r, c) = som.bmu(idx);
+        ASSERT_EQ(best, r*cols + c);
+        bmus.push_back(best);
+        error += distance(samples[idx], best);
+    }
+    ASSERT_NEAR(error/som.length(), som.quantizationError(), 1.0e-9);
+
+    for ( auto n = 0; n < rows*cols; n++ ) {
+        std::vector<double> numerator(3, 0.0);
+        auto denominator = 0.0;
+        for ( auto idx = 0; idx < som.length(); idx++ ) {
+            const auto dr = bmus[idx]/cols - n/cols, dc = bmus[idx]%cols - n%cols;
+            const auto h = exp(-(dr*dr + dc*dc)/(2.0*sigma*sigma));
+            for ( auto i = 0; i < 3; i++ ) {
+                numerator[i] += h*samples[idx][i];
+            }
+            denominator += h;
+        }
+        for ( auto i = 0; i < 3; i++ ) {
+            ASSERT_NEAR(numerator[i]/denominator, map[n/cols][n%cols][i], 1.0e-5);
+        }
+    }
+}
+
+
+TEST_F(IncrementalKSOMTest, Appending)
+{
+    // a few new samples are searched together with the samples of the
+    // neurons they move, not with the whole input
+    constexpr auto length = 4000;
+    std::mt19937 mt(3);
+    const auto samples = clusters(length, mt);
+    kg::IncrementalKSOM<double> som(randomMap(10, 10, samples, mt), 0.5, 0.01);
+    som.append(samples);
+    som.refresh();
+    const auto error = som.quantizationError();
+
+    som.append(clusters(40, mt));
+    const auto stats = som.refresh();
+    ASSERT_EQ(length + 40, som.length());
+    ASSERT_GE(stats.searches, 40);
+    ASSERT_LT(stats.searches, length/4);
+    ASSERT_LT(stats.updatedNeurons, 10*10*stats.epochs + 1);
+    ASSERT_LT(som.quantizationError(), error*1.1);
+
+    // nothing changed, nothing to do
+    const auto idle = som.refresh();
+    ASSERT_EQ(0, idle.epochs);
+    ASSERT_EQ(0, idle.searches);
+}
+
+
+TEST_F(IncrementalKSOMTest, Checkpoint)
+{
+    std::mt19937 mt(2);
+    const auto samples = clusters(500, mt);
+    const auto map = randomMap(4, 5, samples, mt);
+    kg::IncrementalKSOM<double> som(map, 0.7, 0.001);
+    som.append(samples, std::vector<double>(samples.size(), 2.0));
+    som.refresh();
+    const auto extra = std::make_shared<const std::vector<kg::Node<double>>>(clusters(20, mt));
+    som.append(extra);
+
+    // the state of samples that have not been searched yet is kept, the samples are appended again
+    const auto path = "/tmp/ksom_incremental_test_" + std::to_string(getpid());
+    som.checkpoint(path);
+    kg::IncrementalKSOM<double> restored(map, 0.7, 0.001);
+    restored.append(samples);
+    ASSERT_THROW(restored.restore(path), std::string);
+    restored.append(extra);
+    restored.restore(path);
+    ASSERT_EQ(som.length(), restored.length());
+    ASSERT_DOUBLE_EQ(som.quantizationError(), restored.quantizationError());
+
+    const auto more = clusters(20, mt);
+    som.append(more);
+    restored.append(more);
+    const auto stats = som.refresh(), restoredStats = restored.refresh();
+    ASSERT_EQ(stats.searches, restoredStats.searches);
+    const auto trained = som.map(), restoredMap = restored.map();
+    for ( auto r = 0; r < 4; r++ ) {
+        for ( auto c = 0; c < 5; c++ ) {
+            for ( auto i = 0; i < 3; i++ ) {
+                ASSERT_EQ(trained[r][c][i], restoredMap[r][c][i]);
+            }
+        }
+    }
+    for ( auto idx = 0; idx < som.length(); idx++ ) {
+        ASSERT_EQ(som.bmu(idx), restored.bmu(idx));
+    }
+
+    kg::IncrementalKSOM<double> other(randomMap(5, 4, samples, mt), 0.7);
+    ASSERT_THROW(other.restore(path), std::string);
+    ASSERT_THROW(other.restore(path + ".missing"), std::string);
+
+    // a file cut short is rejected before anything is restored
+    ASSERT_EQ(0, truncate(path.c_str(), 512));
+    ASSERT_THROW(restored.restore(path), std::string);
+    ASSERT_EQ(som.length(), restored.length());
+    std::remove(path.c_str());
+}
+
+
+TEST_F(IncrementalKSOMTest, InvalidArguments)
+{
+    std::mt19937 mt(4);
+    const auto samples = clusters(10, mt);
+    const auto map = randomMap(2, 2, samples, mt);
+    ASSERT_THROW(kg::IncrementalKSOM<double>(Map(), 1.0), std::string);
+    ASSERT_THROW(kg::IncrementalKSOM<double>(map, 0.0), std::string);
+    ASSERT_THROW(kg::IncrementalKSOM<double>(map, 1.0, -1.0), std::string);
+
+    kg::IncrementalKSOM<double> som(map, 1.0);
+    ASSERT_THROW(som.append(std::vector<kg::Node<double>>(1, kg::Node<double>(2))), std::string);
+    ASSERT_THROW(som.append(samples, std::vector<double>(3, 1.0)), std::string);
+    ASSERT_THROW(som.append(samples, std::vector<double>(10, -1.0)), std::string);
+    ASSERT_EQ(0, som.length());
+    ASSERT_THROW(som.bmu(0), std::string);
+}
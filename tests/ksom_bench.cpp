@@ -0,0 +1,356 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <chrono>
+#include "../sources/node.hpp"
+#include "../sources/ksom.hpp"
+
+
+namespace kg {
+
+
+class KSOMBenchmark {
+public:
+    template <typename K>
+    static auto findNearestNode(const K& ksom, int idx) -> typename K::Position
+    {
+        return ksom.findNearestNode(idx);
+    }
+
+    template <typename K, typename N>
+    static auto findNearestNodeExhaustively(const K& ksom, const N& node) -> typename K::Position
+    {
+        return ksom.findNearestNodeExhaustively(node);
+    }
+
+    template <typename K>
+    static auto learnNode(K& ksom, int idx, const typename K::Position& nearestPoint) -> double
+    {
+        return ksom.learnNode(idx, nearestPoint);
+    }
+};
+
+
+}
+
+
+namespace {
+    constexpr auto SOURCE_LENGTH = 256;
+    constexpr auto MAX_ELEMENTS = 1LL << 26;
+    constexpr auto COMPUTE_ITERATE = 16;
+    constexpr auto LATENT_DIMENSION = 8;
+    constexpr auto PROJECTED_DIMENSION = 32;
+    constexpr auto PROJECTED_CANDIDATES = 16;
+
+
+    template <typename T>
+    auto randomNodes(int length, int dimension, std::mt19937& mt) -> std::vector<kg::Node<T>>
+    {
+        std::uniform_int_distribution<> rand(0, 255);
+        std::vector<kg::Node<T>> nodes(length, kg::Node<T>(dimension));
+        for ( auto& node : nodes ) {
+            const auto elems = node.data();
+            for ( auto i = 0; i < dimension; i++ ) {
+                elems[i] = static_cast<T>(rand(mt));
+            }
+        }
+
+        return nodes;
+    }
+
+
+    // nodes near a LATENT_DIMENSION-dimensional subspace, like most real
+    // high-dimensional data, so that nearest neighbors survive a projection
+    template <typename T>
+    auto latentNodes(int length, const std::vector<std::vector<double>>& basis, std::mt19937& mt) -> std::vector<kg::Node<T>>
+    {
+        std::normal_distribution<> normal(0.0, 1.0);
+        const auto dimension = static_cast<int>(basis[0].size());
+        std::vector<kg::Node<T>> nodes(length, kg::Node<T>(dimension));
+        for ( auto& node : nodes ) {
+            std::vector<double> elems(dimension, 128.0);
+            for ( const auto& axis : basis ) {
+                const auto z = 16.0*normal(mt);
+                for ( auto i = 0; i < dimension; i++ ) {
+                    elems[i] += z*axis[i];
+                }
+            }
+            for ( auto i = 0; i < dimension; i++ ) {
+                node[i] = static_cast<T>(elems[i] + normal(mt));
+            }
+        }
+
+        return nodes;
+    }
+
+
+    // map side x map side x dimension, skipping maps that do not fit in memory
+    auto mapShapes(benchmark::internal::Benchmark* bench) -> void
+    {
+        for ( const auto side : {10, 50, 100, 500} ) {
+            for ( const auto dimension : {3, 64, 1024} ) {
+                if ( static_cast<long long>(side)*side*dimension <= MAX_ELEMENTS ) {
+                    bench->Args({side, dimension});
+                }
+            }
+        }
+    }
+
+
+    template <typename T>
+    struct Fixture {
+        std::vector<kg::Node<T>> src;
+        std::vector<std::vector<kg::Node<T>>> map;
+
+        Fixture(int side, int dimension)
+        {
+            std::mt19937 mt(1);
+            src = randomNodes<T>(SOURCE_LENGTH, dimension, mt);
+            for ( auto r = 0; r < side; r++ ) {
+                map.push_back(randomNodes<T>(side, dimension, mt));
+            }
+        }
+    };
+
+
+    // map side x dimension x projection method
+    auto projectedShapes(benchmark::internal::Benchmark* bench) -> void
+    {
+        for ( const auto side : {50, 100} ) {
+            for ( const auto dimension : {256, 1024} ) {
+                for ( const auto method : {kg::ProjectionMethod::Random, kg::ProjectionMethod::PCA} ) {
+                    bench->Args({side, dimension, static_cast<int>(method)});
+                }
+            }
+        }
+    }
+
+
+    auto setCounters(benchmark::State& state, int side, int dimension) -> void
+    {
+        state.counters["neurons"]   = side*side;
+        state.counters["dimension"] = dimension;
+        state.SetItemsProcessed(state.iterations()*side*side);
+    }
+}
+
+
+template <typename T>
+static void BM_FindNearestNode(benchmark::State& state)
+{
+    const auto side = state.range(0), dimension = state.range(1);
+    Fixture<T> fixture(side, dimension);
+    kg::KSOM<T> ksom(fixture.src, fixture.map, COMPUTE_ITERATE, 0.1, side/2.0);
+
+    auto idx = 0;
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(kg::KSOMBenchmark::findNearestNode(ksom, idx));
+        idx = (idx + 1)%SOURCE_LENGTH;
+    }
+    setCounters(state, side, dimension);
+}
+
+
+// recall is the ratio of samples whose projected BMU is the exact one, and
+// speedup the time of the exhaustive search over the projected one
+template <typename T>
+static void BM_ProjectedSearch(benchmark::State& state)
+{
+    const auto side = state.range(0), dimension = state.range(1);
+    std::mt19937 mt(1);
+    std::normal_distribution<> normal(0.0, 1.0);
+    std::vector<std::vector<double>> basis(LATENT_DIMENSION, std::vector<double>(dimension));
+    for ( auto& axis : basis ) {
+        for ( auto& value : axis ) {
+            value = normal(mt)/sqrt(dimension);
+        }
+    }
+    const auto src = latentNodes<T>(SOURCE_LENGTH, basis, mt);
+    std::vector<std::vector<kg::Node<T>>> map;
+    for ( auto r = 0; r < side; r++ ) {
+        map.push_back(latentNodes<T>(side, basis, mt));
+    }
+    kg::KSOM<T> ksom(src, map, COMPUTE_ITERATE, 0.1, side/2.0);
+    ksom.enableProjectedSearch(PROJECTED_DIMENSION, PROJECTED_CANDIDATES, static_cast<kg::ProjectionMethod>(state.range(2)));
+
+    std::vector<typename kg::KSOM<T>::Position> exact(SOURCE_LENGTH), projected(SOURCE_LENGTH);
+    const auto begin = std::chrono::steady_clock::now();
+    for ( auto idx = 0; idx < SOURCE_LENGTH; idx++ ) {
+        exact[idx] = kg::KSOMBenchmark::findNearestNodeExhaustively(ksom, src[idx]);
+    }
+    const auto middle = std::chrono::steady_clock::now();
+    for ( auto idx = 0; idx < SOURCE_LENGTH; idx++ ) {
+        projected[idx] = kg::KSOMBenchmark::findNearestNode(ksom, idx);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    auto hits = 0;
+    for ( auto idx = 0; idx < SOURCE_LENGTH; idx++ ) {
+        hits += exact[idx] == projected[idx];
+    }
+
+    auto idx = 0;
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(kg::KSOMBenchmark::findNearestNode(ksom, idx));
+        idx = (idx + 1)%SOURCE_LENGTH;
+    }
+    setCounters(state, side, dimension);
+    state.counters["recall"]    = static_cast<double>(hits)/SOURCE_LENGTH;
+    state.counters["speedup"]   = std::chrono::duration<double>(middle - begin).count()
+                                    /std::chrono::duration<double>(end - middle).count();
+}
+
+
+template <typename T>
+static void BM_LearnNode(benchmark::State& state)
+{
+    const auto side = state.range(0), dimension = state.range(1);
+    Fixture<T> fixture(side, dimension);
+    kg::KSOM<T> ksom(fixture.src, fixture.map, COMPUTE_ITERATE, 0.1, side/2.0);
+
+    auto idx = 0;
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(kg::KSOMBenchmark::learnNode(ksom, idx, std::make_tuple(idx%side, idx%side)));
+        idx = (idx + 1)%SOURCE_LENGTH;
+    }
+    setCounters(state, side, dimension);
+}
+
+
+template <typename T>
+static void BM_ComputeOnes(benchmark::State& state)
+{
+    const auto side = state.range(0), dimension = state.range(1);
+    Fixture<T> fixture(side, dimension);
+    kg::KSOM<T> ksom(fixture.src, fixture.map, std::numeric_limits<int>::max(), 0.1, side/2.0);
+
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(ksom.computeOnes());
+    }
+    setCounters(state, side, dimension);
+}
+
+
+template <typename T>
+static void BM_PipelinedComputeOnes(benchmark::State& state)
+{
+    const auto side = state.range(0), dimension = state.range(1);
+    Fixture<T> fixture(side, dimension);
+    kg::KSOM<T> ksom(fixture.src, fixture.map, std::numeric_limits<int>::max(), 0.1, side/2.0);
+    ksom.enablePipelining();
+
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(ksom.computeOnes());
+    }
+    setCounters(state, side, dimension);
+}
+
+
+template <typename T>
+static void BM_Compute(benchmark::State& state)
+{
+    const auto side = state.range(0), dimension = state.range(1);
+    Fixture<T> fixture(side, dimension);
+
+    for ( auto _ : state ) {
+        state.PauseTiming();
+        kg::KSOM<T> ksom(fixture.src, fixture.map, COMPUTE_ITERATE, 0.1, side/2.0);
+        state.ResumeTiming();
+        ksom.compute();
+    }
+    state.counters["neurons"]   = side*side;
+    state.counters["dimension"] = dimension;
+    state.SetItemsProcessed(state.iterations()*side*side*COMPUTE_ITERATE);
+}
+
+
+template <typename T>
+static void BM_NodeAddition(benchmark::State& state)
+{
+    std::mt19937 mt(1);
+    const auto nodes = randomNodes<T>(2, state.range(0), mt);
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(nodes[0] + nodes[1]);
+    }
+    state.SetBytesProcessed(state.iterations()*state.range(0)*sizeof(T)*3);
+}
+
+
+template <typename T>
+static void BM_NodeMultiplication(benchmark::State& state)
+{
+    std::mt19937 mt(1);
+    const auto nodes = randomNodes<T>(2, state.range(0), mt);
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(nodes[0]*nodes[1]);
+    }
+    state.SetBytesProcessed(state.iterations()*state.range(0)*sizeof(T)*3);
+}
+
+
+template <typename T>
+static void BM_NodeDivision(benchmark::State& state)
+{
+    std::mt19937 mt(1);
+    auto nodes = randomNodes<T>(2, state.range(0), mt);
+    nodes[1] += static_cast<T>(1);
+    for ( auto _ : state ) {
+        benchmark::DoNotOptimize(nodes[0]/nodes[1]);
+    }
+    state.SetBytesProcessed(state.iterations()*state.range(0)*sizeof(T)*3);
+}
+
+
+template <typename T>
+static void BM_NodeCompoundAssignment(benchmark::State& state)
+{
+    std::mt19937 mt(1);
+    auto nodes = randomNodes<T>(2, state.range(0), mt);
+    for ( auto _ : state ) {
+        nodes[0] += nodes[1];
+        nodes[0] -= nodes[1];
+        benchmark::DoNotOptimize(nodes[0].data());
+    }
+    state.SetBytesProcessed(state.iterations()*state.range(0)*sizeof(T)*6);
+}
+
+
+template <typename T>
+static void BM_NodeCopy(benchmark::State& state)
+{
+    std::mt19937 mt(1);
+    const auto nodes = randomNodes<T>(1, state.range(0), mt);
+    for ( auto _ : state ) {
+        kg::Node<T> node(nodes[0]);
+        benchmark::DoNotOptimize(node.data());
+    }
+    state.SetBytesProcessed(state.iterations()*state.range(0)*sizeof(T)*2);
+}
+
+
+#define KSOM_BENCHMARK(func) \
+    BENCHMARK_TEMPLATE(func, int)->Apply(mapShapes)->Unit(benchmark::kMicrosecond); \
+    BENCHMARK_TEMPLATE(func, float)->Apply(mapShapes)->Unit(benchmark::kMicrosecond); \
+    BENCHMARK_TEMPLATE(func, double)->Apply(mapShapes)->Unit(benchmark::kMicrosecond)
+
+#define NODE_BENCHMARK(func) \
+    BENCHMARK_TEMPLATE(func, int)->RangeMultiplier(4)->Range(4, 1024); \
+    BENCHMARK_TEMPLATE(func, float)->RangeMultiplier(4)->Range(4, 1024); \
+    BENCHMARK_TEMPLATE(func, double)->RangeMultiplier(4)->Range(4, 1024)
+
+KSOM_BENCHMARK(BM_FindNearestNode);
+BENCHMARK_TEMPLATE(BM_ProjectedSearch, float)->Apply(projectedShapes)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_ProjectedSearch, double)->Apply(projectedShapes)->Unit(benchmark::kMicrosecond);
+KSOM_BENCHMARK(BM_LearnNode);
+KSOM_BENCHMARK(BM_ComputeOnes);
+KSOM_BENCHMARK(BM_PipelinedComputeOnes);
+KSOM_BENCHMARK(BM_Compute);
+NODE_BENCHMARK(BM_NodeAddition);
+NODE_BENCHMARK(BM_NodeMultiplication);
+NODE_BENCHMARK(BM_NodeDivision);
+NODE_BENCHMARK(BM_NodeCompoundAssignment);
+NODE_BENCHMARK(BM_NodeCopy);
+
+
+BENCHMARK_MAIN();
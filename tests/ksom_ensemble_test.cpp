@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../sources/node.hpp"
+#include "../sources/ksom.hpp"
+#include "../sources/ksom_ensemble.hpp"
+
+
+class KSOMEnsembleTest : public ::testing::Test {
+protected:
+    const int dimension;
+    std::vector<kg::Node<double>> source;
+
+protected:
+    KSOMEnsembleTest()
+        :dimension(3)
+    {
+    }
+
+    ~KSOMEnsembleTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+        source = std::vector<kg::Node<double>>(8, kg::Node<double>(dimension));
+        for ( auto k = 0; k < 8; k++ ) {
+            source[k][0] = k%2;
+            source[k][1] = (k/2)%2;
+            source[k][2] = k/4;
+        }
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+
+    auto createMap(int rows, int cols) -> std::vector<std::vector<kg::Node<double>>>
+    {
+        std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+        for ( auto r = 0; r < rows; r++ ) {
+            for ( auto c = 0; c < cols; c++ ) {
+                map[r][c][0] = 0.1*r;
+                map[r][c][1] = 0.1*c;
+                map[r][c][2] = 0.5;
+            }
+        }
+
+        return map;
+    }
+};
+
+
+TEST_F(KSOMEnsembleTest, Initialization)
+{
+    ASSERT_THROW(kg::KSOMEnsemble<double>(std::vector<kg::Node<double>>()), std::string);
+
+    kg::KSOMEnsemble<double> ensemble(source);
+    ASSERT_EQ(0, ensemble.size());
+    ASSERT_EQ(0, ensemble.add(createMap(3, 3), 10, 0.1, 1.0));
+    ASSERT_EQ(1, ensemble.add(createMap(2, 4), 10, 0.1, 1.0));
+    ASSERT_EQ(2, ensemble.size());
+
+    std::vector<std::vector<kg::Node<double>>> invalidMap(2, std::vector<kg::Node<double>>(2, kg::Node<double>(dimension + 1)));
+    ASSERT_THROW(ensemble.add(invalidMap, 10, 0.1, 1.0), std::string);
+}
+
+
+TEST_F(KSOMEnsembleTest, SameResultAsIndependentModels)
+{
+    const std::vector<std::tuple<int, int, int, double, double>> configs = {
+        std::make_tuple(3, 3, 20, 0.1, 1.0),
+        std::make_tuple(3, 3, 30, 0.3, 2.0),
+        std::make_tuple(2, 4, 25, 0.2, 1.5),
+    };
+
+    kg::KSOMEnsemble<double> ensemble(source, false);
+    std::vector<kg::KSOM<double>> models;
+    for ( const auto& config : configs ) {
+        const auto map = createMap(std::get<0>(config), std::get<1>(config));
+        ensemble.add(map, std::get<2>(config), std::get<3>(config), std::get<4>(config));
+        models.emplace_back(source, map, std::get<2>(config), std::get<3>(config), std::get<4>(config), false);
+    }
+    ensemble.model(1).enableProfiling();
+    ensemble.compute();
+    ASSERT_EQ(30, ensemble.time());
+    ASSERT_FALSE(ensemble.computeOnes());
+
+    for ( auto k = 0; k < ensemble.size(); k++ ) {
+        models[k].compute();
+        ASSERT_EQ(models[k].time(), ensemble.model(k).time());
+        ASSERT_EQ(kg::StopReason::MaxIterate, ensemble.model(k).stopReason());
+
+        const auto expected = models[k].map(), actual = ensemble.model(k).map();
+        for ( auto r = 0U; r < expected.size(); r++ ) {
+            for ( auto c = 0U; c < expected[r].size(); c++ ) {
+                for ( auto i = 0; i < dimension; i++ ) {
+                    ASSERT_DOUBLE_EQ(expected[r][c][i], actual[r][c][i]);
+                }
+            }
+        }
+    }
+
+    const auto profile = ensemble.model(1).profile();
+    ASSERT_EQ(30, profile.steps);
+    ASSERT_EQ(30*9, profile.neuronsVisited);
+}
+
+
+TEST_F(KSOMEnsembleTest, ConfiguredModels)
+{
+    // models with their own search engine or threads train as they would alone
+    const auto map = createMap(4, 4);
+    kg::KSOMEnsemble<double> ensemble(source, false);
+    std::vector<kg::KSOM<double>> models;
+    for ( auto k = 0; k < 3; k++ ) {
+        ensemble.add(map, 40, 0.3, 2.0);
+        models.emplace_back(source, map, 40, 0.3, 2.0, false);
+    }
+    ensemble.model(0).enableHierarchicalSearch(2, 1, 1.0e-4, 1);
+    models[0].enableHierarchicalSearch(2, 1, 1.0e-4, 1);
+    ensemble.model(1).enableProjectedSearch(2, 2);
+    models[1].enableProjectedSearch(2, 2);
+    ensemble.model(2).setThreads(2);
+    models[2].setThreads(2);
+    ensemble.model(0).enableProfiling();
+    models[0].enableProfiling();
+    ensemble.compute();
+
+    for ( auto k = 0; k < ensemble.size(); k++ ) {
+        models[k].compute();
+        const auto expected = models[k].map(), actual = ensemble.model(k).map();
+        for ( auto r = 0; r < 4; r++ ) {
+            for ( auto c = 0; c < 4; c++ ) {
+                for ( auto i = 0; i < dimension; i++ ) {
+                    ASSERT_DOUBLE_EQ(expected[r][c][i], actual[r][c][i]);
+                }
+            }
+        }
+        ASSERT_DOUBLE_EQ(models[k].quantizationError(), ensemble.model(k).quantizationError());
+    }
+    ASSERT_EQ(models[0].searchStats().searches, ensemble.model(0).searchStats().searches);
+    ASSERT_EQ(40, ensemble.model(0).searchStats().checks);
+    ASSERT_EQ(models[0].profile().neuronsVisited, ensemble.model(0).profile().neuronsVisited);
+}
+
+
+TEST_F(KSOMEnsembleTest, PipelinedModels)
+{
+    // a pipelined model finds the BMU of the next sample of the ensemble while it learns
+    const auto map = createMap(4, 4);
+    kg::KSOMEnsemble<double> ensemble(source, false);
+    ensemble.add(map, 40, 0.3, 2.0);
+    ensemble.add(map, 40, 0.3, 2.0);
+    kg::KSOM<double> model(source, map, 40, 0.3, 2.0, false);
+    ensemble.model(0).enablePipelining();
+    model.enablePipelining();
+    ensemble.model(0).enableProfiling();
+    model.enableProfiling();
+    ensemble.compute();
+    model.compute();
+
+    const auto expected = model.map(), actual = ensemble.model(0).map();
+    for ( auto r = 0; r < 4; r++ ) {
+        for ( auto c = 0; c < 4; c++ ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                ASSERT_DOUBLE_EQ(expected[r][c][i], actual[r][c][i]);
+            }
+        }
+    }
+
+    // one sweep per step: the first search and the fused searches of the other steps
+    ASSERT_EQ(40*16, ensemble.model(0).profile().neuronsVisited);
+    ASSERT_EQ(model.profile().neuronsVisited, ensemble.model(0).profile().neuronsVisited);
+}
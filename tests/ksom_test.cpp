@@ -1,6 +1,16 @@
 #include <gtest/gtest.h>
 #include <string>
 #include <vector>
+#include <random>
+#include <cmath>
+#include <cstdio>
+#include <future>
+#include <chrono>
+#include <fstream>
+#include <tuple>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
 #include "../sources/node.hpp"
 #include "../sources/ksom.hpp"
 
@@ -124,3 +134,820 @@ TEST_F(KSOMTest, GettingMap)
     }
 }
 
+
+TEST_F(KSOMTest, SparseComputation)
+{
+    constexpr auto dimension = 8, length = 5, rows = 3, cols = 4, maxIterate = 200;
+    std::vector<kg::Node<double>> denseSource(length, kg::Node<double>(dimension));
+    std::vector<kg::SparseNode<double>> sparseSource;
+    for ( auto n = 0; n < length; n++ ) {
+        denseSource[n][n] = 1.0 + n;
+        denseSource[n][(3*n + 1)%dimension] = -0.5*n;
+        sparseSource.emplace_back(denseSource[n]);
+    }
+
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            map[r][c][(r + c)%dimension] = 0.1*(r + 1);
+        }
+    }
+
+    auto denseSOM   = kg::KSOM<double>(denseSource, map, maxIterate, 0.5, 2.0, false);
+    auto sparseSOM  = kg::KSOM<double>(sparseSource, map, maxIterate, 0.5, 2.0, false);
+    denseSOM.compute();
+    sparseSOM.compute();
+
+    const auto denseMap = denseSOM.map(), sparseMap = sparseSOM.map();
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                ASSERT_NEAR(denseMap[r][c][i], sparseMap[r][c][i], 1.0e-9);
+            }
+        }
+    }
+    for ( auto n = 0; n < length; n++ ) {
+        ASSERT_EQ(denseSOM.bmu(denseSource[n]), sparseSOM.bmu(sparseSource[n]));
+    }
+
+    ASSERT_THROW(sparseSOM.bmu(kg::SparseNode<double>(dimension + 1)), std::string);
+}
+
+TEST_F(KSOMTest, ComputationWithMetrics)
+{
+    constexpr auto dimension = 2;
+    std::vector<kg::Node<double>> source(2, kg::Node<double>(dimension));
+    source[0][0] = 1.0;
+    source[1][1] = 4.0;
+
+    std::vector<std::vector<kg::Node<double>>> map(1, std::vector<kg::Node<double>>(2, kg::Node<double>(dimension)));
+    map[0][0][0] = 10.0;
+    map[0][0][1] = 0.5;
+    map[0][1][0] = 0.5;
+    map[0][1][1] = 1.0;
+
+    // map[0][0] points the same way as source[0] but is far from it
+    auto euclideanSOM   = kg::KSOM<double>(source, map, 10, 0.1, 1.0);
+    auto cosineSOM      = kg::KSOM<double, kg::CosineMetric>(source, map, 10, 0.1, 1.0);
+    auto manhattanSOM   = kg::KSOM<double, kg::ManhattanMetric>(source, map, 10, 0.1, 1.0);
+    auto weightedSOM    = kg::KSOM<double, kg::WeightedEuclideanMetric>(source, map, 10, 0.1, 1.0,
+                                                                        true, kg::WeightedEuclideanMetric({0.0, 1.0}));
+    ASSERT_EQ(std::make_tuple(0, 1), euclideanSOM.bmu(source[0]));
+    ASSERT_EQ(std::make_tuple(0, 0), cosineSOM.bmu(source[0]));
+    ASSERT_EQ(std::make_tuple(0, 1), manhattanSOM.bmu(source[0]));
+    ASSERT_EQ(std::make_tuple(0, 0), weightedSOM.bmu(source[0]));
+
+    cosineSOM.compute();
+    manhattanSOM.compute();
+    weightedSOM.compute();
+    ASSERT_EQ(10, cosineSOM.time());
+
+    ASSERT_THROW((kg::KSOM<double, kg::WeightedEuclideanMetric>(source, map, 10, 0.1, 1.0)), std::string);
+}
+
+TEST_F(KSOMTest, ComputationWithTopologies)
+{
+    constexpr auto dimension = 2, rows = 3, cols = 3;
+    std::vector<kg::Node<double>> source(2, kg::Node<double>(dimension));
+    source[0][0] = 1.0;
+    source[1][1] = 1.0;
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+
+    auto toroidalSOM    = kg::KSOM<double, kg::EuclideanMetric, kg::ToroidalTopology>(source, map, 10, 0.1, 1.0);
+    auto hexagonalSOM   = kg::KSOM<double, kg::EuclideanMetric, kg::HexagonalTopology>(source, map, 10, 0.1, 1.0);
+    toroidalSOM.compute();
+    hexagonalSOM.compute();
+    ASSERT_EQ(10, toroidalSOM.time());
+    ASSERT_EQ(10, hexagonalSOM.time());
+
+    // neurons without an edge to the BMU never move
+    auto graphSOM = kg::KSOM<double, kg::EuclideanMetric, kg::GraphTopology>(source, map, 10, 0.1, 1.0,
+                                                                            false, kg::EuclideanMetric(),
+                                                                            kg::GraphTopology({{0, 1}}));
+    graphSOM.compute();
+    const auto trainedMap = graphSOM.map();
+    ASSERT_GT(trainedMap[0][1][0], 0.0);
+    ASSERT_DOUBLE_EQ(0.0, trainedMap[2][2][0]);
+    ASSERT_DOUBLE_EQ(0.0, trainedMap[2][2][1]);
+}
+
+TEST_F(KSOMTest, LinearInitialization)
+{
+    constexpr auto dimension = 2, rows = 6, cols = 4, maxIterate = 200;
+    std::vector<kg::Node<double>> source(100, kg::Node<double>(dimension));
+    for ( auto n = 0; n < 100; n++ ) {
+        source[n][0] = n%10;
+        source[n][1] = 0.5*(n/10);
+    }
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+
+    auto ksom = kg::KSOM<double>(source, map, maxIterate, 0.1, 1.0);
+    ksom.initializeLinearly();
+    const auto expected = kg::linearMap(source, rows, cols), initialized = ksom.map();
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                ASSERT_DOUBLE_EQ(expected[r][c][i], initialized[r][c][i]);
+            }
+        }
+    }
+
+    // the map starts untangled, so a short run with a small radius suffices
+    auto zeroSOM = kg::KSOM<double>(source, map, maxIterate, 0.1, 1.0);
+    ASSERT_LT(ksom.evaluate().quantizationError, zeroSOM.evaluate().quantizationError);
+    ksom.compute();
+    ASSERT_LT(ksom.evaluate().topographicError, 0.1);
+}
+
+TEST_F(KSOMTest, HierarchicalSearch)
+{
+    constexpr auto dimension = 2, rows = 20, cols = 20, maxIterate = 50;
+    std::vector<kg::Node<double>> source(4, kg::Node<double>(dimension));
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            map[r][c][0] = r;
+            map[r][c][1] = c;
+        }
+    }
+    for ( auto n = 0; n < 4; n++ ) {
+        source[n][0] = 4.3*n + 1.2;
+        source[n][1] = 18.6 - 3.6*n;
+    }
+
+    auto ksom = kg::KSOM<double>(source, map, maxIterate, 0.1, 2.0);
+    ksom.enableHierarchicalSearch(4, 2, 1.0e-4, 1);
+    ASSERT_EQ(std::make_tuple(1, 19), ksom.bmu(source[0]));
+    ASSERT_EQ(std::make_tuple(14, 8), ksom.bmu(source[3]));
+
+    ksom.compute();
+    const auto stats = ksom.searchStats();
+    ASSERT_EQ(maxIterate, stats.searches);
+    ASSERT_EQ(maxIterate, stats.checks);
+    ASSERT_LE(stats.mismatches, stats.checks);
+
+    ASSERT_THROW(ksom.enableHierarchicalSearch(4, 2, 0.0), std::string);
+}
+
+TEST_F(KSOMTest, ProjectedSearch)
+{
+    constexpr auto dimension = 2, rows = 20, cols = 20, maxIterate = 50;
+    std::vector<kg::Node<double>> source(4, kg::Node<double>(dimension));
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            map[r][c][0] = r;
+            map[r][c][1] = c;
+        }
+    }
+    for ( auto n = 0; n < 4; n++ ) {
+        source[n][0] = 4.3*n + 1.2;
+        source[n][1] = 18.6 - 3.6*n;
+    }
+
+    // a rotation onto both principal components keeps every distance
+    auto ksom = kg::KSOM<double>(source, map, maxIterate, 0.1, 2.0);
+    ksom.enableProjectedSearch(2, 4, kg::ProjectionMethod::PCA, 1);
+    ASSERT_EQ(std::make_tuple(1, 19), ksom.bmu(source[0]));
+    ASSERT_EQ(std::make_tuple(14, 8), ksom.bmu(source[3]));
+
+    ksom.compute();
+    const auto stats = ksom.searchStats();
+    ASSERT_EQ(maxIterate, stats.searches);
+    ASSERT_EQ(maxIterate, stats.checks);
+    ASSERT_EQ(0, stats.mismatches);
+
+    auto randomSOM = kg::KSOM<double>(source, map, maxIterate, 0.1, 2.0);
+    randomSOM.enableProjectedSearch(1, rows*cols);
+    ASSERT_EQ(std::make_tuple(1, 19), randomSOM.bmu(source[0]));
+
+    ASSERT_THROW(ksom.enableProjectedSearch(3), std::string);
+    ASSERT_THROW(ksom.enableProjectedSearch(2, 0), std::string);
+}
+
+TEST_F(KSOMTest, Pipelining)
+{
+    constexpr auto dimension = 3, rows = 6, cols = 5, maxIterate = 60;
+    std::mt19937 mt(1);
+    std::uniform_real_distribution<> rand(0.0, 1.0);
+    std::vector<kg::Node<double>> source(7, kg::Node<double>(dimension));
+    for ( auto& node : source ) {
+        for ( auto i = 0; i < dimension; i++ ) {
+            node[i] = rand(mt);
+        }
+    }
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+    for ( auto& row : map ) {
+        for ( auto& node : row ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                node[i] = rand(mt);
+            }
+        }
+    }
+
+    // the BMUs found while updating give exactly the same training
+    auto ksom = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0, false);
+    auto pipelined = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0, false);
+    pipelined.enablePipelining();
+    pipelined.enableProfiling();
+    ksom.compute();
+    pipelined.compute();
+    const auto expectedMap = ksom.map(), pipelinedMap = pipelined.map();
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                ASSERT_EQ(expectedMap[r][c][i], pipelinedMap[r][c][i]);
+            }
+        }
+    }
+    ASSERT_EQ(ksom.quantizationError(), pipelined.quantizationError());
+
+    // only the first search of the run sweeps the map on its own
+    const auto profile = pipelined.profile();
+    ASSERT_EQ(maxIterate*rows*cols, profile.neuronsVisited);
+
+    auto sparseSource = std::vector<kg::SparseNode<double>>(1, kg::SparseNode<double>(dimension, {0}, {1.0}));
+    auto sparseSOM = kg::KSOM<double>(sparseSource, map, maxIterate, 0.3, 2.0);
+    ASSERT_THROW(sparseSOM.enablePipelining(), std::string);
+}
+
+TEST_F(KSOMTest, Autotuning)
+{
+    constexpr auto dimension = 3, rows = 6, cols = 5, maxIterate = 60;
+    std::mt19937 mt(1);
+    std::uniform_real_distribution<> rand(0.0, 1.0);
+    std::vector<kg::Node<double>> source(7, kg::Node<double>(dimension));
+    for ( auto& node : source ) {
+        for ( auto i = 0; i < dimension; i++ ) {
+            node[i] = rand(mt);
+        }
+    }
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+    for ( auto& row : map ) {
+        for ( auto& node : row ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                node[i] = rand(mt);
+            }
+        }
+    }
+
+    // without approximate engines, tuning does not change the training
+    const std::string path = "ksom_test_tuning.txt";
+    std::remove(path.c_str());
+    auto ksom = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0, false);
+    auto tuned = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0, false);
+    const auto choice = tuned.autotune(path, false, 8);
+    ASSERT_EQ(kg::SearchEngine::Exhaustive, choice.engine);
+    ASSERT_EQ(choice.threads, tuned.threads());
+    ASSERT_EQ(0, tuned.time());
+    ksom.compute();
+    tuned.compute();
+    const auto expectedMap = ksom.map(), tunedMap = tuned.map();
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                ASSERT_EQ(expectedMap[r][c][i], tunedMap[r][c][i]);
+            }
+        }
+    }
+
+    // a cached choice is applied as it is
+    kg::TuningProfile profile;
+    ASSERT_TRUE(profile.load(path));
+    ASSERT_EQ(1, profile.size());
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    file.close();
+    std::ofstream(path) << line.substr(0, line.rfind('\t', line.rfind('\t') - 1)) << "\t1\t1\n";
+    auto cached = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0, false);
+    const auto cachedChoice = cached.autotune(path, false, 8);
+    ASSERT_EQ(1, cachedChoice.threads);
+    ASSERT_TRUE(cachedChoice.pipelined);
+    ASSERT_EQ(1, cached.threads());
+    std::remove(path.c_str());
+
+    ASSERT_THROW(cached.autotune("", false, 0), std::string);
+    ASSERT_THROW(cached.setThreads(-1), std::string);
+}
+
+TEST_F(KSOMTest, Reproducibility)
+{
+    constexpr auto dimension = 4, rows = 7, cols = 6, maxIterate = 200;
+    std::mt19937 mt(1);
+    std::uniform_real_distribution<> rand(0.0, 1.0);
+    std::vector<kg::Node<double>> source(23, kg::Node<double>(dimension));
+    for ( auto& node : source ) {
+        for ( auto i = 0; i < dimension; i++ ) {
+            node[i] = rand(mt);
+        }
+    }
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+    for ( auto& row : map ) {
+        for ( auto& node : row ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                node[i] = rand(mt);
+            }
+        }
+    }
+    const auto assertSameMap = [](const std::vector<std::vector<kg::Node<double>>>& expected,
+                                    const std::vector<std::vector<kg::Node<double>>>& actual) {
+        for ( auto r = 0; r < rows; r++ ) {
+            for ( auto c = 0; c < cols; c++ ) {
+                for ( auto i = 0; i < dimension; i++ ) {
+                    ASSERT_EQ(expected[r][c][i], actual[r][c][i]);
+                }
+            }
+        }
+    };
+
+    // the same seed gives bitwise the same training on any number of threads
+    auto ksom = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0);
+    ksom.setSeed(12345);
+    ksom.setThreads(1);
+    ASSERT_EQ(12345U, ksom.seed());
+    ksom.compute();
+    for ( const auto threads : {2, 3, 4} ) {
+        auto parallel = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0);
+        parallel.setSeed(12345);
+        parallel.setThreads(threads);
+        parallel.enablePipelining();
+        parallel.compute();
+        assertSameMap(ksom.map(), parallel.map());
+        ASSERT_EQ(ksom.quantizationError(), parallel.quantizationError());
+        ASSERT_EQ(ksom.displacement(), parallel.displacement());
+    }
+
+    // seeding in the middle of training draws the remaining steps as if seeded from the start
+    auto reseeded = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0);
+    auto seeded = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0);
+    seeded.setSeed(7);
+    for ( auto t = 0; t < maxIterate/2; t++ ) {
+        reseeded.computeOnes();
+        seeded.computeOnes();
+    }
+    reseeded.setSeed(7);
+    const auto path = "ksom_test_reproducibility.bin";
+    seeded.checkpoint(path);
+    auto restored = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0);
+    restored.restore(path);
+    std::remove(path);
+    ASSERT_EQ(7U, restored.seed());
+    seeded.compute();
+    restored.compute();
+    assertSameMap(seeded.map(), restored.map());
+
+    // a different seed visits the samples in another order
+    auto other = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0);
+    other.setSeed(12346);
+    other.compute();
+    ASSERT_NE(ksom.map()[0][0][0], other.map()[0][0][0]);
+}
+
+TEST_F(KSOMTest, SampleIndex)
+{
+    constexpr auto dimension = 2, rows = 8, cols = 8, maxIterate = 500;
+    std::mt19937 mt(1);
+    std::uniform_real_distribution<> rand(0.0, 1.0);
+    std::vector<kg::Node<double>> source(200, kg::Node<double>(dimension));
+    std::vector<int> labels;
+    for ( auto& node : source ) {
+        for ( auto i = 0; i < dimension; i++ ) {
+            node[i] = rand(mt);
+        }
+        labels.push_back(node[0] < 0.5 ? 0 : 1);
+    }
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+    auto ksom = kg::KSOM<double>(source, map, maxIterate, 0.3, 3.0);
+    ASSERT_THROW(ksom.nearestSamples(source[0], 1), std::string);
+    ksom.setSeed(1);
+    ksom.initializeLinearly();
+    ksom.compute();
+
+    // the index holds the BMU of every sample
+    const auto& index = ksom.indexSamples();
+    ASSERT_EQ(&index, &ksom.indexSamples());
+    ASSERT_EQ(static_cast<int>(source.size()), index.size());
+    auto total = 0;
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            total += index.hits(r, c);
+            for ( const auto idx : index.samples(r, c) ) {
+                ASSERT_EQ(std::make_tuple(r, c), ksom.bmu(source[idx]));
+            }
+        }
+    }
+    ASSERT_EQ(static_cast<int>(source.size()), total);
+    ASSERT_EQ(source.size(), index.region(0, 0, rows, cols).size());
+
+    // most samples are classified by the majority label of their BMU
+    const auto majority = index.majorityLabels(labels);
+    auto correct = 0;
+    for ( auto idx = 0; idx < static_cast<int>(source.size()); idx++ ) {
+        const auto nearestPoint = ksom.bmu(source[idx]);
+        correct += majority[std::get<0>(nearestPoint)][std::get<1>(nearestPoint)] == labels[idx] ? 1 : 0;
+    }
+    ASSERT_GT(correct, 0.9*source.size());
+
+    // nearest samples agree with a brute-force ranking
+    constexpr auto k = 5;
+    for ( auto query = 0; query < 20; query++ ) {
+        kg::Node<double> node(dimension);
+        for ( auto i = 0; i < dimension; i++ ) {
+            node[i] = rand(mt);
+        }
+        std::vector<std::pair<double, int>> ranked;
+        for ( auto idx = 0; idx < static_cast<int>(source.size()); idx++ ) {
+            auto sum = 0.0;
+            for ( auto i = 0; i < dimension; i++ ) {
+                sum += (node[i] - source[idx][i])*(node[i] - source[idx][i]);
+            }
+            ranked.emplace_back(sum, idx);
+        }
+        std::sort(ranked.begin(), ranked.end());
+        const auto nearest = ksom.nearestSamples(node, k);
+        ASSERT_EQ(static_cast<size_t>(k), nearest.size());
+        ASSERT_EQ(ranked[0].second, nearest[0]);
+    }
+    ASSERT_EQ(source.size(), ksom.nearestSamples(source[0], 1000).size());
+    ASSERT_THROW(ksom.nearestSamples(source[0], 0), std::string);
+}
+
+TEST_F(KSOMTest, EarlyStopping)
+{
+    constexpr auto dimension = 2, maxIterate = 10000;
+    std::vector<kg::Node<double>> source(1, kg::Node<double>(dimension));
+    source[0][0] = 1.0;
+    source[0][1] = 2.0;
+    std::vector<std::vector<kg::Node<double>>> map(2, std::vector<kg::Node<double>>(2, kg::Node<double>(dimension)));
+
+    auto fullSOM = kg::KSOM<double>(source, map, 100, 0.5, 1.0);
+    ASSERT_EQ(kg::StopReason::None, fullSOM.stopReason());
+    fullSOM.compute();
+    ASSERT_EQ(100, fullSOM.time());
+    ASSERT_EQ(kg::StopReason::MaxIterate, fullSOM.stopReason());
+    ASSERT_LT(fullSOM.quantizationError(), sqrt(5.0));
+
+    auto displacementSOM = kg::KSOM<double>(source, map, maxIterate, 0.5, 1.0);
+    displacementSOM.setStoppingCriteria({0.5, 0.0, 1.0e-6, 10, 1, 0});
+    displacementSOM.compute();
+    ASSERT_EQ(kg::StopReason::Displacement, displacementSOM.stopReason());
+    ASSERT_LT(displacementSOM.time(), maxIterate);
+    ASSERT_LT(displacementSOM.displacement(), 1.0e-6);
+    ASSERT_FALSE(displacementSOM.computeOnes());
+
+    auto errorSOM = kg::KSOM<double>(source, map, maxIterate, 0.5, 1.0);
+    errorSOM.setStoppingCriteria({0.5, 1.0e-3, 0.0, 10, 3, 100});
+    errorSOM.compute();
+    ASSERT_EQ(kg::StopReason::QuantizationError, errorSOM.stopReason());
+    ASSERT_GE(errorSOM.time(), 100);
+    ASSERT_LT(errorSOM.time(), maxIterate);
+
+    ASSERT_THROW(errorSOM.setStoppingCriteria({0.0, 1.0e-3, 0.0, 10, 3, 0}), std::string);
+}
+
+TEST_F(KSOMTest, Evaluation)
+{
+    constexpr auto dimension = 2;
+    std::vector<std::vector<kg::Node<double>>> map(1, std::vector<kg::Node<double>>(3, kg::Node<double>(dimension)));
+    map[0][0][0] = 0.0;
+    map[0][1][0] = 1.0;
+    map[0][2][0] = 3.0;
+
+    // second BMU of the last sample is map[0][0], which is not a neighbor of map[0][2]
+    std::vector<kg::Node<double>> source(3, kg::Node<double>(dimension));
+    source[0][0] = 0.25;
+    source[1][0] = 1.0;
+    source[1][1] = 1.0;
+    source[2][0] = 1.75;
+
+    auto ksom = kg::KSOM<double>(source, map, 1, 0.1, 1.0);
+    const auto quality = ksom.evaluate();
+    ASSERT_DOUBLE_EQ((0.25 + 1.0 + 0.75)/3.0, quality.quantizationError);
+    ASSERT_DOUBLE_EQ(0.0, quality.topographicError);
+
+    source[2][0] = 1.4;
+    source[2][1] = 1.0;
+    std::vector<kg::Node<double>> samples{source[0], source[2]};
+    const auto sampleQuality = ksom.evaluate(samples);
+    ASSERT_DOUBLE_EQ(0.0, sampleQuality.topographicError);
+
+    samples[1][0] = 2.2;
+    samples[1][1] = 0.0;
+    map[0][0][0] = 2.0;
+    auto swappedSOM = kg::KSOM<double>(source, map, 1, 0.1, 1.0);
+    ASSERT_DOUBLE_EQ(0.5, swappedSOM.evaluate(samples).topographicError);
+
+    std::vector<kg::SparseNode<double>> sparseSamples;
+    for ( const auto& node : samples ) {
+        sparseSamples.emplace_back(node);
+    }
+    auto sparseSOM = kg::KSOM<double>(sparseSamples, map, 1, 0.1, 1.0);
+    ASSERT_DOUBLE_EQ(swappedSOM.evaluate(samples).quantizationError, sparseSOM.evaluate().quantizationError);
+    ASSERT_DOUBLE_EQ(0.5, sparseSOM.evaluate().topographicError);
+    ASSERT_THROW(ksom.evaluate(std::vector<kg::Node<double>>()), std::string);
+    ASSERT_THROW(ksom.evaluate(std::vector<kg::SparseNode<double>>()), std::string);
+    ASSERT_THROW(sparseSOM.evaluate(std::vector<kg::Node<double>>()), std::string);
+
+    const auto matrix = ksom.uMatrix();
+    ASSERT_DOUBLE_EQ(1.0, matrix[0][0]);
+    ASSERT_DOUBLE_EQ(1.5, matrix[0][1]);
+    ASSERT_DOUBLE_EQ(2.0, matrix[0][2]);
+    const auto sparseMatrix = sparseSOM.uMatrix();
+    ASSERT_DOUBLE_EQ(1.5, sparseMatrix[0][1]);
+}
+
+TEST_F(KSOMTest, CheckpointAndRestore)
+{
+    constexpr auto dimension = 3, maxIterate = 40;
+    std::vector<kg::Node<double>> source(5, kg::Node<double>(dimension));
+    for ( auto n = 0; n < 5; n++ ) {
+        for ( auto i = 0; i < dimension; i++ ) {
+            source[n][i] = (n*7 + i*3)%5;
+        }
+    }
+    std::vector<std::vector<kg::Node<double>>> map(3, std::vector<kg::Node<double>>(4, kg::Node<double>(dimension)));
+
+    const std::string path = "ksom_test_checkpoint.bin";
+    auto ksom = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0);
+    for ( auto t = 0; t < maxIterate/2; t++ ) {
+        ksom.computeOnes();
+    }
+    ksom.snapshotAsync(path).get();
+
+    // a restored map continues with the same samples as the original one
+    auto restored = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0);
+    restored.restore(path);
+    ASSERT_EQ(ksom.time(), restored.time());
+    ksom.compute();
+    restored.compute();
+    const auto expectedMap = ksom.map(), restoredMap = restored.map();
+    for ( auto r = 0; r < 3; r++ ) {
+        for ( auto c = 0; c < 4; c++ ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                ASSERT_EQ(expectedMap[r][c][i], restoredMap[r][c][i]);
+            }
+        }
+    }
+
+    auto otherSchedule = kg::KSOM<double>(source, map, maxIterate, 0.1, 2.0);
+    ASSERT_THROW(otherSchedule.restore(path), std::string);
+    auto otherDecay = kg::KSOM<double>(source, map, maxIterate, 0.3, 2.0);
+    ASSERT_THROW(otherDecay.setTimeConstant(0.0), std::string);
+    otherDecay.setTimeConstant(2.0*maxIterate);
+    ASSERT_THROW(otherDecay.restore(path), std::string);
+    std::vector<std::vector<kg::Node<double>>> otherMap(2, std::vector<kg::Node<double>>(4, kg::Node<double>(dimension)));
+    auto otherShape = kg::KSOM<double>(source, otherMap, maxIterate, 0.3, 2.0);
+    ASSERT_THROW(otherShape.restore(path), std::string);
+    ASSERT_THROW(restored.restore("ksom_test_missing.bin"), std::string);
+
+    // overlapping snapshots to one path do not share their temporary file
+    auto first = ksom.snapshotAsync(path), second = ksom.snapshotAsync(path);
+    first.get();
+    second.get();
+    restored.restore(path);
+    ASSERT_EQ(ksom.time(), restored.time());
+
+    // a time, stop reason or sampler state out of range is rejected before anything is restored
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    kg::CheckpointHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    const auto rewrite = [&path, &bytes](const kg::CheckpointHeader& changed) {
+        auto corrupted = bytes;
+        std::memcpy(&corrupted[0], &changed, sizeof(changed));
+        std::ofstream(path, std::ios::binary).write(corrupted.data(), corrupted.size());
+    };
+    auto changed = header;
+    changed.time = maxIterate + 1;
+    rewrite(changed);
+    ASSERT_THROW(restored.restore(path), std::string);
+    changed = header;
+    changed.stopReason = 99;
+    rewrite(changed);
+    ASSERT_THROW(restored.restore(path), std::string);
+    changed = header;
+    bytes.replace(header.rngOffset, header.rngSize, std::string(header.rngSize, ' '));
+    rewrite(changed);
+    ASSERT_THROW(restored.restore(path), std::string);
+    ASSERT_EQ(ksom.time(), restored.time());
+    ASSERT_EQ(kg::StopReason::MaxIterate, restored.stopReason());
+
+    // a header that fits a file cut short inside the map is rejected, not read past the end
+    header.rngOffset    = header.mapOffset;
+    header.rngSize      = 0;
+    bytes.resize(header.mapOffset + sizeof(double));
+    std::memcpy(&bytes[0], &header, sizeof(header));
+    std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size());
+    ASSERT_THROW(restored.restore(path), std::string);
+
+    std::remove(path.c_str());
+}
+
+TEST_F(KSOMTest, PublishingMap)
+{
+    constexpr auto dimension = 2;
+    std::vector<kg::Node<double>> source(2, kg::Node<double>(dimension));
+    source[0][0] = 1.0;
+    source[1][1] = 1.0;
+    std::vector<std::vector<kg::Node<double>>> map(2, std::vector<kg::Node<double>>(2, kg::Node<double>(dimension)));
+
+    kg::PublishedMap<double> published(2, 2, dimension);
+    auto ksom = kg::KSOM<double>(source, map, 10, 0.1, 1.0);
+    ksom.setPublishedMap(&published, 4);
+    ASSERT_EQ(0, published.version());
+    ksom.compute();
+    ASSERT_EQ(8, published.version());
+
+    ksom.publish(published);
+    ASSERT_EQ(10, published.version());
+    ASSERT_EQ(ksom.bmu(source[0]), published.bmu(source[0]));
+
+    kg::PublishedMap<double> otherShape(1, 2, dimension);
+    ASSERT_THROW(ksom.setPublishedMap(&otherShape, 1), std::string);
+}
+
+TEST_F(KSOMTest, Profiling)
+{
+    constexpr auto dimension = 2;
+    std::vector<kg::Node<double>> source(2, kg::Node<double>(dimension));
+    source[0][0] = 1.0;
+    source[1][1] = 1.0;
+    std::vector<std::vector<kg::Node<double>>> map(3, std::vector<kg::Node<double>>(4, kg::Node<double>(dimension)));
+
+    auto ksom = kg::KSOM<double>(source, map, 10, 0.1, 1.0);
+    ksom.computeOnes();
+    ASSERT_EQ(0, ksom.profile().steps);
+
+    ksom.enableProfiling();
+    for ( auto i = 0; i < 5; i++ ) {
+        ksom.computeOnes();
+    }
+    auto profile = ksom.profile();
+    ASSERT_EQ(5, profile.steps);
+    ASSERT_EQ(5*12, profile.neuronsVisited);
+    ASSERT_EQ(5*12, profile.neuronsUpdated);
+    ASSERT_EQ(5*12, profile.distanceEvaluations);
+    ASSERT_GT(profile.searchTime + profile.updateTime, 0);
+    ASSERT_FALSE(profile.hardwareCounters);
+
+    ksom.disableProfiling();
+    ksom.compute();
+    ASSERT_EQ(5, ksom.profile().steps);
+
+    ksom.enableProfiling(true);
+    ASSERT_EQ(0, ksom.profile().steps);
+}
+
+TEST_F(KSOMTest, AsynchronousComputation)
+{
+    constexpr auto dimension = 2;
+    std::vector<kg::Node<double>> source(2, kg::Node<double>(dimension));
+    source[0][0] = 1.0;
+    source[1][1] = 1.0;
+    std::vector<std::vector<kg::Node<double>>> map(2, std::vector<kg::Node<double>>(2, kg::Node<double>(dimension)));
+
+    auto ksom = kg::KSOM<double>(source, map, 10, 0.1, 1.0);
+    ASSERT_THROW(ksom.computeAsync(nullptr, 0), std::string);
+
+    std::vector<int> times;
+    auto training = ksom.computeAsync([&times](const kg::Progress& progress) {
+        times.push_back(progress.time);
+    }, 4);
+    ASSERT_EQ(kg::StopReason::MaxIterate, training.get());
+    ASSERT_TRUE(training.waitFor(std::chrono::milliseconds(0)));
+    ASSERT_EQ(std::vector<int>({4, 8, 10}), times);
+    ASSERT_EQ(10, ksom.progress().time);
+}
+
+TEST_F(KSOMTest, CancellingAsynchronousComputation)
+{
+    constexpr auto dimension = 2;
+    std::vector<kg::Node<double>> source(2, kg::Node<double>(dimension));
+    source[0][0] = 1.0;
+    source[1][1] = 1.0;
+    std::vector<std::vector<kg::Node<double>>> map(2, std::vector<kg::Node<double>>(2, kg::Node<double>(dimension)));
+
+    auto ksom = kg::KSOM<double>(source, map, 10, 0.1, 1.0);
+    std::promise<void> reached, cancelled;
+    auto training = ksom.computeAsync([&](const kg::Progress& progress) {
+        if ( progress.time == 5 ) {
+            reached.set_value();
+            cancelled.get_future().wait();
+        }
+    }, 1);
+    reached.get_future().wait();
+    training.cancel();
+    cancelled.set_value();
+
+    ASSERT_EQ(kg::StopReason::Cancelled, training.get());
+    ASSERT_EQ(5, ksom.time());
+    ASSERT_EQ(kg::StopReason::None, ksom.stopReason());
+
+    ksom.compute();
+    ASSERT_EQ(10, ksom.time());
+}
+
+TEST_F(KSOMTest, NumaPartitioning)
+{
+    constexpr auto dimension = 3;
+    std::vector<kg::Node<double>> source(5, kg::Node<double>(dimension));
+    for ( auto k = 0; k < 5; k++ ) {
+        source[k][k%dimension] = 1.0 + k;
+    }
+    std::vector<std::vector<kg::Node<double>>> map(5, std::vector<kg::Node<double>>(3, kg::Node<double>(dimension)));
+    for ( auto r = 0; r < 5; r++ ) {
+        for ( auto c = 0; c < 3; c++ ) {
+            map[r][c][0] = 0.2*r;
+            map[r][c][1] = 0.3*c;
+        }
+    }
+
+    auto expected = kg::KSOM<double>(source, map, 20, 0.2, 2.0, false);
+    auto partitioned = kg::KSOM<double>(source, map, 20, 0.2, 2.0, false);
+    ASSERT_EQ(0, partitioned.numaPartitions());
+    ASSERT_THROW(partitioned.enableNumaPartitioning(-1), std::string);
+    partitioned.enableNumaPartitioning(2);
+    ASSERT_EQ(2, partitioned.numaPartitions());
+    expected.compute();
+    partitioned.compute();
+
+    const auto expectedMap = expected.map(), partitionedMap = partitioned.map();
+    for ( auto r = 0; r < 5; r++ ) {
+        for ( auto c = 0; c < 3; c++ ) {
+            for ( auto i = 0; i < dimension; i++ ) {
+                ASSERT_DOUBLE_EQ(expectedMap[r][c][i], partitionedMap[r][c][i]);
+            }
+        }
+    }
+    ASSERT_EQ(expected.bmu(source[3]), partitioned.bmu(source[3]));
+
+    partitioned.enableNumaPartitioning(10);
+    ASSERT_EQ(5, partitioned.numaPartitions());
+    partitioned.disableNumaPartitioning();
+    ASSERT_EQ(0, partitioned.numaPartitions());
+    ASSERT_TRUE(partitioned.numaRowThreads().empty());
+
+    // every row is placed by the thread that processes it, for the team of
+    // setThreads() too, whether it is set before or after the partitioning
+    const auto bounds = kg::numaPartitionRows(5, 2);
+    for ( const auto threads : {3, 2} ) {
+        partitioned.setThreads(threads);
+        if ( partitioned.numaPartitions() == 0 ) {
+            partitioned.enableNumaPartitioning(2);
+        }
+        #ifdef _OPENMP
+        const auto team = threads;
+        #else
+        const auto team = 1;
+        #endif
+        const auto rowThreads = partitioned.numaRowThreads();
+        ASSERT_EQ(5U, rowThreads.size());
+        for ( auto thread = 0; thread < team; thread++ ) {
+            const auto rows = kg::numaThreadRows(bounds, thread, team);
+            for ( auto r = rows.first; r < rows.second; r++ ) {
+                ASSERT_EQ(thread, rowThreads[r]);
+            }
+        }
+    }
+}
+
+TEST_F(KSOMTest, WeightedSamples)
+{
+    constexpr auto dimension = 2;
+    std::vector<kg::Node<double>> source(2, kg::Node<double>(dimension));
+    source[0][0] = 1.0;
+    source[1][1] = 1.0;
+    std::vector<std::vector<kg::Node<double>>> map(2, std::vector<kg::Node<double>>(2, kg::Node<double>(dimension)));
+
+    auto ksom = kg::KSOM<double>(source, map, 10, 0.1, 1.0, false);
+    ASSERT_THROW(ksom.setWeights({1.0}), std::string);
+    ASSERT_THROW(ksom.setWeights({1.0, -1.0}), std::string);
+    ASSERT_THROW(ksom.setWeights({0.0, 0.0}), std::string);
+
+    // the second sample never moves the map
+    ksom.setWeights({3.0, 0.0});
+    ksom.compute();
+    const auto weightedMap = ksom.map();
+    for ( auto r = 0; r < 2; r++ ) {
+        for ( auto c = 0; c < 2; c++ ) {
+            ASSERT_GT(weightedMap[r][c][0], 0.0);
+            ASSERT_DOUBLE_EQ(0.0, weightedMap[r][c][1]);
+        }
+    }
+
+    const auto bmu = ksom.bmu(source[0]);
+    const auto& nearest = weightedMap[std::get<0>(bmu)][std::get<1>(bmu)];
+    const auto error = sqrt((1.0 - nearest[0])*(1.0 - nearest[0]));
+    ASSERT_NEAR(error, ksom.evaluate().quantizationError, 1.0e-12);
+
+    // a weight of 2 moves a model vector as far as two presentations
+    std::vector<kg::Node<double>> single(1, kg::Node<double>(dimension));
+    single[0][0] = 1.0;
+    std::vector<std::vector<kg::Node<double>>> one(1, std::vector<kg::Node<double>>(1, kg::Node<double>(dimension)));
+    auto weighted = kg::KSOM<double>(single, one, 1, 0.5, 1.0, false);
+    weighted.setWeights({2.0});
+    weighted.computeOnes();
+    ASSERT_DOUBLE_EQ(0.5, weighted.map()[0][0][0]);
+}
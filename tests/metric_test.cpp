@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <cmath>
+#include "../sources/node.hpp"
+#include "../sources/metric.hpp"
+
+
+class MetricTest : public ::testing::Test {
+protected:
+    const int dimension;
+    kg::Node<double> node1;
+    kg::Node<double> node2;
+    std::vector<std::vector<kg::Node<double>>> map;
+
+protected:
+    MetricTest()
+        :dimension(3)
+    {
+    }
+
+    ~MetricTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+        node1 = kg::Node<double>(dimension);
+        node1[0] = 1.0;
+        node1[1] = 2.0;
+        node1[2] = 3.0;
+
+        node2 = kg::Node<double>(dimension);
+        node2[0] = 4.0;
+        node2[1] = 0.0;
+        node2[2] = 3.0;
+
+        map = std::vector<std::vector<kg::Node<double>>>(1, std::vector<kg::Node<double>>{node1, node2});
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(MetricTest, Euclidean)
+{
+    kg::EuclideanMetric metric;
+    metric.prepare(map, dimension);
+    ASSERT_DOUBLE_EQ(sqrt(13.0), metric.distance(node1.data(), node2.data(), dimension));
+    ASSERT_DOUBLE_EQ(13.0, metric.rank(node1.data(), node2.data(), dimension, 1));
+    ASSERT_DOUBLE_EQ(sqrt(13.0), metric.fromRank(node1.data(), 13.0, dimension));
+}
+
+TEST_F(MetricTest, Manhattan)
+{
+    kg::ManhattanMetric metric;
+    metric.prepare(map, dimension);
+    ASSERT_DOUBLE_EQ(5.0, metric.distance(node1.data(), node2.data(), dimension));
+    ASSERT_DOUBLE_EQ(5.0, metric.rank(node1.data(), node2.data(), dimension, 1));
+    ASSERT_DOUBLE_EQ(5.0, metric.fromRank(node1.data(), 5.0, dimension));
+}
+
+TEST_F(MetricTest, WeightedEuclidean)
+{
+    kg::WeightedEuclideanMetric metric({1.0, 0.5, 2.0});
+    metric.prepare(map, dimension);
+    ASSERT_DOUBLE_EQ(sqrt(11.0), metric.distance(node1.data(), node2.data(), dimension));
+    ASSERT_DOUBLE_EQ(sqrt(11.0), metric.fromRank(node1.data(), metric.rank(node1.data(), node2.data(), dimension, 1), dimension));
+
+    kg::WeightedEuclideanMetric invalidMetric({1.0, 0.5});
+    ASSERT_THROW(invalidMetric.prepare(map, dimension), std::string);
+}
+
+TEST_F(MetricTest, Cosine)
+{
+    kg::CosineMetric metric;
+    metric.prepare(map, dimension);
+    const auto expected = 1.0 - 13.0/(sqrt(14.0)*5.0);
+    ASSERT_DOUBLE_EQ(expected, metric.distance(node1.data(), node2.data(), dimension));
+    ASSERT_DOUBLE_EQ(-13.0/5.0, metric.rank(node1.data(), node2.data(), dimension, 1));
+    ASSERT_DOUBLE_EQ(expected, metric.fromRank(node1.data(), -13.0/5.0, dimension));
+
+    node2[1] = 12.0;
+    metric.update(node2.data(), dimension, 1);
+    ASSERT_DOUBLE_EQ(-37.0/13.0, metric.rank(node1.data(), node2.data(), dimension, 1));
+}
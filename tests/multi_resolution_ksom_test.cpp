@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <cmath>
+#include "../sources/node.hpp"
+#include "../sources/ksom.hpp"
+#include "../sources/multi_resolution_ksom.hpp"
+
+
+class MultiResolutionKSOMTest : public ::testing::Test {
+protected:
+    const int dimension;
+    std::vector<kg::Node<double>> source;
+    std::vector<std::vector<kg::Node<double>>> coarseMap;
+
+protected:
+    MultiResolutionKSOMTest()
+        :dimension(2)
+    {
+    }
+
+    ~MultiResolutionKSOMTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+        source = std::vector<kg::Node<double>>(4, kg::Node<double>(dimension));
+        source[1][0] = 1.0;
+        source[2][1] = 1.0;
+        source[3][0] = 1.0;
+        source[3][1] = 1.0;
+
+        coarseMap = std::vector<std::vector<kg::Node<double>>>(2, std::vector<kg::Node<double>>(2, kg::Node<double>(dimension)));
+        for ( auto r = 0; r < 2; r++ ) {
+            for ( auto c = 0; c < 2; c++ ) {
+                coarseMap[r][c][0] = r;
+                coarseMap[r][c][1] = c;
+            }
+        }
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(MultiResolutionKSOMTest, Upsampling)
+{
+    const auto map = kg::MultiResolutionKSOM<double>::upsample(coarseMap, 3, 5);
+    ASSERT_EQ(3, map.size());
+    ASSERT_EQ(5, map[0].size());
+    for ( auto r = 0; r < 3; r++ ) {
+        for ( auto c = 0; c < 5; c++ ) {
+            ASSERT_DOUBLE_EQ(r/2.0, map[r][c][0]);
+            ASSERT_DOUBLE_EQ(c/4.0, map[r][c][1]);
+        }
+    }
+}
+
+TEST_F(MultiResolutionKSOMTest, Computation)
+{
+    constexpr auto finalRows = 7, finalCols = 8, maxIterate = 100;
+    kg::MultiResolutionKSOM<double> som(source, coarseMap, finalRows, finalCols, maxIterate, 0.1, 1.0);
+    som.compute();
+
+    // 2x2 -> 4x4 -> 7x8; the final level refines for a tenth of the steps
+    // and the coarser levels share the rest
+    ASSERT_EQ(2, som.level());
+    ASSERT_EQ(maxIterate, som.time());
+    ASSERT_EQ(45*4 + 45*16 + 10*finalRows*finalCols, som.work());
+    ASSERT_LT(som.work(), maxIterate*finalRows*finalCols);
+    const auto map = som.map();
+    ASSERT_EQ(finalRows, map.size());
+    ASSERT_EQ(finalCols, map[0].size());
+
+    ASSERT_THROW(kg::MultiResolutionKSOM<double>(source, coarseMap, 1, 1, maxIterate, 0.1, 1.0), std::string);
+    ASSERT_THROW(kg::MultiResolutionKSOM<double>(source, coarseMap, 4, 4, maxIterate, 0.1, 1.0, 1.0), std::string);
+}
+
+TEST_F(MultiResolutionKSOMTest, ContinuousSchedule)
+{
+    constexpr auto maxIterate = 100;
+    constexpr auto alpha0 = 0.1;
+    kg::MultiResolutionKSOM<double> som(source, coarseMap, 7, 8, maxIterate, alpha0, 1.0);
+
+    // alpha decays by the same factor every step, also where a level begins
+    auto alpha = som.progress().alpha;
+    auto level = som.level();
+    auto levelChanges = 0;
+    ASSERT_DOUBLE_EQ(alpha0, alpha);
+    while ( som.computeOnes() ) {
+        const auto progress = som.progress();
+        ASSERT_EQ(maxIterate, progress.maxIterate);
+        ASSERT_NEAR(alpha*exp(-1.0/maxIterate), progress.alpha, 1.0e-12);
+        ASSERT_NEAR(alpha0*exp(-static_cast<double>(progress.time)/maxIterate), progress.alpha, 1.0e-12);
+        if ( som.level() != level ) {
+            level = som.level();
+            ++levelChanges;
+        }
+        alpha = progress.alpha;
+    }
+    ASSERT_EQ(2, levelChanges);
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../sources/neuron_index.hpp"
+
+
+class NeuronIndexTest : public ::testing::Test {
+protected:
+    NeuronIndexTest()
+    {
+    }
+
+    ~NeuronIndexTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(NeuronIndexTest, Hits)
+{
+    // 2 x 3 map, neuron n = r*3 + c
+    kg::NeuronIndex index(2, 3);
+    index.build({4, 0, 4, 5, 0, 4});
+    ASSERT_EQ(6, index.size());
+    ASSERT_EQ(5, index.bmu(3));
+    ASSERT_EQ(2, index.hits(0, 0));
+    ASSERT_EQ(0, index.hits(0, 1));
+    ASSERT_EQ(3, index.hits(1, 1));
+    const auto histogram = index.hits();
+    ASSERT_EQ((std::vector<std::vector<int>>{{2, 0, 0}, {0, 3, 1}}), histogram);
+    ASSERT_EQ((std::vector<int>{0, 2, 5}), index.samples(1, 1));
+    ASSERT_TRUE(index.samples(0, 2).empty());
+
+    ASSERT_THROW(index.build({6}), std::string);
+    ASSERT_THROW(index.build({-1}), std::string);
+}
+
+
+TEST_F(NeuronIndexTest, Region)
+{
+    kg::NeuronIndex index(3, 3);
+    index.build({0, 1, 2, 3, 4, 5, 6, 7, 8, 4, 8});
+    ASSERT_EQ((std::vector<int>{4, 9, 5, 7, 8, 10}), index.region(1, 1, 3, 3));
+    ASSERT_EQ((std::vector<int>{0, 1, 3, 4, 9}), index.region(-1, -1, 2, 2));
+    ASSERT_TRUE(index.region(1, 2, 3, 2).empty());
+    ASSERT_EQ(11U, index.region(0, 0, 3, 3).size());
+}
+
+
+TEST_F(NeuronIndexTest, MajorityLabels)
+{
+    kg::NeuronIndex index(1, 4);
+    index.build({0, 0, 0, 1, 1, 2, 2, 2});
+    const auto majority = index.majorityLabels({5, 3, 5, 2, 1, -1, -1, 7});
+    ASSERT_EQ(5, majority[0][0]);
+    ASSERT_EQ(1, majority[0][1]);
+    ASSERT_EQ(7, majority[0][2]);
+    ASSERT_EQ(-1, majority[0][3]);
+
+    ASSERT_THROW(index.majorityLabels({0}), std::string);
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include "../sources/numa.hpp"
+
+
+class NumaTest : public ::testing::Test {
+protected:
+    NumaTest()
+    {
+    }
+
+    ~NumaTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(NumaTest, CountingNodes)
+{
+    ASSERT_GE(kg::numaNodeCount(), 1);
+}
+
+
+TEST_F(NumaTest, PartitioningRows)
+{
+    ASSERT_EQ(std::vector<int>({0, 3, 6, 10}), kg::numaPartitionRows(10, 3));
+    ASSERT_EQ(std::vector<int>({0, 5}), kg::numaPartitionRows(5, 1));
+}
+
+
+TEST_F(NumaTest, DealingRowsToThreads)
+{
+    const auto bounds = kg::numaPartitionRows(10, 2);
+
+    // four threads, two per partition
+    ASSERT_EQ(0, kg::numaPartitionOf(1, 4, 2));
+    ASSERT_EQ(1, kg::numaPartitionOf(2, 4, 2));
+    ASSERT_EQ(std::make_pair(0, 2), kg::numaThreadRows(bounds, 0, 4));
+    ASSERT_EQ(std::make_pair(2, 5), kg::numaThreadRows(bounds, 1, 4));
+    ASSERT_EQ(std::make_pair(5, 7), kg::numaThreadRows(bounds, 2, 4));
+    ASSERT_EQ(std::make_pair(7, 10), kg::numaThreadRows(bounds, 3, 4));
+
+    // three threads never share rows across partitions
+    ASSERT_EQ(std::make_pair(0, 2), kg::numaThreadRows(bounds, 0, 3));
+    ASSERT_EQ(std::make_pair(2, 5), kg::numaThreadRows(bounds, 1, 3));
+    ASSERT_EQ(std::make_pair(5, 10), kg::numaThreadRows(bounds, 2, 3));
+
+    // fewer threads than partitions
+    const auto many = kg::numaPartitionRows(12, 4);
+    ASSERT_EQ(std::make_pair(0, 6), kg::numaThreadRows(many, 0, 2));
+    ASSERT_EQ(std::make_pair(6, 12), kg::numaThreadRows(many, 1, 2));
+    ASSERT_EQ(std::make_pair(0, 12), kg::numaThreadRows(many, 0, 1));
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include "../sources/node.hpp"
+#include "../sources/pca.hpp"
+
+
+class PCATest : public ::testing::Test {
+protected:
+    PCATest()
+    {
+    }
+
+    ~PCATest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(PCATest, PrincipalComponents)
+{
+    // points spread along (1, 2, 0)/sqrt(5), less along z, barely along the rest
+    constexpr auto dimension = 3;
+    std::mt19937 mt(1);
+    std::normal_distribution<> normal(0.0, 1.0);
+    std::vector<kg::Node<double>> source(500, kg::Node<double>(dimension));
+    for ( auto& node : source ) {
+        const auto t = 10.0*normal(mt), z = 3.0*normal(mt);
+        node[0] = 1.0 + t + 0.1*normal(mt);
+        node[1] = 2.0 + 2.0*t - 0.05*normal(mt);
+        node[2] = -1.0 + z;
+    }
+
+    const auto pca = kg::principalComponents(source, 2);
+    ASSERT_EQ(2U, pca.components.size());
+    ASSERT_EQ(2U, pca.variances.size());
+    ASSERT_GT(pca.variances[0], pca.variances[1]);
+    ASSERT_NEAR(1.0/sqrt(5.0), std::fabs(pca.components[0][0]), 1.0e-2);
+    ASSERT_NEAR(2.0/sqrt(5.0), std::fabs(pca.components[0][1]), 1.0e-2);
+    ASSERT_NEAR(1.0, std::fabs(pca.components[1][2]), 1.0e-2);
+    ASSERT_NEAR(-1.0, pca.mean[2], 0.5);
+
+    for ( auto j = 0; j < 2; j++ ) {
+        for ( auto k = 0; k < 2; k++ ) {
+            auto dot = 0.0;
+            for ( auto i = 0; i < dimension; i++ ) {
+                dot += pca.components[j][i]*pca.components[k][i];
+            }
+            ASSERT_NEAR(j == k ? 1.0 : 0.0, dot, 1.0e-9);
+        }
+    }
+
+    ASSERT_THROW(kg::principalComponents(source, 4), std::string);
+    ASSERT_THROW(kg::principalComponents(std::vector<kg::Node<double>>(), 1), std::string);
+}
+
+
+TEST_F(PCATest, LinearMap)
+{
+    constexpr auto dimension = 3, rows = 5, cols = 3;
+    std::mt19937 mt(1);
+    std::normal_distribution<> normal(0.0, 1.0);
+    std::vector<kg::Node<double>> source(500, kg::Node<double>(dimension));
+    for ( auto& node : source ) {
+        node[0] = 10.0*normal(mt);
+        node[1] = 3.0*normal(mt);
+        node[2] = 0.1*normal(mt);
+    }
+
+    // rows span the first component and columns the second, one standard deviation each way
+    const auto pca = kg::principalComponents(source, 2);
+    const auto map = kg::linearMap(source, rows, cols);
+    ASSERT_EQ(static_cast<size_t>(rows), map.size());
+    ASSERT_EQ(static_cast<size_t>(cols), map[0].size());
+    for ( auto i = 0; i < dimension; i++ ) {
+        ASSERT_NEAR(pca.mean[i], map[2][1][i], 1.0e-9);
+        ASSERT_NEAR(2.0*sqrt(pca.variances[0])*pca.components[0][i], map[4][1][i] - map[0][1][i], 1.0e-9);
+        ASSERT_NEAR(2.0*sqrt(pca.variances[1])*pca.components[1][i], map[2][2][i] - map[2][0][i], 1.0e-9);
+    }
+    ASSERT_NEAR(20.0, std::fabs(map[4][1][0] - map[0][1][0]), 2.0);
+
+    // a wide map lays the first component along its columns
+    const auto wide = kg::linearMap(source, 1, 4);
+    ASSERT_NEAR(2.0*sqrt(pca.variances[0]), std::fabs(wide[0][3][0] - wide[0][0][0]), 1.0);
+
+    ASSERT_THROW(kg::linearMap(source, 0, 3), std::string);
+}
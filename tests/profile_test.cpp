@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include "../sources/profile.hpp"
+
+
+class ProfileTest : public ::testing::Test {
+protected:
+    kg::Profile profile;
+
+protected:
+    ProfileTest()
+    {
+    }
+
+    ~ProfileTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+        profile                     = kg::Profile();
+        profile.steps               = 3;
+        profile.searchTime          = 120;
+        profile.neuronsVisited      = 12;
+        profile.distanceEvaluations = 15;
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(ProfileTest, Formatting)
+{
+    const auto text = kg::formatProfile(profile, kg::ProfileFormat::Text);
+    ASSERT_NE(std::string::npos, text.find("steps 3\n"));
+    ASSERT_NE(std::string::npos, text.find("searchTime 120\n"));
+    ASSERT_EQ(std::string::npos, text.find("cycles"));
+
+    profile.hardwareCounters    = true;
+    profile.cycles              = 1000;
+    const auto json = kg::formatProfile(profile, kg::ProfileFormat::Json);
+    ASSERT_EQ('{', json.front());
+    ASSERT_NE(std::string::npos, json.find("\"distanceEvaluations\": 15,"));
+    ASSERT_NE(std::string::npos, json.find("\"cycles\": 1000,"));
+    ASSERT_NE(std::string::npos, json.find("\"hardwareCounters\": true\n}"));
+}
+
+
+TEST_F(ProfileTest, Writing)
+{
+    const std::string path = "profile_test.json";
+    kg::writeProfile(path, profile);
+
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    ASSERT_EQ(kg::formatProfile(profile, kg::ProfileFormat::Json), content.str());
+    std::remove(path.c_str());
+
+    ASSERT_THROW(kg::writeProfile("no_such_directory/profile.json", profile), std::string);
+}
+
+
+TEST_F(ProfileTest, PhaseTimer)
+{
+    auto elapsed = 0LL;
+    kg::PhaseTimer disabled(false);
+    disabled.lap(elapsed);
+    ASSERT_EQ(0, elapsed);
+
+    kg::PhaseTimer enabled(true);
+    for ( volatile auto i = 0; i < 1000; i++ ) {
+        ;
+    }
+    enabled.lap(elapsed);
+    ASSERT_GT(elapsed, 0);
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <tuple>
+#include "../sources/node.hpp"
+#include "../sources/projection.hpp"
+
+
+class ProjectionTest : public ::testing::Test {
+protected:
+    ProjectionTest()
+    {
+    }
+
+    ~ProjectionTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(ProjectionTest, ProjectedSearch)
+{
+    constexpr auto dimension = 3, rows = 4, cols = 5;
+    std::vector<std::vector<kg::Node<double>>> map(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(dimension)));
+    for ( auto r = 0; r < rows; r++ ) {
+        for ( auto c = 0; c < cols; c++ ) {
+            map[r][c][0] = r;
+            map[r][c][1] = c;
+            map[r][c][2] = r*c;
+        }
+    }
+
+    // projecting away the last element makes (2, 3) and (2, 4) look alike
+    kg::ProjectedCodebook<double> projection(2);
+    projection.setMatrix({{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}});
+    projection.build(map, 2);
+    ASSERT_EQ(2, projection.dimension());
+
+    kg::Node<double> x(dimension);
+    x[0] = 2.0;
+    x[1] = 3.4;
+    x[2] = 8.0;
+    auto ranked = 0;
+    const auto nearest = projection.search(x.data(), [&map, &x, &ranked](int r, int c) {
+        ++ranked;
+        auto dis = 0.0;
+        for ( auto i = 0; i < dimension; i++ ) {
+            dis += (x[i] - map[r][c][i])*(x[i] - map[r][c][i]);
+        }
+        return dis;
+    }, 2);
+    ASSERT_EQ(std::make_tuple(2, 4), nearest);
+    ASSERT_EQ(2, ranked);
+
+    // a learning step of one model vector is followed without projecting it again
+    double y[2];
+    projection.project(x.data(), y);
+    ASSERT_DOUBLE_EQ(2.0, y[0]);
+    ASSERT_DOUBLE_EQ(3.4, y[1]);
+    projection.update(0, 1.0, y);
+    const auto moved = projection.search(x.data(), [](int r, int c) {
+        return r == 0 && c == 0 ? 0.0 : 1.0;
+    }, 1);
+    ASSERT_EQ(std::make_tuple(0, 0), moved);
+
+    ASSERT_THROW(kg::ProjectedCodebook<double>(0), std::string);
+    ASSERT_THROW(projection.setMatrix({{1.0, 0.0}, {1.0}}), std::string);
+}
+
+
+TEST_F(ProjectionTest, RandomProjection)
+{
+    const auto rows = kg::randomProjection(8, 100);
+    ASSERT_EQ(8U, rows.size());
+    ASSERT_EQ(100U, rows[0].size());
+    ASSERT_EQ(rows, kg::randomProjection(8, 100));
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <thread>
+#include <atomic>
+#include "../sources/node.hpp"
+#include "../sources/published_map.hpp"
+
+
+class PublishedMapTest : public ::testing::Test {
+protected:
+    const int rows;
+    const int cols;
+    const int dimension;
+
+protected:
+    PublishedMapTest()
+        :rows(2)
+        ,cols(3)
+        ,dimension(2)
+    {
+    }
+
+    ~PublishedMapTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(PublishedMapTest, Publishing)
+{
+    kg::PublishedMap<double> published(rows, cols, dimension);
+    kg::Node<double> query(dimension);
+    query[0] = 4.0;
+    ASSERT_EQ(-1, published.version());
+    ASSERT_THROW(published.bmu(query), std::string);
+
+    published.publish(7, [this](double* codebook) {
+        for ( auto n = 0; n < rows*cols; n++ ) {
+            codebook[n*dimension] = n;
+            codebook[n*dimension + 1] = 0.0;
+        }
+    });
+    long long version = 0;
+    ASSERT_EQ(std::make_tuple(1, 1), published.bmu(query, &version));
+    ASSERT_EQ(7, version);
+    ASSERT_EQ(7, published.version());
+
+    ASSERT_THROW(published.bmu(kg::Node<double>(dimension + 1)), std::string);
+    ASSERT_THROW(kg::PublishedMap<double>(rows, cols, dimension, 1), std::string);
+}
+
+TEST_F(PublishedMapTest, ReadingWhilePublishing)
+{
+    // every published version has all elements equal to the version
+    kg::PublishedMap<double> published(rows, cols, dimension);
+    std::atomic<bool> finished(false);
+    std::atomic<int> torn(0);
+
+    std::thread reader([&]() {
+        while ( !finished ) {
+            published.read([&](const double* codebook, long long version) {
+                for ( auto i = 0; i < rows*cols*dimension; i++ ) {
+                    if ( codebook[i] != version ) {
+                        ++torn;
+                    }
+                }
+            });
+        }
+    });
+    for ( auto version = 0; version < 2000; version++ ) {
+        published.publish(version, [&](double* codebook) {
+            for ( auto i = 0; i < rows*cols*dimension; i++ ) {
+                codebook[i] = version;
+            }
+        });
+    }
+    finished = true;
+    reader.join();
+
+    ASSERT_EQ(0, torn);
+    ASSERT_EQ(1999, published.version());
+}
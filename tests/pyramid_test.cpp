@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <tuple>
+#include "../sources/node.hpp"
+#include "../sources/metric.hpp"
+#include "../sources/pyramid.hpp"
+
+
+class MapPyramidTest : public ::testing::Test {
+protected:
+    const int rows;
+    const int cols;
+    std::vector<std::vector<kg::Node<double>>> map;
+
+protected:
+    MapPyramidTest()
+        :rows(10)
+        ,cols(7)
+    {
+    }
+
+    ~MapPyramidTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+        // model vectors on a plane, so pooled cells keep the ordering
+        map = std::vector<std::vector<kg::Node<double>>>(rows, std::vector<kg::Node<double>>(cols, kg::Node<double>(2)));
+        for ( auto r = 0; r < rows; r++ ) {
+            for ( auto c = 0; c < cols; c++ ) {
+                map[r][c][0] = r;
+                map[r][c][1] = c;
+            }
+        }
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(MapPyramidTest, Building)
+{
+    kg::MapPyramid<double> pyramid(2, 1);
+    pyramid.build(map, 2);
+
+    // 10x7 -> 5x4 -> 3x2 -> 2x1
+    ASSERT_EQ(3, pyramid.levels());
+    ASSERT_DOUBLE_EQ(0.5, pyramid.cell(0, 0, 0)[0]);
+    ASSERT_DOUBLE_EQ(6.0, pyramid.cell(0, 0, 3)[1]);
+    ASSERT_DOUBLE_EQ(8.5, pyramid.cell(1, 2, 1)[0]);
+    ASSERT_DOUBLE_EQ(5.0, pyramid.cell(1, 2, 1)[1]);
+
+    ASSERT_THROW(kg::MapPyramid<double>(1, 1), std::string);
+    ASSERT_THROW(kg::MapPyramid<double>(2, 0), std::string);
+}
+
+TEST_F(MapPyramidTest, Refreshing)
+{
+    kg::MapPyramid<double> pyramid(2, 1);
+    pyramid.build(map, 2);
+
+    map[0][0][0] = 4.0;
+    map[9][6][0] = 4.0;
+    pyramid.refresh(map, [](int r0, int, int, int) { return r0 == 0; }, 2);
+    ASSERT_DOUBLE_EQ(1.5, pyramid.cell(0, 0, 0)[0]);
+    ASSERT_DOUBLE_EQ(8.5, pyramid.cell(0, 4, 3)[0]);
+}
+
+TEST_F(MapPyramidTest, Searching)
+{
+    kg::EuclideanMetric metric;
+    kg::MapPyramid<double> pyramid(2, 2);
+    pyramid.build(map, 2);
+
+    kg::Node<double> query(2);
+    query[0] = 6.8;
+    query[1] = 2.1;
+    const auto x = query.data();
+    const auto bmu = pyramid.search(x,
+        [&metric](const double* ref, const double* w) {
+            return metric.distance(ref, w, 2);
+        },
+        [this, &metric, x](int r, int c) {
+            return metric.rank(x, map[r][c].data(), 2, r*cols + c);
+        });
+    ASSERT_EQ(std::make_tuple(7, 2), bmu);
+}
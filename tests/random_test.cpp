@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include "../sources/random.hpp"
+
+
+class RandomTest : public ::testing::Test {
+protected:
+    RandomTest()
+    {
+    }
+
+    ~RandomTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(RandomTest, Philox)
+{
+    // known answers of the reference implementation
+    const auto zero = kg::philox({{0, 0, 0, 0}}, 0);
+    ASSERT_EQ((kg::PhiloxBlock{{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}}), zero);
+    const auto ones = kg::philox({{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}}, 0xffffffffffffffffULL);
+    ASSERT_EQ((kg::PhiloxBlock{{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}}), ones);
+    const auto pi = kg::philox({{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}}, 0x299f31d0a4093822ULL);
+    ASSERT_EQ((kg::PhiloxBlock{{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}}), pi);
+}
+
+
+TEST_F(RandomTest, CounterEngine)
+{
+    // words of a stream are the words of consecutive blocks
+    kg::CounterEngine engine(7, 3);
+    for ( auto block = 0U; block < 3; block++ ) {
+        const auto expected = kg::philox({{block, 0, 3, 0}}, 7);
+        for ( auto k = 0; k < 4; k++ ) {
+            ASSERT_EQ(expected[k], engine());
+        }
+    }
+
+    kg::CounterEngine other(7, 4);
+    ASSERT_NE(kg::philox({{0, 0, 3, 0}}, 7)[0], other());
+
+    constexpr auto bound = 6U, draws = 6000U;
+    std::vector<unsigned int> counts(bound, 0);
+    for ( auto k = 0U; k < draws; k++ ) {
+        const auto value = engine.below(bound);
+        ASSERT_LT(value, bound);
+        ++counts[value];
+    }
+    for ( const auto count : counts ) {
+        ASSERT_GT(count, draws/bound/2);
+    }
+}
+
+
+TEST_F(RandomTest, Permutation)
+{
+    std::vector<int> order(100), expected(100);
+    std::iota(order.begin(), order.end(), 0);
+    std::iota(expected.begin(), expected.end(), 0);
+    kg::CounterEngine engine(1);
+    kg::permute(order.begin(), order.end(), engine);
+    ASSERT_NE(expected, order);
+
+    auto same = order;
+    kg::CounterEngine again(1);
+    std::iota(same.begin(), same.end(), 0);
+    kg::permute(same.begin(), same.end(), again);
+    ASSERT_EQ(order, same);
+
+    std::sort(order.begin(), order.end());
+    ASSERT_EQ(expected, order);
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include "../sources/sampler.hpp"
+
+
+class SamplerTest : public ::testing::Test {
+protected:
+    SamplerTest()
+    {
+    }
+
+    ~SamplerTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(SamplerTest, ShuffledEpochs)
+{
+    constexpr auto length = 10;
+    kg::EpochSampler sampler(length, true, 1);
+    std::vector<int> first, second;
+    first.push_back(sampler.next());
+    for ( auto k = 1; k < length; k++ ) {
+        const auto upcoming = sampler.peek();
+        first.push_back(sampler.next());
+        ASSERT_EQ(upcoming, first.back());
+    }
+    ASSERT_EQ(-1, sampler.peek());
+    for ( auto k = 0; k < length; k++ ) {
+        second.push_back(sampler.next());
+    }
+    ASSERT_NE(first, second);
+
+    // every epoch draws every sample exactly once
+    for ( auto epoch : {first, second} ) {
+        std::sort(epoch.begin(), epoch.end());
+        for ( auto k = 0; k < length; k++ ) {
+            ASSERT_EQ(k, epoch[k]);
+        }
+    }
+
+    kg::EpochSampler sequential(3, false);
+    ASSERT_EQ(0, sequential.peek());
+    ASSERT_EQ(0, sequential.next());
+    ASSERT_EQ(1, sequential.next());
+    ASSERT_EQ(2, sequential.next());
+    ASSERT_EQ(0, sequential.next());
+}
+
+
+TEST_F(SamplerTest, BlockShuffle)
+{
+    constexpr auto length = 10, blockSize = 4;
+    kg::EpochSampler sampler(length, true, 1);
+    sampler.setBlockSize(blockSize);
+    ASSERT_EQ(blockSize, sampler.blockSize());
+
+    // blocks {0..3}, {4..7} and {8, 9} are visited one after another
+    std::vector<int> order;
+    for ( auto k = 0; k < length; k++ ) {
+        order.push_back(sampler.next());
+    }
+    auto k = 0;
+    while ( k < length ) {
+        const auto block = order[k]/blockSize;
+        const auto size  = std::min(blockSize, length - block*blockSize);
+        for ( auto j = 0; j < size; j++ ) {
+            ASSERT_EQ(block, order[k + j]/blockSize);
+        }
+        k += size;
+    }
+
+    ASSERT_GE(kg::cacheBlockSize(1024), 1);
+}
+
+
+TEST_F(SamplerTest, SavingState)
+{
+    constexpr auto length = 10;
+    kg::EpochSampler sampler(length, true, 1);
+    for ( auto k = 0; k < 4; k++ ) {
+        sampler.next();
+    }
+
+    // a sampler restored in the middle of an epoch continues it
+    std::stringstream state;
+    sampler.write(state);
+    kg::EpochSampler restored(length);
+    ASSERT_TRUE(restored.read(state));
+    ASSERT_EQ(sampler.seed(), restored.seed());
+    for ( auto k = 0; k < 2*length; k++ ) {
+        ASSERT_EQ(sampler.peek(), restored.peek());
+        ASSERT_EQ(sampler.next(), restored.next());
+    }
+
+    // a state that cannot be parsed or does not fit the length is rejected and changes nothing
+    for ( const auto text : {"", "1 0 x 0", "1 0 -1 0", "1 0 11 0", "1 -2 0 0", "1 0 0 -1"} ) {
+        std::stringstream invalid(text);
+        ASSERT_FALSE(restored.read(invalid));
+        ASSERT_EQ(sampler.seed(), restored.seed());
+        ASSERT_EQ(sampler.peek(), restored.peek());
+    }
+}
+
+
+TEST_F(SamplerTest, Seeking)
+{
+    // the sample of a step only depends on the seed and the step
+    constexpr auto length = 7, steps = 5*length;
+    kg::EpochSampler sampler(length, true, 42);
+    std::vector<int> samples;
+    for ( auto k = 0; k < steps; k++ ) {
+        samples.push_back(sampler.next());
+    }
+    for ( auto step = 0; step < steps; step++ ) {
+        kg::EpochSampler sought(length, true, 42);
+        sought.seek(step);
+        for ( auto k = step; k < steps; k++ ) {
+            ASSERT_EQ(samples[k], sought.next());
+        }
+    }
+
+    kg::EpochSampler other(length, true, 43);
+    std::vector<int> otherSamples;
+    for ( auto k = 0; k < steps; k++ ) {
+        otherSamples.push_back(other.next());
+    }
+    ASSERT_NE(samples, otherSamples);
+    other.setSeed(42);
+    other.seek(0);
+    for ( auto k = 0; k < steps; k++ ) {
+        ASSERT_EQ(samples[k], other.next());
+    }
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../sources/node.hpp"
+#include "../sources/sparse_node.hpp"
+
+
+class SparseNodeTest : public ::testing::Test {
+protected:
+    const size_t size;
+    kg::Node<double> dense;
+
+protected:
+    SparseNodeTest()
+        :size(6)
+    {
+    }
+
+    ~SparseNodeTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+        dense = kg::Node<double>(size);
+        dense[1] = 2.0;
+        dense[4] = -3.0;
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(SparseNodeTest, Initialization)
+{
+    kg::SparseNode<double> node(size, {1, 4}, {2.0, -3.0});
+    ASSERT_EQ(size, node.size());
+    ASSERT_EQ(2, node.nnz());
+    ASSERT_DOUBLE_EQ(13.0, node.squaredNorm());
+
+    ASSERT_THROW(kg::SparseNode<double>(size, {1, 4}, {2.0}), std::string);
+    ASSERT_THROW(kg::SparseNode<double>(size, {4, 1}, {2.0, -3.0}), std::string);
+    ASSERT_THROW(kg::SparseNode<double>(size, {1, 6}, {2.0, -3.0}), std::string);
+}
+
+TEST_F(SparseNodeTest, ConvertingNode)
+{
+    kg::SparseNode<double> node(dense);
+    ASSERT_EQ(2, node.nnz());
+    ASSERT_EQ(1, node.index(0));
+    ASSERT_EQ(4, node.index(1));
+
+    auto restored = node.toNode();
+    for ( auto i = 0; i < size; i++ ) {
+        ASSERT_DOUBLE_EQ(dense[i], restored[i]);
+    }
+}
+
+TEST_F(SparseNodeTest, SettingAndGettingElement)
+{
+    kg::SparseNode<double> node(dense);
+    node.setElem(5.0, 0);
+    node.setElem(0.0, 4);
+    ASSERT_EQ(2, node.nnz());
+    ASSERT_DOUBLE_EQ(5.0, node.elem(0));
+    ASSERT_DOUBLE_EQ(2.0, node.elem(1));
+    ASSERT_DOUBLE_EQ(0.0, node.elem(4));
+    ASSERT_DOUBLE_EQ(29.0, node.squaredNorm());
+
+    ASSERT_THROW(node.setElem(1.0, size), std::string);
+    ASSERT_THROW(node.elem(size), std::string);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <limits>
+#include "../sources/topology.hpp"
+
+
+class TopologyTest : public ::testing::Test {
+protected:
+    const int rows;
+    const int cols;
+
+protected:
+    TopologyTest()
+        :rows(4)
+        ,cols(5)
+    {
+    }
+
+    ~TopologyTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(TopologyTest, Rectangular)
+{
+    kg::RectangularTopology topology;
+    topology.prepare(rows, cols);
+    for ( auto r = 0; r < rows; r++ ) {
+        const auto sqDistances = topology.row(1, 3, r);
+        for ( auto c = 0; c < cols; c++ ) {
+            ASSERT_DOUBLE_EQ((r - 1)*(r - 1) + (c - 3)*(c - 3), sqDistances[c]);
+        }
+    }
+}
+
+TEST_F(TopologyTest, Toroidal)
+{
+    kg::ToroidalTopology topology;
+    topology.prepare(rows, cols);
+    ASSERT_DOUBLE_EQ(0.0, topology.row(0, 0, 0)[0]);
+    ASSERT_DOUBLE_EQ(1.0, topology.row(0, 0, 0)[4]);
+    ASSERT_DOUBLE_EQ(2.0, topology.row(0, 0, 3)[4]);
+    ASSERT_DOUBLE_EQ(4.0 + 1.0, topology.row(0, 4, 2)[0]);
+}
+
+TEST_F(TopologyTest, Hexagonal)
+{
+    kg::HexagonalTopology topology;
+    topology.prepare(rows, cols);
+    // six neighbors at distance one, for both even and odd BMU rows
+    for ( auto bmuRow = 1; bmuRow <= 2; bmuRow++ ) {
+        auto neighbors = 0;
+        for ( auto r = 0; r < rows; r++ ) {
+            const auto sqDistances = topology.row(bmuRow, 2, r);
+            for ( auto c = 0; c < cols; c++ ) {
+                if ( std::abs(sqDistances[c] - 1.0) < 1.0e-9 ) {
+                    ++neighbors;
+                }
+            }
+        }
+        ASSERT_EQ(6, neighbors);
+    }
+    ASSERT_DOUBLE_EQ(0.0, topology.row(1, 2, 1)[2]);
+}
+
+TEST_F(TopologyTest, Graph)
+{
+    // a ring over the first six neurons
+    std::vector<std::pair<int, int>> edges;
+    for ( auto n = 0; n < 6; n++ ) {
+        edges.emplace_back(n, (n + 1)%6);
+    }
+    kg::GraphTopology topology(edges);
+    topology.prepare(rows, cols);
+    ASSERT_DOUBLE_EQ(0.0, topology.row(0, 0, 0)[0]);
+    ASSERT_DOUBLE_EQ(9.0, topology.row(0, 0, 0)[3]);
+    ASSERT_DOUBLE_EQ(1.0, topology.row(0, 0, 1)[0]);
+    ASSERT_EQ(std::numeric_limits<double>::infinity(), topology.row(0, 0, 2)[0]);
+
+    kg::GraphTopology invalidTopology({{0, rows*cols}});
+    ASSERT_THROW(invalidTopology.prepare(rows, cols), std::string);
+}
+
+TEST_F(TopologyTest, Neighbors)
+{
+    kg::RectangularTopology rectangular;
+    rectangular.prepare(rows, cols);
+    ASSERT_EQ(2, rectangular.neighbors(0).size());
+    ASSERT_EQ(4, rectangular.neighbors(1*cols + 2).size());
+
+    kg::ToroidalTopology toroidal;
+    toroidal.prepare(rows, cols);
+    ASSERT_EQ(4, toroidal.neighbors(0).size());
+
+    kg::HexagonalTopology hexagonal;
+    hexagonal.prepare(rows, cols);
+    ASSERT_EQ(6, hexagonal.neighbors(1*cols + 2).size());
+    ASSERT_EQ(6, hexagonal.neighbors(2*cols + 2).size());
+
+    kg::GraphTopology graph({{0, 1}, {1, 0}, {0, 7}});
+    graph.prepare(rows, cols);
+    ASSERT_EQ(std::vector<int>({1, 7}), graph.neighbors(0));
+    ASSERT_TRUE(graph.neighbors(2).empty());
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <utility>
+#include <chrono>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../sources/transport.hpp"
+
+
+class TransportTest : public ::testing::Test {
+protected:
+    TransportTest()
+    {
+    }
+
+    ~TransportTest()
+    {
+    }
+
+    virtual auto SetUp() -> void
+    {
+    }
+
+    virtual auto TearDown() -> void
+    {
+    }
+
+    static auto SetUpTestCase() -> void
+    {
+    }
+
+    static auto TearDownTestCase() -> void
+    {
+    }
+};
+
+
+TEST_F(TransportTest, Sharding)
+{
+    ASSERT_EQ(std::make_pair(0, 3), kg::shardOf(10, 0, 3));
+    ASSERT_EQ(std::make_pair(3, 6), kg::shardOf(10, 1, 3));
+    ASSERT_EQ(std::make_pair(6, 10), kg::shardOf(10, 2, 3));
+}
+
+
+TEST_F(TransportTest, Allreduce)
+{
+    kg::LocalTransport local;
+    double value = 1.5;
+    local.allreduce(&value, 1);
+    ASSERT_EQ(0, local.rank());
+    ASSERT_EQ(1, local.size());
+    ASSERT_DOUBLE_EQ(1.5, value);
+
+    // workers may be threads as well as processes
+    constexpr auto workers = 3;
+    const auto path = "/tmp/ksom_transport_test_" + std::to_string(getpid());
+    std::vector<std::vector<double>> buffers(workers);
+    std::vector<std::thread> threads;
+    for ( auto rank = 0; rank < workers; rank++ ) {
+        threads.emplace_back([&buffers, &path, rank]() {
+            kg::SocketTransport transport(path, rank, workers);
+            buffers[rank] = {1.0*rank, 10.0*rank, 1.0};
+            transport.allreduce(buffers[rank].data(), buffers[rank].size());
+            transport.allreduce(buffers[rank].data(), buffers[rank].size());
+        });
+    }
+    for ( auto& thread : threads ) {
+        thread.join();
+    }
+    for ( const auto& buffer : buffers ) {
+        ASSERT_EQ(std::vector<double>({9.0, 90.0, 9.0}), buffer);
+    }
+
+    ASSERT_THROW(kg::SocketTransport(path, -1, workers), std::string);
+    ASSERT_THROW(kg::SocketTransport(path, 1, 2, std::chrono::milliseconds(50)), std::string);
+}
+
+
+TEST_F(TransportTest, MissingWorkers)
+{
+    // rank 0 gives up on a worker that never connects
+    const auto path = "/tmp/ksom_transport_missing_" + std::to_string(getpid());
+    ASSERT_THROW(kg::SocketTransport(path, 0, 2, std::chrono::milliseconds(50)), std::string);
+
+    // and on one that connects but never tells its rank
+    std::thread silent([&path]() {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, path.c_str());
+        for ( auto attempt = 0; attempt < 100; attempt++ ) {
+            const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if ( connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 ) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                close(fd);
+                return;
+            }
+            close(fd);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+    EXPECT_THROW(kg::SocketTransport(path, 0, 2, std::chrono::milliseconds(200)), std::string);
+    silent.join();
+}